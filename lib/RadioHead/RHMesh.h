@@ -250,8 +250,8 @@ protected:
     virtual bool isPhysicalAddress(uint8_t* address, uint8_t addresslen);
 
 private:
-    /// Temporary message buffer
-    static uint8_t _tmpMessage[RH_ROUTER_MAX_MESSAGE_LEN];
+    /// Temporary message buffer (per instance, so many meshes can run in one process)
+    uint8_t _tmpMessage[RH_ROUTER_MAX_MESSAGE_LEN];
 
 };
 
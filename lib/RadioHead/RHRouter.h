@@ -336,8 +336,8 @@ protected:
 
 private:
 
-    /// Temporary mesage buffer
-    static RoutedMessage _tmpMessage;
+    /// Temporary mesage buffer (per instance, so many routers can run in one process)
+    RoutedMessage        _tmpMessage;
 
     /// Local routing table
     RoutingTableEntry    _routes[RH_ROUTING_TABLE_SIZE];
@@ -0,0 +1,157 @@
+// RH_Sim.cpp
+// Driver for the in-process simulated ether of tools/simPool.cpp
+
+#include <RadioHead.h>
+
+// This can only build on Linux and compatible systems
+#if (RH_PLATFORM == RH_PLATFORM_UNIX) 
+
+#include <RH_Sim.h>
+
+RH_Sim::RH_Sim(uint32_t bitsPerSecond)
+    : _bitsPerSecond(bitsPerSecond),
+      _txStart(0),
+      _txEnd(0),
+      _rxQueueLen(0),
+      _rxBufLen(0),
+      _rxBufValid(false)
+{
+}
+
+bool RH_Sim::init()
+{
+    _mode = RHModeIdle;
+    return true;
+}
+
+bool RH_Sim::deliver(const RHSimFrame& frame)
+{
+    if (_rxQueueLen >= RH_SIM_RX_QUEUE_LEN)
+    {
+	_rxBad++;
+	return false;
+    }
+
+    // Keep the queue in order of end time, a long frame can end after a shorter one sent later
+    uint8_t i = _rxQueueLen;
+    while (i > 0 && (long)(_rxQueue[i - 1].end - frame.end) > 0)
+    {
+	_rxQueue[i] = _rxQueue[i - 1];
+	i--;
+    }
+    _rxQueue[i] = frame;
+    _rxQueueLen++;
+    return true;
+}
+
+uint32_t RH_Sim::timeOnAir(uint8_t len)
+{
+    uint32_t ms = (uint32_t)(len + RH_SIM_HEADER_LEN) * 8 * 1000 / _bitsPerSecond;
+    return ms > 0 ? ms : 1;
+}
+
+void RH_Sim::validateRxBuf()
+{
+    if (_promiscuous ||
+	_rxHeaderTo == _thisAddress ||
+	_rxHeaderTo == RH_BROADCAST_ADDRESS)
+    {
+	_rxGood++;
+	_rxBufValid = true;
+    }
+}
+
+bool RH_Sim::available()
+{
+    unsigned long now = millis();
+
+    if (_mode == RHModeTx && (long)(now - _txEnd) >= 0)
+	_mode = RHModeIdle;
+
+    while (!_rxBufValid && _rxQueueLen > 0 && (long)(now - _rxQueue[0].end) >= 0)
+    {
+	RHSimFrame& frame = _rxQueue[0];
+
+	// Half-duplex: frames ending while transmitting are lost
+	bool heard = !((long)(frame.end - _txStart) > 0 && (long)(frame.start - _txEnd) < 0);
+	if (heard)
+	{
+	    _rxHeaderTo    = frame.to;
+	    _rxHeaderFrom  = frame.from;
+	    _rxHeaderId    = frame.id;
+	    _rxHeaderFlags = frame.flags;
+	    memcpy(_rxBuf, frame.payload, frame.len);
+	    _rxBufLen = frame.len;
+	    validateRxBuf();
+	}
+	else
+	    _rxBad++;
+
+	_rxQueueLen--;
+	memmove(_rxQueue, _rxQueue + 1, _rxQueueLen * sizeof(RHSimFrame));
+    }
+    return _rxBufValid;
+}
+
+bool RH_Sim::recv(uint8_t* buf, uint8_t* len)
+{
+    if (!available())
+	return false;
+
+    if (buf && len)
+    {
+	if (*len > _rxBufLen)
+	    *len = _rxBufLen;
+	memcpy(buf, _rxBuf, *len);
+    }
+    _rxBufValid = false;
+    return true;
+}
+
+bool RH_Sim::send(const uint8_t* data, uint8_t len)
+{
+    if (len > RH_SIM_MAX_MESSAGE_LEN)
+	return false;
+
+    if (!waitCAD()) 
+	return false;
+
+    waitPacketSent();
+
+    RHSimFrame frame;
+    frame.start = millis();
+    frame.end   = frame.start + timeOnAir(len);
+    frame.to    = _txHeaderTo;
+    frame.from  = _txHeaderFrom;
+    frame.id    = _txHeaderId;
+    frame.flags = _txHeaderFlags;
+    frame.len   = len;
+    memcpy(frame.payload, data, len);
+
+    _txStart = frame.start;
+    _txEnd   = frame.end;
+    _mode    = RHModeTx;
+    _txGood++;
+
+    simEtherSend(this, frame);
+    return true;
+}
+
+bool RH_Sim::waitPacketSent()
+{
+    while (_mode == RHModeTx)
+    {
+	if ((long)(millis() - _txEnd) >= 0)
+	    _mode = RHModeIdle;
+	else
+	    YIELD;
+    }
+    return true;
+}
+
+uint8_t RH_Sim::maxMessageLength()
+{
+    return RH_SIM_MAX_MESSAGE_LEN;
+}
+
+#endif
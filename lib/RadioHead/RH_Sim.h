@@ -0,0 +1,143 @@
+// RH_Sim.h
+// Driver for the in-process simulated ether of tools/simPool.cpp
+#ifndef RH_Sim_h
+#define RH_Sim_h
+
+#include <RHGenericDriver.h>
+
+// Max size of a frame on the simulated ether, including the to, from, id and flags headers
+#define RH_SIM_MAX_PAYLOAD_LEN 255
+#define RH_SIM_HEADER_LEN 4
+#define RH_SIM_MAX_MESSAGE_LEN (RH_SIM_MAX_PAYLOAD_LEN - RH_SIM_HEADER_LEN)
+
+// Frames from the ether still on the air (not received yet)
+#define RH_SIM_RX_QUEUE_LEN 32
+
+// Default simulated baud rate, the same as etherSimulator.pl
+#define RH_SIM_DEFAULT_BPS 10000
+
+/// \brief A frame on the simulated ether, with the virtual time it is on the air
+typedef struct
+{
+    unsigned long   start;   ///< millis() of the sender when the transmission started
+    unsigned long   end;     ///< millis() when the transmission ends, and the frame is received
+    uint8_t         to;      ///< Header to
+    uint8_t         from;    ///< Header from
+    uint8_t         id;      ///< Header id
+    uint8_t         flags;   ///< Header flags
+    uint8_t         len;     ///< Number of octets in payload
+    uint8_t         payload[RH_SIM_MAX_MESSAGE_LEN]; ///< Payload
+} RHSimFrame;
+
+class RH_Sim;
+
+/// Implemented by the simulator host (tools/simPool.cpp): put a frame on the ether for the other nodes.
+/// \param[in] sender The driver of the node sending
+/// \param[in] frame The frame, copied
+extern void simEtherSend(RH_Sim* sender, const RHSimFrame& frame);
+
+/////////////////////////////////////////////////////////////////////
+/// \class RH_Sim RH_Sim.h <RH_Sim.h>
+/// \brief Driver to send and receive unaddressed, unreliable datagrams on an in-process simulated ether
+///
+/// \par Overview
+///
+/// This class is intended to support the testing of RadioHead manager classes with many nodes
+/// in one Linux process, on virtual time.
+/// Unlike RH_TCP, which needs a process, a socket and a real-time clock per node, each RH_Sim is a plain object:
+/// the simPool host (tools/simPool.cpp) creates hundreds of driver and manager stacks, runs them on a thread pool
+/// and carries the frames between them.
+///
+/// \par Running the simulator
+///
+/// \code
+/// cd whatever/RadioHead
+/// tools/simPoolBuild
+/// # 100 RHMesh nodes on a chain (each hears its 2 closest neighbours on each side), reporting to node 1 every minute
+/// ./simPool -m mesh -n 100 -r 2 -t 3600 -p 60
+/// \endcode
+///
+/// \par Implementation
+///
+/// A frame is on the air for its length at the simulated baud rate, like on etherSimulator.pl,
+/// and is received when its transmission ends.
+/// The driver is half-duplex: frames ending while it transmits are lost.
+/// Like on etherSimulator.pl there are no collisions, the host decides which nodes hear each frame.
+///
+/// millis(), delay() and YIELD advance the virtual time of the node running, so the blocking
+/// calls of the managers (sendtoWait(), waitAvailableTimeout() ...) work unmodified.
+class RH_Sim : public RHGenericDriver
+{
+public:
+    /// Constructor
+    /// \param[in] bitsPerSecond Simulated baud rate, for the time on air of the frames
+    RH_Sim(uint32_t bitsPerSecond = RH_SIM_DEFAULT_BPS);
+
+    /// Initialise the Driver transport hardware and software.
+    /// \return true if initialisation succeeded.
+    virtual bool init();
+
+    /// Tests whether a new message is available
+    /// This can be called multiple times in a timeout loop.
+    /// \return true if a new, complete, error-free uncollected message is available to be retreived by recv()
+    virtual bool available();
+
+    /// Turns the receiver on if it not already on.
+    /// If there is a valid message available, copy it to buf and return true
+    /// else return false.
+    /// If a message is copied, *len is set to the length (Caution, 0 length messages are permitted).
+    /// You should be sure to call this function frequently enough to not miss any messages
+    /// It is recommended that you call it in your main loop.
+    /// \param[in] buf Location to copy the received message
+    /// \param[in,out] len Pointer to available space in buf. Set to the actual number of octets copied.
+    /// \return true if a valid message was copied to buf
+    virtual bool recv(uint8_t* buf, uint8_t* len);
+
+    /// Waits until any previous transmit packet is finished being transmitted with waitPacketSent().
+    /// Then puts the message on the ether, it is received by the other nodes after its time on air.
+    /// \param[in] data Array of data to be sent
+    /// \param[in] len Number of bytes of data to send (> 0)
+    /// \return true if the message length was valid and it was correctly queued for transmit
+    virtual bool send(const uint8_t* data, uint8_t len);
+
+    /// Blocks until the transmitter is no longer transmitting, on virtual time.
+    virtual bool waitPacketSent();
+
+    /// Returns the maximum message length
+    /// available in this Driver.
+    /// \return The maximum legal message length
+    virtual uint8_t maxMessageLength();
+
+    /// Called by the simulator host to pass a frame from the ether.
+    /// It becomes available when its transmission ends, if it is for this node.
+    /// \param[in] frame The frame, copied
+    /// \return false if the receive queue is full and the frame was dropped
+    bool deliver(const RHSimFrame& frame);
+
+    /// Time on air of a frame at the simulated baud rate
+    /// \param[in] len Number of bytes of data
+    /// \return The time on air in milliseconds (at least 1)
+    uint32_t timeOnAir(uint8_t len);
+
+private:
+    /// Check whether the latest received message is for this node
+    void            validateRxBuf();
+
+    /// Simulated baud rate
+    uint32_t        _bitsPerSecond;
+
+    /// Virtual time of the transmission in progress (or the last one)
+    unsigned long   _txStart;
+    unsigned long   _txEnd;
+
+    /// Frames from the ether, in order of end time
+    RHSimFrame      _rxQueue[RH_SIM_RX_QUEUE_LEN];
+    uint8_t         _rxQueueLen;
+
+    /// The latest received message
+    uint8_t         _rxBuf[RH_SIM_MAX_MESSAGE_LEN];
+    uint8_t         _rxBufLen;
+    bool            _rxBufValid;
+};
+
+#endif
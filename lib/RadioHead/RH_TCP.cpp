@@ -21,9 +21,11 @@
 
 RH_TCP::RH_TCP(const char* server)
     : _server(server),
+      _socketBufLen(0),
       _rxBufLen(0),
       _rxBufValid(false),
-      _socket(-1)
+      _socket(-1),
+      _rxBufFull(false)
 {
 }
     
@@ -113,15 +115,11 @@ void RH_TCP::clearRxBuf()
 
 bool RH_TCP::checkForEvents()
 {
-    #define RH_TCP_SOCKETBUF_LEN 500
-    static uint8_t socketBuf[RH_TCP_SOCKETBUF_LEN]; // Room for several messages
-    static uint16_t socketBufLen = 0;
-
     if (_socket < 0)
 	return false;
 
     // Read at most the amount of space we have left in the buffer
-    ssize_t count = read(_socket, socketBuf + socketBufLen, sizeof(socketBuf) - socketBufLen);
+    ssize_t count = read(_socket, _socketBuf + _socketBufLen, sizeof(_socketBuf) - _socketBufLen);
     if (count < 0)
     {
 	if (errno != EAGAIN)
@@ -142,13 +140,13 @@ bool RH_TCP::checkForEvents()
     }
     else
     {
-	socketBufLen += count;
-	while (socketBufLen >= 5)
+	_socketBufLen += count;
+	while (_socketBufLen >= 5)
 	{
-	    RHTcpTypeMessage* message = ((RHTcpTypeMessage*)socketBuf);
+	    RHTcpTypeMessage* message = ((RHTcpTypeMessage*)_socketBuf);
 	    uint32_t len = ntohl(message->length);
 	    uint32_t messageLen = len + sizeof(message->length);
-	    if (len > sizeof(socketBuf) - sizeof(message->length))
+	    if (len > sizeof(_socketBuf) - sizeof(message->length))
 	    {
 		// Bogus length
 		fprintf(stderr, "RH_TCP::checkForEvents read ridiculous length: %d. Corrupt message stream? Aborting\n", len);
@@ -156,14 +154,14 @@ bool RH_TCP::checkForEvents()
 		_socket = -1;
 		return false;
 	    }
-	    if (socketBufLen >= len + sizeof(message->length))
+	    if (_socketBufLen >= len + sizeof(message->length))
 	    {
 		// Got at least all of this message
 		if (message->type == RH_TCP_MESSAGE_TYPE_PACKET && len >= 5)
 		{
 		    // REVISIT: need to check if we are actually receiving?
 		    // Its a new packet, extract the headers and payload
-		    RHTcpPacket* packet = ((RHTcpPacket*)socketBuf);
+		    RHTcpPacket* packet = ((RHTcpPacket*)_socketBuf);
 		    _rxHeaderTo    = packet->to;
 		    _rxHeaderFrom  = packet->from;
 		    _rxHeaderId    = packet->id;
@@ -180,9 +178,11 @@ bool RH_TCP::checkForEvents()
 		// check for other message types here
 		// Now remove the used message by copying the trailing bytes (maybe start of a new message?)
 		// to the top of the buffer
-		memcpy(socketBuf, socketBuf + messageLen, sizeof(socketBuf) - messageLen);
-		socketBufLen -= messageLen;
+		memmove(_socketBuf, _socketBuf + messageLen, sizeof(_socketBuf) - messageLen);
+		_socketBufLen -= messageLen;
 	    }
+	    else
+		break; // Wait for the rest of the message
 	}
     }
     return true; // No faults
@@ -204,7 +204,7 @@ bool RH_TCP::available()
 {
     if (_socket < 0)
 	return false;
-    if (checkForEvents())
+    if (!checkForEvents())
 	return false;        // Som sort of IO failre
     if (_rxBufFull)
     {
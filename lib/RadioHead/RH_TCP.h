@@ -8,6 +8,9 @@
 #include <RHGenericDriver.h>
 #include <RHTcpProtocol.h>
 
+// Size of the stream buffer of each RH_TCP, room for several messages
+#define RH_TCP_SOCKETBUF_LEN 500
+
 /////////////////////////////////////////////////////////////////////
 /// \class RH_TCP RH_TCP.h <RH_TCP.h>
 /// \brief Driver to send and receive unaddressed, unreliable datagrams via sockets on a Linux simulator
@@ -174,6 +177,10 @@ private:
     /// The TCP socket used to communicate with the message server
     int         _socket;
 
+    /// Stream read from the socket, room for several RHTcpProtocol messages
+    uint8_t     _socketBuf[RH_TCP_SOCKETBUF_LEN];
+    uint16_t    _socketBufLen;
+
     /// Buffer to receive RHTcpProtocol messages
     uint8_t     _rxBuf[RH_TCP_MAX_PAYLOAD_LEN + 5];
     uint16_t    _rxBufLen;
@@ -23,6 +23,8 @@ extern void delay(unsigned long ms);
 extern unsigned long millis();
 extern long random(long to);
 extern long random(long from, long to);
+// Called while spin-waiting (YIELD)
+extern void yield();
 
 // Equavalent to HardwareSerial in Arduino
 // but outputs to stdout
@@ -1935,6 +1935,9 @@ these examples and explanations and extend them to suit your needs.
 #elif (RH_PLATFORM == RH_PLATFORM_ESP32)
  // ESP32 also has it
  #define YIELD yield();
+#elif (RH_PLATFORM == RH_PLATFORM_UNIX)
+ // The simulator provides it: nothing in simMain, advances the node virtual time in simPool
+ #define YIELD yield();
 #else
  #define YIELD
 #endif
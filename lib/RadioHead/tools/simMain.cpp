@@ -58,6 +58,11 @@ unsigned long millis()
     return time_in_millis() - start_millis;
 }
 
+// Nothing else to run in this process
+void yield()
+{
+}
+
 long random(long from, long to)
 {
     return from + (random() % (to - from));
@@ -0,0 +1,469 @@
+// simPool.cpp
+// Runs hundreds of RadioHead RHMesh or RHReliableDatagram nodes in a single Linux process, on virtual time
+//
+// Each node is its own RH_Sim driver and manager stack, with its own address, running on a fiber (ucontext)
+// with its own virtual clock: millis(), delay() and YIELD (the spin-waits of the managers) act on the node running.
+// The nodes are run by a work-stealing thread pool, in windows of virtual time no longer than the shortest
+// frame time on air: a frame sent in a window is received after the window, so the nodes run
+// independently inside a window and the frames are carried between them at the end of it, in a deterministic order.
+//
+// Scenario: every node but 1 sends a reliable message to node 1 every period, starting at a random time,
+// node 1 records the latency. In mesh mode every node routes for the others.
+//
+// usage: simPool [-h] [-c configfile] [-m datagram|mesh] [-n nodes] [-r range] [-t seconds] [-p period]
+//                [-b bitspersec] [-w windowms] [-k tickms] [-j threads] [-s seed]
+// The config file is the same as etherSimulator.pl (probability:nodea:nodeb:probability).
+// With -r, nodes whose addresses differ by more than range do not hear each other (a chain), unless set on the config.
+//
+// Build with tools/simPoolBuild
+
+#include <RadioHead.h>
+#include <RH_Sim.h>
+#include <RHMesh.h>
+#include <RHReliableDatagram.h>
+
+#include <ucontext.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Stack of each node fiber
+#define SIMPOOL_STACK_SIZE (128 * 1024)
+
+// The node all the others report to
+#define SIMPOOL_SINK_ADDRESS 1
+
+SerialSimulator Serial;
+int    _simulator_argc;
+char** _simulator_argv;
+
+// One simulated node: driver, manager, fiber and virtual clock
+struct SimNode
+{
+    uint8_t             address;
+    RH_Sim*             driver;
+    RHReliableDatagram* datagram;
+    RHMesh*             mesh;
+
+    unsigned long       time;        // Virtual clock - ms
+    std::mt19937        random;
+
+    ucontext_t          context;
+    ucontext_t*         worker;      // Context of the worker thread running the node
+    std::vector<char>   stack;
+
+    std::vector<RHSimFrame> outbox;  // Frames sent in the current window
+
+    // Scenario
+    unsigned long       nextSend;
+    unsigned long       sent;
+    unsigned long       acked;
+    unsigned long       received;
+    double              latency;
+};
+
+// Work queue of one worker thread, the others steal from its front when they run out
+struct WorkQueue
+{
+    std::mutex          mutex;
+    std::deque<int>     nodes;
+};
+
+static std::vector<SimNode*> nodes;
+static std::vector<WorkQueue> queues;
+static std::map<std::pair<int, int>, double> probabilities;
+static int range = 0;
+static unsigned long tick = 1;
+static unsigned long period = 60000;
+static bool meshMode = false;
+
+// Window being run
+static unsigned long windowEnd = 0;
+static std::mutex poolMutex;
+static std::condition_variable poolStart;
+static std::condition_variable poolDone;
+static unsigned long generation = 0;
+static int running = 0;
+static bool stopping = false;
+
+static unsigned long framesSent = 0;
+static unsigned long framesDropped = 0;
+
+static thread_local SimNode*   currentNode = NULL;
+static thread_local ucontext_t workerContext;
+
+////////////////////////////////////////////////////////////////////
+// Arduino functions, for the node running on this thread
+
+unsigned long millis()
+{
+    return currentNode ? currentNode->time : 0;
+}
+
+// Back to the worker thread. The node may be resumed by another worker
+static void suspend(SimNode* node)
+{
+    swapcontext(&node->context, node->worker);
+}
+
+void delay(unsigned long ms)
+{
+    SimNode* node = currentNode;
+    if (!node)
+	return;
+    node->time += ms;
+    suspend(node);
+}
+
+// Spin-waits cost a tick of virtual time
+void yield()
+{
+    SimNode* node = currentNode;
+    if (!node)
+	return;
+    node->time += tick;
+    suspend(node);
+}
+
+long random(long from, long to)
+{
+    if (to <= from)
+	return from;
+    std::mt19937& rng = currentNode ? currentNode->random : nodes[0]->random;
+    return from + (long)(rng() % (unsigned long)(to - from));
+}
+
+long random(long to)
+{
+    return random(0, to);
+}
+
+void simEtherSend(RH_Sim* sender, const RHSimFrame& frame)
+{
+    (void)sender;
+    currentNode->outbox.push_back(frame);
+}
+
+////////////////////////////////////////////////////////////////////
+// Scenario
+
+static void nodeMain()
+{
+    SimNode* node = currentNode;
+    uint8_t buf[RH_MESH_MAX_MESSAGE_LEN];
+
+    if (!(meshMode ? node->mesh->init() : node->datagram->init()))
+	fprintf(stderr, "simPool: node %d init failed\n", node->address);
+
+    node->nextSend = node->random() % period;
+
+    while (true)
+    {
+	uint8_t len = sizeof(buf) - 1;
+	uint8_t from;
+	bool got = meshMode
+	    ? node->mesh->recvfromAck(buf, &len, &from)
+	    : node->datagram->recvfromAck(buf, &len, &from);
+
+	if (got && node->address == SIMPOOL_SINK_ADDRESS)
+	{
+	    buf[len] = '\0';
+	    node->received++;
+	    node->latency += millis() - strtoul((const char*)buf, NULL, 10);
+	}
+
+	if (node->address != SIMPOOL_SINK_ADDRESS && millis() >= node->nextSend)
+	{
+	    int n = snprintf((char*)buf, sizeof(buf), "%lu", millis());
+	    node->sent++;
+	    bool acked = meshMode
+		? node->mesh->sendtoWait(buf, n + 1, SIMPOOL_SINK_ADDRESS) == RH_ROUTER_ERROR_NONE
+		: node->datagram->sendtoWait(buf, n + 1, SIMPOOL_SINK_ADDRESS);
+	    if (acked)
+		node->acked++;
+	    node->nextSend += period;
+	}
+
+	yield();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// Thread pool
+
+static int takeNode(size_t self)
+{
+    {
+	std::lock_guard<std::mutex> lock(queues[self].mutex);
+	if (!queues[self].nodes.empty())
+	{
+	    int index = queues[self].nodes.back();
+	    queues[self].nodes.pop_back();
+	    return index;
+	}
+    }
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+	WorkQueue& victim = queues[(self + i) % queues.size()];
+	std::lock_guard<std::mutex> lock(victim.mutex);
+	if (!victim.nodes.empty())
+	{
+	    int index = victim.nodes.front();
+	    victim.nodes.pop_front();
+	    return index;
+	}
+    }
+    return -1;
+}
+
+static void runNode(SimNode* node)
+{
+    currentNode = node;
+    while ((long)(node->time - windowEnd) < 0)
+    {
+	node->worker = &workerContext;
+	swapcontext(&workerContext, &node->context);
+    }
+    currentNode = NULL;
+}
+
+static void worker(size_t self)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+	{
+	    std::unique_lock<std::mutex> lock(poolMutex);
+	    poolStart.wait(lock, [&] { return stopping || generation != seen; });
+	    if (stopping)
+		return;
+	    seen = generation;
+	}
+
+	int index;
+	while ((index = takeNode(self)) >= 0)
+	    runNode(nodes[index]);
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (--running == 0)
+	    poolDone.notify_one();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// Ether
+
+static double probabilityOfDelivery(int from, int to)
+{
+    std::map<std::pair<int, int>, double>::iterator it = probabilities.find(std::make_pair(from, to));
+    if (it != probabilities.end())
+	return it->second;
+    if (range > 0 && abs(from - to) > range)
+	return 0.0;
+    return 1.0;
+}
+
+// At the end of a window, carry the frames sent to the nodes that hear them, in a deterministic order
+static void deliverFrames(std::mt19937& etherRandom)
+{
+    std::vector<const RHSimFrame*> frames;
+    std::vector<int> senders;
+    for (size_t i = 0; i < nodes.size(); i++)
+	for (size_t j = 0; j < nodes[i]->outbox.size(); j++)
+	{
+	    frames.push_back(&nodes[i]->outbox[j]);
+	    senders.push_back(i);
+	}
+
+    std::vector<size_t> order(frames.size());
+    for (size_t i = 0; i < order.size(); i++)
+	order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return (long)(frames[a]->start - frames[b]->start) < 0; });
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (size_t k = 0; k < order.size(); k++)
+    {
+	const RHSimFrame& frame = *frames[order[k]];
+	int sender = senders[order[k]];
+	framesSent++;
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+	    if ((int)i == sender)
+		continue;
+	    double probability = probabilityOfDelivery(nodes[sender]->address, nodes[i]->address);
+	    if (probability <= 0.0)
+		continue;
+	    if (probability < 1.0 && uniform(etherRandom) >= probability)
+	    {
+		framesDropped++;
+		continue;
+	    }
+	    nodes[i]->driver->deliver(frame);
+	}
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++)
+	nodes[i]->outbox.clear();
+}
+
+////////////////////////////////////////////////////////////////////
+
+static void readConfig(const char* config)
+{
+    FILE* file = fopen(config, "r");
+    if (!file)
+    {
+	fprintf(stderr, "simPool: could not open config file %s\n", config);
+	exit(1);
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+	int a, b;
+	double probability;
+	if (sscanf(line, "probability:%d:%d:%lf", &a, &b, &probability) == 3)
+	{
+	    probabilities[std::make_pair(a, b)] = probability;
+	    probabilities[std::make_pair(b, a)] = probability; // Bidirectional
+	}
+    }
+    fclose(file);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: simPool [-h] [-c configfile] [-m datagram|mesh] [-n nodes] [-r range] [-t seconds] [-p period]\n"
+	    "               [-b bitspersec] [-w windowms] [-k tickms] [-j threads] [-s seed]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    _simulator_argc = argc;
+    _simulator_argv = argv;
+
+    int count = 10;
+    double seconds = 600;
+    uint32_t bps = RH_SIM_DEFAULT_BPS;
+    unsigned long window = 0;
+    unsigned int threads = std::thread::hardware_concurrency();
+    unsigned long seed = 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "hc:m:n:r:t:p:b:w:k:j:s:")) != -1)
+    {
+	switch (option)
+	{
+	case 'c': readConfig(optarg); break;
+	case 'm': meshMode = strcmp(optarg, "mesh") == 0; break;
+	case 'n': count = atoi(optarg); break;
+	case 'r': range = atoi(optarg); break;
+	case 't': seconds = atof(optarg); break;
+	case 'p': period = (unsigned long)(atof(optarg) * 1000); break;
+	case 'b': bps = strtoul(optarg, NULL, 10); break;
+	case 'w': window = strtoul(optarg, NULL, 10); break;
+	case 'k': tick = strtoul(optarg, NULL, 10); break;
+	case 'j': threads = atoi(optarg); break;
+	case 's': seed = strtoul(optarg, NULL, 10); break;
+	default: usage();
+	}
+    }
+
+    // Addresses are 8 bit, 255 is broadcast
+    if (count < 2 || count > 254 || bps == 0 || period == 0)
+	usage();
+    if (threads < 1)
+	threads = 1;
+    if (tick < 1)
+	tick = 1;
+
+    for (int i = 0; i < count; i++)
+    {
+	SimNode* node = new SimNode();
+	node->address = i + 1;
+	node->driver = new RH_Sim(bps);
+	if (meshMode)
+	    node->datagram = node->mesh = new RHMesh(*node->driver, node->address);
+	else
+	    node->datagram = new RHReliableDatagram(*node->driver, node->address);
+	node->random.seed(seed * 1000 + node->address);
+
+	node->stack.resize(SIMPOOL_STACK_SIZE);
+	getcontext(&node->context);
+	node->context.uc_stack.ss_sp = node->stack.data();
+	node->context.uc_stack.ss_size = node->stack.size();
+	node->context.uc_link = NULL;
+	makecontext(&node->context, nodeMain, 0);
+	nodes.push_back(node);
+    }
+
+    // A frame sent in a window must not be received in it
+    if (window == 0 || window > nodes[0]->driver->timeOnAir(0))
+	window = nodes[0]->driver->timeOnAir(0);
+
+    std::vector<WorkQueue> pool(threads);
+    queues.swap(pool);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+	workers.push_back(std::thread(worker, i));
+
+    std::mt19937 etherRandom(seed);
+    unsigned long duration = (unsigned long)(seconds * 1000);
+
+    struct timespec wallStart, wallEnd;
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    for (windowEnd = window; windowEnd <= duration; windowEnd += window)
+    {
+	// Nodes keep their worker between windows, unless stolen
+	for (size_t i = 0; i < nodes.size(); i++)
+	    queues[i % threads].nodes.push_back(i);
+
+	std::unique_lock<std::mutex> lock(poolMutex);
+	running = threads;
+	generation++;
+	poolStart.notify_all();
+	poolDone.wait(lock, [] { return running == 0; });
+	lock.unlock();
+
+	deliverFrames(etherRandom);
+    }
+
+    {
+	std::lock_guard<std::mutex> lock(poolMutex);
+	stopping = true;
+	poolStart.notify_all();
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+	workers[i].join();
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    double wall = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+
+    unsigned long sent = 0, acked = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+	sent += nodes[i]->sent;
+	acked += nodes[i]->acked;
+    }
+    SimNode* sink = nodes[SIMPOOL_SINK_ADDRESS - 1];
+
+    printf("simPool: %d %s nodes, %u threads, %.0f s simulated in %.1f s (window %lu ms)\n",
+	   count, meshMode ? "RHMesh" : "RHReliableDatagram", threads, seconds, wall, window);
+    printf("frames: %lu sent, %lu dropped (link probability)\n", framesSent, framesDropped);
+    printf("messages: %lu sent, %lu acknowledged, %lu received by node %d, mean latency %.1f ms\n",
+	   sent, acked, sink->received, SIMPOOL_SINK_ADDRESS, sink->received ? sink->latency / sink->received : 0.0);
+
+    // The node fibers never return, exit without unwinding them
+    fflush(stdout);
+    _exit(0);
+}
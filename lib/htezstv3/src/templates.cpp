@@ -349,7 +349,7 @@ String EZSettings::detail::getSettingsTemplate()
           </div>
           <div class="group">
             <label for="lora-tx-timeout">
-              TX Timeout (current: {VALUE_LORA_TX_TIMEOUT})
+              TX Timeout, 0 for auto (current: {VALUE_LORA_TX_TIMEOUT})
             </label>
             <input
               type="number"
@@ -49,8 +49,18 @@ void config()
   // config.fixLengthPayloadOn = false;
   // config.iqInversionOn = false;
   config.txOutPower = 12;
-  // config.txTimeout = 3000;
+  // config.txTimeout = 0;
   // config.rxTimeout = 0;
+  // config.binaryHeaderOn = true;
+  // config.ackTimeout = 0;
+  // config.maxRetries = 5;
+  // config.dutyCycle = 0;
+  // config.adrOn = false;
+  // config.arqWindow = 1;
+  // config.ackHoldTime = 0;
+  // config.csmaOn = false;
+  // config.channelCount = 0;
+  // config.channelPlan[0] = 902.3E6;
 
   // Apply the custom config
   lora.setConfig(config);
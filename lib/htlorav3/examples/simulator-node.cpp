@@ -0,0 +1,84 @@
+/**
+ * @file simulator-node.cpp
+ * @brief Example to run a HTLORAV3 node on Linux, on the RadioHead ether simulator
+ *
+ * Description:
+ *
+ * This example demonstrates how to use the `HTLORAV3TCP` radio backend.
+ * Each process is a node, it sends a reliable packet to the destination node every second and prints the latency of each one.
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/simBuild lib/htlorav3/examples/simulator-node.cpp
+ * lib/RadioHead/tools/etherSimulator.pl # in another window
+ * ./simulator-node 2   # node 2, only receives
+ * ./simulator-node 1 2 # node 1, sends to node 2
+ *
+ * Depends On:
+ * - htlorav3
+ * - RadioHead (RH_TCP, Linux only)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+// Include the HelTec LoRa V3 library and the ether simulator backend
+#include "htlorav3.h"
+#include "htlorav3tcp.h"
+
+// Declare the radio backend
+HTLORAV3TCP radio("localhost:4000");
+
+// Declare functions to receive events from the LoRa library
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+
+unsigned int destinationAddress = 0;
+unsigned long sendTimestamp = 0;
+int count = 0;
+
+void setup()
+{
+  unsigned int address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : 1;
+  destinationAddress = _simulator_argc > 2 ? atoi(_simulator_argv[2]) : 0;
+
+  printf("Simulator Node %u\n", address);
+
+  LoRa.setRadio(&radio);
+  LoRa.begin(address);
+
+  // Set the callback functions for the LoRa library
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  // Listen while there is nothing to send
+  LoRa.listenToPacket();
+}
+
+void loop()
+{
+  if (destinationAddress > 0 && (millis() - sendTimestamp) >= 1000)
+  {
+    char message[32];
+    snprintf(message, sizeof(message), "Packet %d", count++);
+
+    sendTimestamp = millis();
+    if (LoRa.sendReliablePacket(message, destinationAddress) != 0)
+      printf("Send queue full\n");
+  }
+
+  LoRa.process();
+}
+
+void onReceive(LoraDataPacket packet)
+{
+  printf("Received: %s\n", packet.data);
+
+  // Keep listening
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries)
+{
+  printf("To %u: %s after %lu ms and %d retries\n", destinationAddress, success ? "ACK" : "FAILED", millis() - sendTimestamp, retries);
+}
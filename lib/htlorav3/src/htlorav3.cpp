@@ -19,88 +19,189 @@
 
 #include "htlorav3.h"
 
-#define HTLORAV3_HEADER_SIZE 11
+#if defined(ARDUINO)
+#include "htlorav3sx1262.h"
+#endif
+
+// Reliable send states
+#define HTLORAV3_RELIABLE_WAITING_SEND 0
+#define HTLORAV3_RELIABLE_SENDING 1
+#define HTLORAV3_RELIABLE_WAITING_ACK 2
 
 // === Static variables ===
 
 // Node Control
 unsigned int HTLORAV3::_address = 0;
 HTLORAV3::LoRaStates HTLORAV3::_state = HTLORAV3::IDLE;
-int HTLORAV3::_currentPacketId = 0;
-
-// Ack Control
-bool HTLORAV3::_internalCallbacks = false;
-unsigned int HTLORAV3::_sendACKTo = 0;
-bool HTLORAV3::_ignorePacket = false;
-LoraDataPacket HTLORAV3::_lastPacket = {NULL, 0, 0, 0};
+HTLORAV3Config HTLORAV3::_config = HTLORAV3::getDefaultConfig();
+uint16_t HTLORAV3::_currentPacketId = 0;
+uint8_t HTLORAV3::_txBuffer[HTLORAV3_MAX_PACKET_SIZE];
+HTLORAV3::TxKinds HTLORAV3::_txKind = HTLORAV3::TX_NONE;
+HTLORAV3Timers HTLORAV3::_timers;
+
+// Reliable Send Control
+LoraReliableSend HTLORAV3::_reliableSends[HTLORAV3_MAX_RELIABLE_SENDS];
+uint32_t HTLORAV3::_reliableSendsSequence = 0;
+int HTLORAV3::_txReliableIndex = -1;
+unsigned int HTLORAV3::_burstAddress = 0;
+
+// Transmit Queue
+LoraTxQueueEntry HTLORAV3::_txQueue[2][HTLORAV3_TX_QUEUE_SIZE];
+int HTLORAV3::_txQueueHead[2] = {0, 0};
+int HTLORAV3::_txQueueCount[2] = {0, 0};
+unsigned int HTLORAV3::_txDestinationAddress = 0;
+uint16_t HTLORAV3::_txPacketId = 0;
+
+// Receive slots
+LoraReceiveSlot HTLORAV3::_receiveSlots[HTLORAV3_RX_POOL_SIZE];
+
+// Fragmentation
+LoraReassembly HTLORAV3::_reassemblies[HTLORAV3_MAX_REASSEMBLIES];
+uint8_t HTLORAV3::_currentMessageId = 0;
 
 // Receive Timeout
-unsigned long HTLORAV3::_receiveTimeoutMillis = 0;
-unsigned long HTLORAV3::_receiveTimeoutTimestamp = 0;
+bool HTLORAV3::_userListening = false;
 
 // Duplication packet check
-ReceivedPacketInfo HTLORAV3::_receivedPacketsList[10] = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
-int HTLORAV3::_receivedPacketsIndex = 0;
-int HTLORAV3::_receivedPacketsCount = 0;
+ReceivedPacketsWindow HTLORAV3::_receivedPackets[HTLORAV3_MAX_ADDRESS + 1];
+
+// Duty cycle (ETSI EN 300 220 sub-bands, the last band holds any other frequency)
+LoraDutyCycleBand HTLORAV3::_dutyCycleBands[HTLORAV3_DUTY_CYCLE_BANDS] = {
+    {433.05E6, 434.79E6, 100, 0, 0},
+    {863.0E6, 868.0E6, 10, 0, 0},
+    {868.0E6, 868.6E6, 10, 0, 0},
+    {868.7E6, 869.2E6, 1, 0, 0},
+    {869.4E6, 869.65E6, 100, 0, 0},
+    {869.7E6, 870.0E6, 10, 0, 0},
+    {0, 0, -1, 0, 0},
+};
+
+// Adaptive data rate
+LoraLinkQuality HTLORAV3::_links[HTLORAV3_MAX_NEIGHBOURS];
+int HTLORAV3::_modemSpreadingFactor = 0;
+bool HTLORAV3::_txModemPending = false;
+bool HTLORAV3::_channelPending = false;
+bool HTLORAV3::_modemPending = false;
+unsigned int HTLORAV3::_sessionAddress = 0;
+int HTLORAV3::_sessionSpreadingFactor = 0;
+
+// Channel hopping
+int HTLORAV3::_channel = -1;
+int HTLORAV3::_broadcastChannel = 0;
+
+// Metrics
+LoraMetrics HTLORAV3::_metrics;
+
+// CSMA/CA
+int HTLORAV3::_csmaExponent = HTLORAV3_CSMA_MIN_EXPONENT;
+int HTLORAV3::_csmaBusyCount = 0;
+bool HTLORAV3::_channelClear = false;
+unsigned long HTLORAV3::_channelTimestamp = 0;
 
 // Event handlers
 void (*HTLORAV3::_onReceive)(LoraDataPacket packet) = NULL;
 void (*HTLORAV3::_onReceiveTimeout)() = NULL;
 void (*HTLORAV3::_onSendDone)() = NULL;
 void (*HTLORAV3::_onSendTimeout)() = NULL;
-RadioEvents_t HTLORAV3::_RadioEvents;
+void (*HTLORAV3::_onReliableSendDone)(unsigned int destinationAddress, bool success, int retries) = NULL;
+void (*HTLORAV3::_onPacketSendDone)(unsigned int destinationAddress, uint16_t packetId, bool success) = NULL;
+void (*HTLORAV3::_onInterrupt)() = NULL;
+LoraRadioEvents HTLORAV3::_RadioEvents;
+
+// Radio backend (the board SX1262 by default)
+#if defined(ARDUINO)
+static HTLORAV3SX1262 _sx1262;
+HTLORAV3Radio *HTLORAV3::_radio = &_sx1262;
+#else
+HTLORAV3Radio *HTLORAV3::_radio = NULL;
+#endif
 
 // === Main Class ===
 
 HTLORAV3::HTLORAV3()
 {
+  static_assert(TIMER_COUNT <= HTLORAV3_MAX_TIMERS, "HTLORAV3_MAX_TIMERS is too small for the protocol timers");
+
   _config = getDefaultConfig();
   _state = IDLE;
   _currentPacketId = 0;
+  _txKind = TX_NONE;
+
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    _reliableSends[i].destinationAddress = 0;
+  _reliableSendsSequence = 0;
+  _txReliableIndex = -1;
+  _burstAddress = 0;
+
+  for (int i = 0; i < 2; i++)
+  {
+    _txQueueHead[i] = 0;
+    _txQueueCount[i] = 0;
+  }
+
+  _userListening = false;
 
-  _internalCallbacks = false;
-  _sendACKTo = 0;
-  _ignorePacket = false;
+  for (int i = 0; i <= HTLORAV3_MAX_ADDRESS; i++)
+  {
+    _receivedPackets[i].lastPacketId = 0;
+    _receivedPackets[i].window = 0;
+    _receivedPackets[i].timestamp = 0;
+  }
+
+  for (int i = 0; i < HTLORAV3_RX_POOL_SIZE; i++)
+  {
+    _receiveSlots[i].inUse = false;
+    _receiveSlots[i].retained = false;
+  }
 
-  _receiveTimeoutMillis = 0;
-  _receiveTimeoutTimestamp = 0;
+  for (int i = 0; i < HTLORAV3_MAX_REASSEMBLIES; i++)
+  {
+    _reassemblies[i].inUse = false;
+    _reassemblies[i].retained = false;
+  }
+  _currentMessageId = 0;
 
-  for (int i = 0; i < 10; i++)
+  // Start with the full budget, it's refilled from then on
+  for (int i = 0; i < HTLORAV3_DUTY_CYCLE_BANDS; i++)
   {
-    _receivedPacketsList[i].nodeAddress = 0;
-    _receivedPacketsList[i].packetId = 0;
+    _dutyCycleBands[i].budget = UINT32_MAX;
+    _dutyCycleBands[i].timestamp = 0;
   }
-  _receivedPacketsIndex = 0;
-  _receivedPacketsCount = 0;
+
+  for (int i = 0; i < HTLORAV3_MAX_NEIGHBOURS; i++)
+    _links[i].address = 0;
+  _modemSpreadingFactor = 0;
+  _sessionAddress = 0;
+
+  _csmaExponent = HTLORAV3_CSMA_MIN_EXPONENT;
+  _csmaBusyCount = 0;
+  _channelClear = false;
+
+  _timers.reset(0);
 }
 
-// Clear memory on deconstruction
 HTLORAV3::~HTLORAV3()
 {
   stop();
-
-  if (_lastPacket.data != NULL)
-  {
-    free(_lastPacket.data);
-    _lastPacket.data = NULL;
-  }
 }
 
 void HTLORAV3::begin(unsigned int address)
 {
-  _address = address;
+  if (_radio == NULL)
+    throw std::runtime_error("Radio backend is not set. Set it with setRadio() before begin().");
 
-  // Pass the board type and the slow clock type for Heltec Wifi LoRa 32 V3 Board
-  Mcu.begin(HELTEC_BOARD, SLOW_CLK_TPYE);
+  _address = address;
 
   // Bind Radio events
-  _RadioEvents.TxDone = _onTxDone;
-  _RadioEvents.TxTimeout = _onTxTimeout;
-  _RadioEvents.RxDone = _onRxDone;
-  _RadioEvents.RxTimeout = _onRxTimeout;
+  _RadioEvents.txDone = _onTxDone;
+  _RadioEvents.txTimeout = _onTxTimeout;
+  _RadioEvents.rxDone = _onRxDone;
+  _RadioEvents.rxTimeout = _onRxTimeout;
+  _RadioEvents.cadDone = _onCadDone;
 
-  // Initialize and configure Radio
-  Radio.Init(&_RadioEvents);
+  // Initialize the radio backend
+  _radio->setOnInterrupt(_onInterrupt);
+  _radio->begin(address, &_RadioEvents);
 
   // Initialize radio with config
   _initializeLora();
@@ -108,8 +209,31 @@ void HTLORAV3::begin(unsigned int address)
 
 void HTLORAV3::stop()
 {
-  Radio.Sleep();
+  // Also called on destruction, when no radio may have been set
+  if (_radio != NULL)
+    _radio->sleep();
+
   _state = IDLE;
+
+  if (_radio != NULL)
+    _retune();
+
+  // An interrupted reliable send attempt is sent again on `process()`
+  if (_txKind == TX_RELIABLE && _txReliableIndex >= 0)
+  {
+    _reliableSends[_txReliableIndex].state = HTLORAV3_RELIABLE_WAITING_SEND;
+    _timers.stop(TIMER_RELIABLE_SEND + _txReliableIndex);
+  }
+  _txKind = TX_NONE;
+  _txReliableIndex = -1;
+  _timers.stop(TIMER_TX);
+
+  // A detection in progress is dropped, the frame senses the channel again
+  _channelClear = false;
+  _timers.stop(TIMER_SENSING);
+
+  _userListening = false;
+  _timers.stop(TIMER_RECEIVE);
 }
 
 // === Getters ===
@@ -124,6 +248,72 @@ HTLORAV3::LoRaStates HTLORAV3::getState()
   return _state;
 }
 
+bool HTLORAV3::isListening()
+{
+  return _userListening;
+}
+
+uint16_t HTLORAV3::getLastPacketId()
+{
+  return _currentPacketId;
+}
+
+uint32_t HTLORAV3::getTimeOnAir(uint16_t frameSize, int spreadingFactor)
+{
+  // Semtech formula for SF7..SF12 (SX1262 datasheet 6.1.4), with CRC on as set on `_setModemSpreadingFactor()`
+  if (spreadingFactor <= 0)
+    spreadingFactor = _config.spreadingFactor;
+
+  uint32_t symbolTime = _getSymbolTime(spreadingFactor);
+
+  // Low data rate optimization is on for symbols longer than 16 ms
+  int lowDataRate = symbolTime > 16000 ? 1 : 0;
+  int implicitHeader = _config.fixLengthPayloadOn ? 1 : 0;
+
+  int32_t numerator = 8 * frameSize - 4 * spreadingFactor + 28 + 16 - 20 * implicitHeader;
+  int32_t denominator = 4 * (spreadingFactor - 2 * lowDataRate);
+
+  uint32_t payloadSymbols = 8;
+  if (numerator > 0)
+    payloadSymbols += ((numerator + denominator - 1) / denominator) * (_config.codingRate + 4);
+
+  // Preamble + 4.25 symbols, counted in quarters of symbol
+  uint32_t quarterSymbols = (_config.preambleLength + payloadSymbols) * 4 + 17;
+
+  return (quarterSymbols * symbolTime / 4 + 999) / 1000;
+}
+
+bool HTLORAV3::getLinkQuality(unsigned int address, LoraLinkQuality &linkQuality)
+{
+  LoraLinkQuality *link = _getLink(address, false);
+
+  if (link == NULL)
+    return false;
+
+  linkQuality = *link;
+  return true;
+}
+
+LoraMetrics HTLORAV3::getMetrics() const
+{
+  return _metrics;
+}
+
+void HTLORAV3::resetMetrics()
+{
+  memset(&_metrics, 0, sizeof(_metrics));
+}
+
+uint32_t HTLORAV3::getAirTimeBudget()
+{
+  LoraDutyCycleBand *band = _getDutyCycleBand(_getHomeChannel(_address));
+
+  if (band == NULL)
+    return UINT32_MAX;
+
+  return band->budget / 1000;
+}
+
 HTLORAV3Config HTLORAV3::getDefaultConfig()
 {
   HTLORAV3Config defaultConfig;
@@ -136,8 +326,20 @@ HTLORAV3Config HTLORAV3::getDefaultConfig()
   defaultConfig.fixLengthPayloadOn = false;
   defaultConfig.iqInversionOn = false;
   defaultConfig.txOutPower = 22;
-  defaultConfig.txTimeout = 3000;
+  defaultConfig.txTimeout = 0;
   defaultConfig.rxTimeout = 0;
+  defaultConfig.binaryHeaderOn = true;
+  defaultConfig.ackTimeout = 0;
+  defaultConfig.maxRetries = 5;
+  defaultConfig.dutyCycle = 0;
+  defaultConfig.adrOn = false;
+  defaultConfig.arqWindow = 1;
+  defaultConfig.ackHoldTime = 0;
+  defaultConfig.csmaOn = false;
+  defaultConfig.channelCount = 0;
+
+  for (int i = 0; i < HTLORAV3_MAX_CHANNELS; i++)
+    defaultConfig.channelPlan[i] = 0;
 
   return defaultConfig;
 }
@@ -149,13 +351,54 @@ void HTLORAV3::setConfig(const HTLORAV3Config &config)
   _config = config;
 }
 
+void HTLORAV3::setRadio(HTLORAV3Radio *radio)
+{
+  _radio = radio;
+}
+
 void HTLORAV3::updateConfig(const HTLORAV3Config &config)
 {
-  stop();
+  // Not started yet, the whole config is applied on `begin()`
+  if (_radio == NULL)
+  {
+    setConfig(config);
+    return;
+  }
+
+  HTLORAV3Config previous = _config;
+
+  bool channelChanged =
+      config.frequency != previous.frequency ||
+      config.channelCount != previous.channelCount ||
+      memcmp(config.channelPlan, previous.channelPlan, sizeof(config.channelPlan)) != 0;
+
+  bool modemChanged =
+      config.bandwidth != previous.bandwidth ||
+      config.spreadingFactor != previous.spreadingFactor ||
+      config.codingRate != previous.codingRate ||
+      config.preambleLength != previous.preambleLength ||
+      config.fixLengthPayloadOn != previous.fixLengthPayloadOn ||
+      config.iqInversionOn != previous.iqInversionOn ||
+      config.rxTimeout != previous.rxTimeout;
+
+  bool txModemChanged =
+      config.txOutPower != previous.txOutPower ||
+      config.txTimeout != previous.txTimeout;
 
   setConfig(config);
 
-  _initializeLora();
+  _channelPending = _channelPending || channelChanged;
+  _modemPending = _modemPending || modemChanged;
+
+  // A frame or a detection on the air can't be retuned, it goes on and the radio is retuned once idle
+  if (_state != SENDING && _state != SENSING)
+    _retune();
+
+  if (!modemChanged && txModemChanged)
+    _txModemPending = true; // Applied right before the next frame, listening goes on meanwhile
+
+  // Back to listening (or sending) right away if the radio had to leave receive mode
+  _processTransmissions();
 }
 
 void HTLORAV3::setOnReceive(void (*onReceive)(LoraDataPacket packet))
@@ -178,347 +421,1819 @@ void HTLORAV3::setOnSendTimeout(void (*onSendTimeout)())
   _onSendTimeout = onSendTimeout;
 }
 
-// === Handlers ===
+void HTLORAV3::setOnReliableSendDone(void (*onReliableSendDone)(unsigned int destinationAddress, bool success, int retries))
+{
+  _onReliableSendDone = onReliableSendDone;
+}
 
-void HTLORAV3::process()
+void HTLORAV3::setOnPacketSendDone(void (*onPacketSendDone)(unsigned int destinationAddress, uint16_t packetId, bool success))
 {
-  Mcu.timerhandler();
-  Radio.IrqProcess();
+  _onPacketSendDone = onPacketSendDone;
+}
 
-  if (
-      _receiveTimeoutTimestamp > 0 &&
-      _receiveTimeoutMillis > 0 &&
-      ((millis() - _receiveTimeoutTimestamp) >= _receiveTimeoutMillis))
+void HTLORAV3::setOnInterrupt(void (*onInterrupt)())
+{
+  _onInterrupt = onInterrupt;
+
+  if (_radio != NULL)
+    _radio->setOnInterrupt(onInterrupt);
+}
+
+// === Packet Ownership ===
+
+bool HTLORAV3::retainPacket(const LoraDataPacket &packet)
+{
+  if (packet.slot >= HTLORAV3_RX_POOL_SIZE && packet.slot < HTLORAV3_RX_POOL_SIZE + HTLORAV3_MAX_REASSEMBLIES)
   {
-    _receiveTimeoutTimestamp = 0;
-    _receiveTimeoutMillis = 0;
-    _onRxTimeout();
-    return;
+    LoraReassembly &reassembly = _reassemblies[packet.slot - HTLORAV3_RX_POOL_SIZE];
+
+    if (!reassembly.inUse)
+      return false;
+
+    reassembly.retained = true;
+    return true;
   }
 
-  if (_internalCallbacks && _state == IDLE && _sendACKTo > 0)
+  if (packet.slot < 0 || packet.slot >= HTLORAV3_RX_POOL_SIZE || !_receiveSlots[packet.slot].inUse)
+    return false;
+
+  _receiveSlots[packet.slot].retained = true;
+  return true;
+}
+
+void HTLORAV3::releasePacket(LoraDataPacket &packet)
+{
+  if (packet.slot >= 0 && packet.slot < HTLORAV3_RX_POOL_SIZE)
+  {
+    _receiveSlots[packet.slot].retained = false;
+    _receiveSlots[packet.slot].inUse = false;
+  }
+  else if (packet.slot >= HTLORAV3_RX_POOL_SIZE && packet.slot < HTLORAV3_RX_POOL_SIZE + HTLORAV3_MAX_REASSEMBLIES)
   {
-    delay(50); // Wait while the destiny enters in listen mode
-    _sendReliablePacket("ACK", _sendACKTo);
-    if (_ignorePacket)
-      _ignorePacket = false;
-    else if (_onReceive != NULL)
-      _onReceive(_lastPacket);
+    _reassemblies[packet.slot - HTLORAV3_RX_POOL_SIZE].retained = false;
+    _reassemblies[packet.slot - HTLORAV3_RX_POOL_SIZE].inUse = false;
   }
+
+  packet.data = NULL;
+  packet.slot = -1;
 }
 
-int HTLORAV3::sendPacket(const char *data, unsigned int destinationAddress)
+// === Handlers ===
+
+uint32_t HTLORAV3::process()
 {
-  if (_internalCallbacks)
-    return 1; // User send packet returns busy if in internal callbacks
+  _radio->process();
+
+  int timer;
+  while ((timer = _timers.advance(millis())) >= 0)
+    _onTimer(timer);
+
+  _processTransmissions();
 
-  return _sendPacket(data, destinationAddress);
+  return _timers.getTimeToNext(millis());
 }
 
-int HTLORAV3::_sendPacket(const char *data, unsigned int destinationAddress)
+int HTLORAV3::sendPacket(const char *data, unsigned int destinationAddress, TxPriorities priority)
 {
-  if (_state != IDLE)
-    return 1;
+  return sendPacket((const uint8_t *)data, strlen(data), destinationAddress, priority);
+}
 
-  _currentPacketId++;
-  if (_currentPacketId > 99)
-    _currentPacketId = 1;
+int HTLORAV3::sendPacket(const uint8_t *data, size_t size, unsigned int destinationAddress, TxPriorities priority)
+{
+  uint16_t dataSize = _getDataSize(data, size);
 
-  // Create header with padded node origin address (3 chars) destination address (3 chars) and packet id (2 chars)
-  char header[HTLORAV3_HEADER_SIZE + 1]; // headerSize + '\0'
-  sprintf(header, "%03d-%03d-%02d|", _address, destinationAddress, _currentPacketId);
+  LoraTxQueueEntry *entry = _enqueueFrame(priority);
 
-  String preparedData = String(header) + String(data);
+  if (entry == NULL)
+    return 1;
 
-  Radio.Send((uint8_t *)preparedData.c_str(), preparedData.length());
+  memcpy(entry->data, data, dataSize);
+  entry->dataSize = dataSize;
+  entry->destinationAddress = destinationAddress;
+  entry->packetId = _nextPacketId();
+  entry->flags = 0;
+  entry->binaryHeader = _config.binaryHeaderOn;
+  entry->ack = false;
+  entry->spreadingFactor = 0; // Not acknowledged, the destination may not be on a session
 
-  _state = SENDING;
+  // Send right away if the radio is free
+  _processTransmissions();
 
   return 0;
 }
 
 int HTLORAV3::sendReliablePacket(const char *data, unsigned int destinationAddress)
+{
+  return sendReliablePacket((const uint8_t *)data, strlen(data), destinationAddress);
+}
+
+int HTLORAV3::sendReliablePacket(const uint8_t *data, size_t size, unsigned int destinationAddress)
 {
   if (destinationAddress != 0 && _address == 0)
     throw std::runtime_error("Address is not set. To send packets to certain address, set the address in both nodes first.");
 
-  if (_internalCallbacks)
-    return 1; // User send reliable packet returns busy if in internal callbacks
+  if (destinationAddress <= 0)
+    throw std::runtime_error("Broadcast is not allowed on sendRealiablePacket.");
+
+  if (size > 0 && data[0] == 0)
+    throw std::runtime_error("Packet data can't start with a zero byte, it marks fragments.");
+
+  size_t dataSize = size;
+  uint8_t headerSize = _getHeaderSize(_config.binaryHeaderOn);
+
+  if (dataSize > HTLORAV3_MAX_MESSAGE_SIZE)
+    throw std::runtime_error("Packet data is too large to be sent, even in fragments.");
+
+  // Data larger than a frame is sent in fragments that fill the frames
+  uint16_t fragmentSize = HTLORAV3_MAX_PACKET_SIZE - headerSize - HTLORAV3_FRAGMENT_HEADER_SIZE;
+  int fragmentCount = dataSize + headerSize > HTLORAV3_MAX_PACKET_SIZE ? (dataSize + fragmentSize - 1) / fragmentSize : 0;
+
+  int freeCount = 0;
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    if (_reliableSends[i].destinationAddress == 0)
+      freeCount++;
+
+  if (freeCount < (fragmentCount > 0 ? fragmentCount : 1))
+    return 1;
+
+  uint8_t messageId = fragmentCount > 0 ? ++_currentMessageId : 0;
+  int fragment = 0;
+
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS && fragment < (fragmentCount > 0 ? fragmentCount : 1); i++)
+  {
+    LoraReliableSend &reliableSend = _reliableSends[i];
+
+    if (reliableSend.destinationAddress != 0)
+      continue;
+
+    if (fragmentCount > 0)
+    {
+      uint16_t offset = fragment * fragmentSize;
+      uint16_t size = dataSize - offset < fragmentSize ? dataSize - offset : fragmentSize;
+
+      reliableSend.data[0] = 0; // Fragment marker, packet data never starts with it
+      reliableSend.data[1] = messageId;
+      reliableSend.data[2] = fragment;
+      reliableSend.data[3] = fragmentCount;
+      memcpy(reliableSend.data + HTLORAV3_FRAGMENT_HEADER_SIZE, data + offset, size);
+      reliableSend.dataSize = HTLORAV3_FRAGMENT_HEADER_SIZE + size;
+    }
+    else
+    {
+      memcpy(reliableSend.data, data, dataSize);
+      reliableSend.dataSize = dataSize;
+    }
 
-  return _sendReliablePacket(data, destinationAddress);
+    reliableSend.destinationAddress = destinationAddress;
+    reliableSend.packetId = _nextPacketId();
+    reliableSend.sequence = _reliableSendsSequence++;
+    reliableSend.spreadingFactor = _config.spreadingFactor;
+    reliableSend.messageId = messageId;
+    reliableSend.fragmentCount = fragmentCount;
+    reliableSend.attempts = 0;
+    reliableSend.sendTimedOut = false;
+    reliableSend.timestamp = millis();
+    reliableSend.state = HTLORAV3_RELIABLE_WAITING_SEND;
+    _timers.start(TIMER_RELIABLE_SEND + i, millis(), _getBackoff(headerSize + reliableSend.dataSize, 0)); // Minimize packet colision
+
+    fragment++;
+  }
+
+  return 0;
 }
 
-int HTLORAV3::_sendReliablePacket(const char *data, unsigned int destinationAddress)
+int HTLORAV3::listenToPacket(uint32_t timeout)
 {
-  if (destinationAddress <= 0)
-    throw std::runtime_error("Broadcast is not allowed on sendRealiablePacket.");
-
-  if (_state != IDLE)
+  if (_userListening)
     return 1;
 
-  bool acked = strcmp(data, "ACK") == 0;
+  _userListening = true;
 
-  _internalCallbacks = true;
+  if (timeout > 0)
+    _timers.start(TIMER_RECEIVE, millis(), timeout);
 
-  // TODO: implementar max resend
-  // TODO: Ajustar melhor timeouts e tries threshold
-  // int reliableSendTries = 0;
-  int ackTimeoutTries;
-  const int maxAckTries = 5;
-  do
+  // If the radio is sending, listening starts right after it on `process()`
+  if (_state == IDLE)
   {
-    ackTimeoutTries = 0;
+    _setChannel(_getListenChannel());
+    _setModemSpreadingFactor(_getListenSpreadingFactor());
+    _state = RECEIVING;
+    _radio->receive(0);
+  }
 
-    do
-    {
-      _state = IDLE;
-      randomSeed(millis());
-      delay(random(0, 500)); // Minimize packet colision
-      _sendPacket(data, destinationAddress);
+  return 0;
+}
 
-      while (_state == SENDING)
-        process();
+void HTLORAV3::_onACK(unsigned int originAddress, uint16_t packetId, const uint8_t *bitmap, bool legacyHeader, int rate)
+{
+  LoraLinkQuality *link = _getLink(originAddress, false);
 
-    } while (_state == SEND_TIMEOUT);
+  if (bitmap != NULL)
+  {
+    uint32_t window = ((uint32_t)bitmap[0] << 24) | ((uint32_t)bitmap[1] << 16) | ((uint32_t)bitmap[2] << 8) | bitmap[3];
 
-    if (acked)
-      return 0;
+    if (link != NULL)
+    {
+      link->loss -= link->loss / 4;
+      link->spreadingFactor = rate;
+      link->sessionTimestamp = millis();
+    }
 
-    do
+    for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
     {
-      _state = IDLE;
-      randomSeed(millis());
-      _listenToPacket(500);
+      LoraReliableSend &reliableSend = _reliableSends[i];
 
-      while (_state == RECEIVING)
-        process();
+      if (reliableSend.destinationAddress != originAddress || reliableSend.attempts == 0)
+        continue;
 
-      if (_state == RECEIVE_TIMEOUT)
-        ackTimeoutTries++;
-    } while (_state == RECEIVE_TIMEOUT && ackTimeoutTries < maxAckTries);
-    // reliableSendTries++;
-  } while (ackTimeoutTries >= maxAckTries);
+      // Distance from the highest packet id received by the destination
+      int16_t age = (int16_t)(packetId - reliableSend.packetId);
 
-  if (_onSendDone != NULL)
-    _onSendDone();
+      if (age < 0 || age >= HTLORAV3_DEDUP_WINDOW)
+        continue; // Newer than the ACK or out of the bitmap, wait for the ACK timeout
 
-  return 0;
+      if ((window >> age) & 1)
+        _finishReliableSend(i, true);
+      else if (reliableSend.state == HTLORAV3_RELIABLE_WAITING_ACK)
+        _timers.start(TIMER_RELIABLE_SEND + i, millis(), 0); // A later packet arrived but not this one, send it again on `process()`
+    }
+    return;
+  }
+
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+  {
+    // Legacy ACKs don't carry the acknowledged packet id, only the oldest packet to a destination is ever sent
+    if (_reliableSends[i].destinationAddress == originAddress &&
+        _reliableSends[i].attempts > 0 &&
+        (legacyHeader || _reliableSends[i].packetId == packetId))
+    {
+      // The ACK carries the spreading factor accepted for the next frames
+      if (link != NULL)
+      {
+        link->loss -= link->loss / 4;
+        link->spreadingFactor = rate;
+        link->sessionTimestamp = millis();
+      }
+
+      _finishReliableSend(i, true);
+      break;
+    }
+  }
 }
 
-int HTLORAV3::listenToPacket(uint32_t timeout)
+int16_t HTLORAV3::_getPacketIdAge(uint16_t lastPacketId, uint16_t packetId, bool legacyHeader)
 {
-  if (_internalCallbacks)
-    return 1; // User send packet returns busy if in internal callbacks
+  // Binary ids wrap at 16 bits
+  if (!legacyHeader)
+    return (int16_t)(lastPacketId - packetId);
 
-  return _listenToPacket(timeout);
+  // Legacy ids go from 1 to 99 and wrap, half of the cycle is taken as older, the other half as newer
+  int age = ((int)lastPacketId - (int)packetId) % 99;
+  if (age < 0)
+    age += 99;
+
+  return age > 49 ? age - 99 : age;
 }
 
-int HTLORAV3::_listenToPacket(uint32_t timeout)
+uint32_t HTLORAV3::_getSequenceTimeout(int spreadingFactor)
 {
-  if (_state != IDLE)
-    return 1;
+  // Every attempt of a reliable send: the largest frame, its ACK timeout and a backoff of about as long
+  return (_config.maxRetries + 1) * 2 * (getTimeOnAir(HTLORAV3_MAX_PACKET_SIZE, spreadingFactor) + _getACKTimeout(spreadingFactor));
+}
 
-  _receiveTimeoutMillis = timeout;
-  _receiveTimeoutTimestamp = millis();
+bool HTLORAV3::_isDuplicatedPacket(unsigned int nodeAddress, uint16_t packetId, bool legacyHeader)
+{
+  if (nodeAddress > HTLORAV3_MAX_ADDRESS)
+    return false;
 
-  _state = RECEIVING;
-  Radio.Rx(0);
+  const ReceivedPacketsWindow &received = _receivedPackets[nodeAddress];
 
-  return 0;
+  if (received.window == 0)
+    return false;
+
+  int16_t age = _getPacketIdAge(received.lastPacketId, packetId, legacyHeader);
+
+  if (age < 0)
+    return false;
+
+  // Older than the window: a late retry of a packet already passed, unless the origin was silent for longer than any
+  // reliable send retries, then it restarted its sequence
+  if (age >= HTLORAV3_DEDUP_WINDOW)
+    return millis() - received.timestamp < _getSequenceTimeout(_modemSpreadingFactor);
+
+  return (received.window >> age) & 1;
 }
 
-bool HTLORAV3::_isPacketInBuffer(unsigned int nodeAddress, unsigned int packetId)
+void HTLORAV3::_markPacketReceived(unsigned int nodeAddress, uint16_t packetId, bool legacyHeader)
 {
-  if (_receivedPacketsCount == 0)
-    return false;
+  if (nodeAddress > HTLORAV3_MAX_ADDRESS)
+    return;
 
-  // Search through all packets in the circular buffer
-  for (int i = 0; i < _receivedPacketsCount; i++)
+  ReceivedPacketsWindow &received = _receivedPackets[nodeAddress];
+
+  int16_t age = _getPacketIdAge(received.lastPacketId, packetId, legacyHeader);
+  received.timestamp = millis();
+
+  if (received.window == 0 || age >= HTLORAV3_DEDUP_WINDOW)
+  {
+    // First packet or a new sequence (`_isDuplicatedPacket()` found the origin restarted)
+    received.lastPacketId = packetId;
+    received.window = 1;
+  }
+  else if (age < 0)
   {
-    int index;
-    if (_receivedPacketsCount < 10) // Buffer not full yet, packets are stored sequentially from index 0
-      index = i;
-    else // Buffer is full and circular, start from the oldest packet
-      index = (_receivedPacketsIndex + i) % 10;
+    // Newer packet, slide the window
+    int shift = -age;
+    received.window = shift >= HTLORAV3_DEDUP_WINDOW ? 0 : received.window << shift;
+    received.window |= 1;
+    received.lastPacketId = packetId;
+  }
+  else
+    received.window |= (uint32_t)1 << age;
+}
 
-    if (_receivedPacketsList[index].nodeAddress == nodeAddress &&
-        _receivedPacketsList[index].packetId == packetId)
-      return true;
+uint8_t HTLORAV3::_encodeHeader(uint8_t *buffer, const LoraHeader &header, bool binary)
+{
+  if (!binary)
+  {
+    // Padded node origin address (3 chars) destination address (3 chars) and packet id (2 chars)
+    // Addresses are up to 999 and legacy ids up to 99, the modulos only let the compiler see the fields fit
+    char legacyHeader[HTLORAV3_LEGACY_HEADER_SIZE + 1]; // headerSize + '\0'
+    snprintf(legacyHeader, sizeof(legacyHeader), "%03u-%03u-%02u|", header.originAddress % 1000, header.destinationAddress % 1000, header.packetId % 100);
+    memcpy(buffer, legacyHeader, HTLORAV3_LEGACY_HEADER_SIZE);
+    return HTLORAV3_LEGACY_HEADER_SIZE;
   }
 
-  return false;
-}
+  buffer[0] = header.flags | HTLORAV3_FLAG_BINARY;
+  buffer[1] = (header.originAddress >> 4) & 0xFF;
+  buffer[2] = ((header.originAddress & 0x0F) << 4) | ((header.destinationAddress >> 8) & 0x0F);
+  buffer[3] = header.destinationAddress & 0xFF;
+  buffer[4] = header.packetId >> 8;
+  buffer[5] = header.packetId & 0xFF;
 
-// === Private Handlers ===
+  return HTLORAV3_BINARY_HEADER_SIZE;
+}
 
-void HTLORAV3::_initializeLora()
+uint8_t HTLORAV3::_decodeHeader(const uint8_t *payload, uint16_t size, LoraHeader &header)
 {
-  Radio.SetChannel(_config.frequency);
-
-  Radio.SetTxConfig(
-      MODEM_LORA,
-      _config.txOutPower,
-      0,
-      _config.bandwidth,
-      _config.spreadingFactor,
-      _config.codingRate,
-      _config.preambleLength,
-      _config.fixLengthPayloadOn,
-      true,
-      0,
-      0,
-      _config.iqInversionOn,
-      _config.txTimeout);
-
-  Radio.SetRxConfig(
-      MODEM_LORA,
-      _config.bandwidth,
-      _config.spreadingFactor,
-      _config.codingRate,
-      0,
-      _config.preambleLength,
-      _config.rxTimeout,
-      _config.fixLengthPayloadOn,
-      0,
-      true,
-      0,
-      0,
-      _config.iqInversionOn,
-      true);
+  if (size >= HTLORAV3_BINARY_HEADER_SIZE && (payload[0] & HTLORAV3_FLAG_BINARY))
+  {
+    header.flags = payload[0] & ~HTLORAV3_FLAG_BINARY;
+    header.originAddress = (payload[1] << 4) | (payload[2] >> 4);
+    header.destinationAddress = ((payload[2] & 0x0F) << 8) | payload[3];
+    header.packetId = (payload[4] << 8) | payload[5];
+    return HTLORAV3_BINARY_HEADER_SIZE;
+  }
+
+  // Legacy header format: XXX-XXX-XX|
+  if (size < HTLORAV3_LEGACY_HEADER_SIZE || payload[3] != '-' || payload[7] != '-' || payload[10] != '|')
+    return 0;
+
+  int originAddress = _parseDigits(payload, 3);
+  int destinationAddress = _parseDigits(payload + 4, 3);
+  int packetId = _parseDigits(payload + 8, 2);
+
+  if (originAddress < 0 || destinationAddress < 0 || packetId < 0)
+    return 0;
+
+  header.flags = 0;
+  header.originAddress = originAddress;
+  header.destinationAddress = destinationAddress;
+  header.packetId = packetId;
+  return HTLORAV3_LEGACY_HEADER_SIZE;
 }
 
-void HTLORAV3::_onTxDone()
+int HTLORAV3::_parseDigits(const uint8_t *str, uint8_t length)
 {
-  if (_onSendDone != NULL && !_internalCallbacks)
-    _onSendDone();
+  int value = 0;
 
-  if (_sendACKTo > 0)
+  for (uint8_t i = 0; i < length; i++)
   {
-    _internalCallbacks = false;
-    _sendACKTo = 0;
+    if (str[i] < '0' || str[i] > '9')
+      return -1;
+
+    value = value * 10 + (str[i] - '0');
   }
 
-  _state = IDLE;
+  return value;
 }
 
-void HTLORAV3::_onTxTimeout()
+int HTLORAV3::_acquireSlot()
 {
-  Radio.Sleep();
-  _state = _internalCallbacks ? SEND_TIMEOUT : IDLE;
+  for (int i = 0; i < HTLORAV3_RX_POOL_SIZE; i++)
+  {
+    if (!_receiveSlots[i].inUse)
+    {
+      _receiveSlots[i].inUse = true;
+      _receiveSlots[i].retained = false;
+      return i;
+    }
+  }
 
-  if (_onSendTimeout != NULL && !_internalCallbacks)
-    _onSendTimeout();
+  return -1;
 }
 
-void HTLORAV3::_onRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
+void HTLORAV3::_releaseSlot(int slot)
+{
+  if (slot >= HTLORAV3_RX_POOL_SIZE && slot < HTLORAV3_RX_POOL_SIZE + HTLORAV3_MAX_REASSEMBLIES)
+  {
+    if (!_reassemblies[slot - HTLORAV3_RX_POOL_SIZE].retained)
+      _reassemblies[slot - HTLORAV3_RX_POOL_SIZE].inUse = false;
+    return;
+  }
+
+  if (slot < 0 || slot >= HTLORAV3_RX_POOL_SIZE || _receiveSlots[slot].retained)
+    return;
+
+  _receiveSlots[slot].inUse = false;
+}
+
+int HTLORAV3::_storeFragment(unsigned int originAddress, const uint8_t *fragment, uint16_t size, uint8_t headerSize)
 {
-  int originAddress = -1;
-  int destinationAddress = -1;
-  int packetId = -1;
-  bool hasHeader = false;
+  uint8_t messageId = fragment[1];
+  uint8_t index = fragment[2];
+  uint8_t fragmentCount = fragment[3];
+
+  // Every fragment but the last fills the frame
+  uint16_t fragmentSize = HTLORAV3_MAX_PACKET_SIZE - headerSize - HTLORAV3_FRAGMENT_HEADER_SIZE;
+  uint16_t dataSize = size - HTLORAV3_FRAGMENT_HEADER_SIZE;
+  uint16_t offset = index * fragmentSize;
 
-  // Extract header if present
-  if (size >= HTLORAV3_HEADER_SIZE)
+  if (
+      fragmentCount == 0 ||
+      fragmentCount > HTLORAV3_MAX_FRAGMENTS ||
+      index >= fragmentCount ||
+      (index < fragmentCount - 1 && dataSize != fragmentSize) ||
+      offset + dataSize > HTLORAV3_MAX_MESSAGE_SIZE)
+    return -1;
+
+  int freeIndex = -1;
+  int reassemblyIndex = -1;
+  for (int i = 0; i < HTLORAV3_MAX_REASSEMBLIES && reassemblyIndex < 0; i++)
   {
-    char header[HTLORAV3_HEADER_SIZE + 1];
-    memcpy(header, payload, HTLORAV3_HEADER_SIZE);
-    header[HTLORAV3_HEADER_SIZE] = '\0';
+    LoraReassembly &reassembly = _reassemblies[i];
 
-    // Parse header format: XXX-XXX-XX|
-    if (header[3] == '-' && header[7] == '-' && header[10] == '|')
+    if (!reassembly.inUse)
     {
-      hasHeader = true;
-      char originAddressStr[4] = {header[0], header[1], header[2], '\0'};
-      char destinationAddressStr[4] = {header[4], header[5], header[6], '\0'};
-      char packetIdStr[3] = {header[8], header[9], '\0'};
-
-      originAddress = atoi(originAddressStr);
-      destinationAddress = atoi(destinationAddressStr);
-      packetId = atoi(packetIdStr);
+      if (freeIndex < 0)
+        freeIndex = i;
     }
+    else if (
+        reassembly.originAddress == originAddress &&
+        reassembly.messageId == messageId &&
+        reassembly.fragmentCount == fragmentCount &&
+        !_isReassembled(reassembly))
+      reassemblyIndex = i;
   }
 
-  if (destinationAddress > 0 && destinationAddress != _address)
-    return; // Packet not for this node
+  if (reassemblyIndex < 0)
+  {
+    if (freeIndex < 0)
+      return -1; // All buffers busy, the sender will retry
+
+    reassemblyIndex = freeIndex;
+
+    LoraReassembly &reassembly = _reassemblies[reassemblyIndex];
+    reassembly.inUse = true;
+    reassembly.retained = false;
+    reassembly.originAddress = originAddress;
+    reassembly.messageId = messageId;
+    reassembly.fragmentCount = fragmentCount;
+    reassembly.received = 0;
+    reassembly.size = 0;
+  }
 
-  bool packetInBuffer = _isPacketInBuffer(originAddress, packetId);
+  LoraReassembly &reassembly = _reassemblies[reassemblyIndex];
 
-  if (packetInBuffer)
-    _ignorePacket = true;
-  else
+  memcpy(reassembly.data + offset, fragment + HTLORAV3_FRAGMENT_HEADER_SIZE, dataSize);
+  reassembly.received |= (uint32_t)1 << index;
+  _timers.start(TIMER_REASSEMBLY + reassemblyIndex, millis(), HTLORAV3_REASSEMBLY_TIMEOUT);
+
+  // The last fragment gives the message size
+  if (index == fragmentCount - 1)
   {
-    _receiveTimeoutMillis = 0;
-    _receiveTimeoutTimestamp = 0;
+    reassembly.size = offset + dataSize;
+    reassembly.data[reassembly.size] = '\0';
   }
 
-  uint16_t dataSize = hasHeader ? (size - HTLORAV3_HEADER_SIZE) : size;
-  uint16_t dataOffset = hasHeader ? HTLORAV3_HEADER_SIZE : 0;
+  return reassemblyIndex;
+}
 
-  LoraDataPacket packet;
-  packet.data = (char *)malloc(dataSize + 1);
+bool HTLORAV3::_isReassembled(const LoraReassembly &reassembly)
+{
+  uint32_t complete = reassembly.fragmentCount >= 32 ? UINT32_MAX : ((uint32_t)1 << reassembly.fragmentCount) - 1;
 
-  if (packet.data == NULL)
-    throw std::runtime_error("Not enough memory to receive packet.");
+  return reassembly.received == complete;
+}
 
-  packet.rssi = rssi;
-  packet.size = dataSize;
-  packet.snr = snr;
+void HTLORAV3::_deliverPacket(LoraDataPacket &packet)
+{
+  if (_onReceive != NULL && packet.data != NULL)
+    _onReceive(packet);
 
-  // Copy only the data without the header
-  memcpy(packet.data, payload + dataOffset, dataSize);
-  packet.data[dataSize] = '\0';
+  _releaseSlot(packet.slot);
+  packet.data = NULL;
+  packet.slot = -1;
+}
 
-  bool acked = strcmp(packet.data, "ACK") == 0;
+// === Private Handlers ===
 
-  if (destinationAddress > 0)
-  {
-    _internalCallbacks = !acked;
-    _sendACKTo = acked ? 0 : originAddress;
-  }
+void HTLORAV3::_initializeLora()
+{
+  _channelPending = false;
+  _modemPending = false;
 
-  if (destinationAddress > 0 && !acked)
-  {
-    if (_lastPacket.data != NULL)
-      free(_lastPacket.data);
+  _channel = -1;
+  _broadcastChannel = 0;
+  _setChannel(_getHomeChannel(_address));
 
-    _lastPacket.data = (char *)malloc(dataSize + 1);
-    if (_lastPacket.data != NULL)
-    {
-      memcpy(_lastPacket.data, packet.data, dataSize + 1);
-      _lastPacket.rssi = packet.rssi;
-      _lastPacket.size = packet.size;
-      _lastPacket.snr = packet.snr;
-    }
+  _modemSpreadingFactor = 0;
+  _setModemSpreadingFactor(_config.spreadingFactor);
+}
 
-    // Store packet info in the list (only if we have valid header info)
-    if (hasHeader && originAddress != -1 && packetId != -1 && !packetInBuffer)
-    {
-      _receivedPacketsList[_receivedPacketsIndex].nodeAddress = originAddress;
-      _receivedPacketsList[_receivedPacketsIndex].packetId = packetId;
+void HTLORAV3::_setModemSpreadingFactor(int spreadingFactor)
+{
+  if (spreadingFactor <= 0)
+    spreadingFactor = _config.spreadingFactor;
 
-      // Update circular buffer index
-      _receivedPacketsIndex = (_receivedPacketsIndex + 1) % 10;
+  if (spreadingFactor == _modemSpreadingFactor)
+    return;
 
-      // Update count (max 10)
-      if (_receivedPacketsCount < 10)
-        _receivedPacketsCount++;
-    }
+  // The radio is reconfigured out of receive mode
+  if (_state == RECEIVING)
+  {
+    _radio->sleep();
+    _state = IDLE;
   }
 
-  Radio.Sleep();
+  _modemSpreadingFactor = spreadingFactor;
+  _txModemPending = false;
 
-  if (_onReceive != NULL && !_internalCallbacks && !acked)
-    _onReceive(packet);
+  _radio->setModem(_getModemConfig(spreadingFactor));
+}
 
-  free(packet.data);
-  _state = IDLE;
+LoraModemConfig HTLORAV3::_getModemConfig(int spreadingFactor)
+{
+  LoraModemConfig modem;
+  modem.txOutPower = _config.txOutPower;
+  modem.bandwidth = _config.bandwidth;
+  modem.spreadingFactor = spreadingFactor;
+  modem.codingRate = _config.codingRate;
+  modem.preambleLength = _config.preambleLength;
+  modem.fixLengthPayloadOn = _config.fixLengthPayloadOn;
+  modem.iqInversionOn = _config.iqInversionOn;
+  modem.txTimeout = _getTxTimeout();
+  modem.rxTimeout = _config.rxTimeout;
+
+  return modem;
 }
 
-void HTLORAV3::_onRxTimeout()
+void HTLORAV3::_setChannel(int channel)
 {
-  _state = _internalCallbacks ? RECEIVE_TIMEOUT : IDLE;
+  if (channel == _channel)
+    return;
 
-  if (_onReceiveTimeout != NULL && !_internalCallbacks)
-    _onReceiveTimeout();
+  // The radio is tuned out of receive mode
+  if (_state == RECEIVING)
+  {
+    _radio->sleep();
+    _state = IDLE;
+  }
+
+  _channel = channel;
+  _radio->setChannel(_getChannelFrequency(channel));
+}
+
+bool HTLORAV3::_retune()
+{
+  if (!_channelPending && !_modemPending)
+    return false;
+
+  if (_channelPending)
+  {
+    _channelPending = false;
+    _channel = -1;
+    _broadcastChannel = 0;
+    _setChannel(_getListenChannel());
+  }
+
+  if (_modemPending)
+  {
+    _modemPending = false;
+    _modemSpreadingFactor = 0;
+    _setModemSpreadingFactor(_getListenSpreadingFactor());
+  }
+
+  return true;
+}
+
+int HTLORAV3::_getChannelCount()
+{
+  if (_config.channelCount <= 1)
+    return 1;
+
+  return _config.channelCount < HTLORAV3_MAX_CHANNELS ? _config.channelCount : HTLORAV3_MAX_CHANNELS;
+}
+
+double HTLORAV3::_getChannelFrequency(int channel)
+{
+  return _getChannelCount() > 1 ? _config.channelPlan[channel] : _config.frequency;
+}
+
+int HTLORAV3::_getHomeChannel(unsigned int address)
+{
+  return address % _getChannelCount();
+}
+
+int HTLORAV3::_getTxChannel(unsigned int destinationAddress, bool ack)
+{
+  // ACKs go where their destinations wait for them, on the channel they sent to
+  if (ack)
+    return _getHomeChannel(_address);
+
+  if (destinationAddress == 0)
+    return _broadcastChannel;
+
+  return _getHomeChannel(destinationAddress);
+}
+
+int HTLORAV3::_getListenChannel()
+{
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    if (_reliableSends[i].destinationAddress != 0 && _reliableSends[i].state != HTLORAV3_RELIABLE_WAITING_SEND)
+      return _getHomeChannel(_reliableSends[i].destinationAddress);
+
+  return _getHomeChannel(_address);
+}
+
+uint16_t HTLORAV3::_getDataSize(const uint8_t *data, size_t dataSize)
+{
+  if (dataSize > 0 && data[0] == 0)
+    throw std::runtime_error("Packet data can't start with a zero byte, it marks fragments.");
+
+  uint8_t headerSize = _getHeaderSize(_config.binaryHeaderOn);
+
+  if (dataSize + headerSize > HTLORAV3_MAX_PACKET_SIZE)
+    throw std::runtime_error("Packet data is too large to fit in a LoRa frame.");
+
+  return dataSize;
+}
+
+uint8_t HTLORAV3::_getHeaderSize(bool binaryHeader)
+{
+  return binaryHeader ? HTLORAV3_BINARY_HEADER_SIZE : HTLORAV3_LEGACY_HEADER_SIZE;
+}
+
+uint16_t HTLORAV3::_nextPacketId()
+{
+  _currentPacketId++;
+  if (_currentPacketId == 0 || (!_config.binaryHeaderOn && _currentPacketId > 99))
+    _currentPacketId = 1;
+
+  return _currentPacketId;
+}
+
+void HTLORAV3::_transmit(const uint8_t *data, uint16_t dataSize, unsigned int destinationAddress, uint16_t packetId, uint8_t flags, bool binaryHeader, TxKinds kind, int spreadingFactor)
+{
+  LoraHeader header;
+  header.originAddress = _address;
+  header.destinationAddress = destinationAddress;
+  header.packetId = packetId;
+  header.flags = flags;
+
+  int channel = _getTxChannel(destinationAddress, kind == TX_ACK);
+
+  // A held ACK to the destination rides on the frame: its packet id takes the header and the frame one follows the ACK data
+  LoraTxQueueEntry ack;
+  bool piggyback = binaryHeader && kind != TX_ACK && destinationAddress != 0 &&
+                   _getTxChannel(destinationAddress, true) == channel &&
+                   _takeACK(destinationAddress, flags, spreadingFactor, HTLORAV3_BINARY_HEADER_SIZE + 2 + dataSize, ack);
+
+  if (piggyback)
+  {
+    header.packetId = ack.packetId;
+    header.flags |= HTLORAV3_FLAG_ACK;
+  }
+
+  // Build the frame in place: header followed by the data
+  uint8_t headerSize = _encodeHeader(_txBuffer, header, binaryHeader);
+
+  if (piggyback)
+  {
+    memcpy(_txBuffer + headerSize, ack.data, ack.dataSize);
+    headerSize += ack.dataSize;
+    _txBuffer[headerSize++] = packetId >> 8;
+    _txBuffer[headerSize++] = packetId;
+  }
+
+  memcpy(_txBuffer + headerSize, data, dataSize);
+
+  _setChannel(channel);
+  _setModemSpreadingFactor(spreadingFactor);
+
+  // Tx side changed by `updateConfig()`, the radio leaves receive mode to send anyway
+  if (_txModemPending)
+  {
+    _txModemPending = false;
+    _radio->setTxModem(_getModemConfig(_modemSpreadingFactor));
+  }
+
+  _txKind = kind;
+  _state = SENDING;
+
+  uint32_t timeOnAir = getTimeOnAir(headerSize + dataSize, spreadingFactor);
+
+  LoraDutyCycleBand *band = _getDutyCycleBand(channel);
+  if (band != NULL)
+  {
+    uint32_t cost = timeOnAir * 1000;
+    band->budget = band->budget > cost ? band->budget - cost : 0;
+  }
+
+  _metrics.txFrames++;
+  _metrics.txBytes += headerSize + dataSize;
+  _metrics.airTime += timeOnAir;
+
+  // The radio TX timeout may be a software timer of the driver, polled on its `process()`
+  _timers.start(TIMER_TX, millis(), _getTxTimeout() + HTLORAV3_TX_TIMEOUT_MARGIN);
+
+  _radio->send(_txBuffer, headerSize + dataSize);
+}
+
+LoraTxQueueEntry *HTLORAV3::_enqueueFrame(TxPriorities priority)
+{
+  if (_txQueueCount[priority] >= HTLORAV3_TX_QUEUE_SIZE)
+    return NULL;
+
+  int index = (_txQueueHead[priority] + _txQueueCount[priority]) % HTLORAV3_TX_QUEUE_SIZE;
+  _txQueueCount[priority]++;
+
+  LoraTxQueueEntry *entry = &_txQueue[priority][index];
+
+  // Entries move on the queue (and out of it when taken), so the timer goes with the entry: take one no queued entry holds
+  for (int timer = TIMER_TX_QUEUE; timer < TIMER_REASSEMBLY; timer++)
+  {
+    bool used = false;
+
+    for (int p = 0; p < 2 && !used; p++)
+      for (int i = 0; i < _txQueueCount[p] && !used; i++)
+      {
+        LoraTxQueueEntry &queued = _txQueue[p][(_txQueueHead[p] + i) % HTLORAV3_TX_QUEUE_SIZE];
+        used = &queued != entry && queued.timer == timer;
+      }
+
+    if (!used)
+    {
+      entry->timer = timer;
+      break;
+    }
+  }
+
+  _timers.stop(entry->timer);
+
+  return entry;
+}
+
+bool HTLORAV3::_transmitFromQueue(TxPriorities priority)
+{
+  if (_txQueueCount[priority] == 0)
+    return false;
+
+  LoraTxQueueEntry &entry = _txQueue[priority][_txQueueHead[priority]];
+  int channel = _getTxChannel(entry.destinationAddress, entry.ack);
+
+  if (_timers.isRunning(entry.timer) || !_hasAirTime(_getHeaderSize(entry.binaryHeader) + entry.dataSize, entry.spreadingFactor, channel))
+    return false;
+
+  // The frame stays on the queue while the channel is sensed
+  if (!entry.ack && !_senseChannel(entry.spreadingFactor, channel))
+    return true;
+
+  // Broadcasts go once on each channel, the frame leaves the queue with the last copy
+  if (!entry.ack && entry.destinationAddress == 0 && _broadcastChannel < _getChannelCount() - 1)
+  {
+    _transmit(entry.data, entry.dataSize, 0, entry.packetId, entry.flags, entry.binaryHeader, TX_REPEAT, entry.spreadingFactor);
+    _broadcastChannel++;
+    return true;
+  }
+
+  _txQueueHead[priority] = (_txQueueHead[priority] + 1) % HTLORAV3_TX_QUEUE_SIZE;
+  _txQueueCount[priority]--;
+
+  _fillACK(entry);
+
+  if (entry.ack && _transmitCoalescedACKs(entry))
+    return true;
+
+  // The entry stays untouched until a new frame is queued, and the frame is copied to `_txBuffer` before that
+  if (!entry.ack)
+  {
+    _txDestinationAddress = entry.destinationAddress;
+    _txPacketId = entry.packetId;
+  }
+
+  _transmit(entry.data, entry.dataSize, entry.destinationAddress, entry.packetId, entry.flags, entry.binaryHeader, entry.ack ? TX_ACK : TX_USER, entry.spreadingFactor);
+  _broadcastChannel = 0;
+
+  return true;
+}
+
+void HTLORAV3::_queueACK(unsigned int destinationAddress, uint16_t packetId, bool legacyHeader, int rate, int spreadingFactor, bool selective, bool more)
+{
+  // Selective ACKs are filled when sent, so they need the received window of the destination
+  selective = selective && !legacyHeader && destinationAddress <= HTLORAV3_MAX_ADDRESS;
+
+  // Hold the ACK while the burst goes on, but not forever if its last packet is lost
+  unsigned long delay = _getACKDelay(spreadingFactor);
+  if (more)
+    delay += getTimeOnAir(HTLORAV3_MAX_PACKET_SIZE, spreadingFactor);
+
+  // Then give a data frame to the destination (or ACKs to other nodes) the chance to carry it
+  if (!legacyHeader)
+    delay += _config.ackHoldTime;
+
+  // Skip if the same ACK is still waiting on the queue, a selective one covers every packet from the destination
+  LoraTxQueueEntry *entry = NULL;
+  for (int i = 0; i < _txQueueCount[PRIORITY_CONTROL] && entry == NULL; i++)
+  {
+    LoraTxQueueEntry &queued = _txQueue[PRIORITY_CONTROL][(_txQueueHead[PRIORITY_CONTROL] + i) % HTLORAV3_TX_QUEUE_SIZE];
+
+    if (queued.ack && queued.destinationAddress == destinationAddress && (selective ? (queued.flags & HTLORAV3_FLAG_SACK) != 0 : queued.packetId == packetId))
+      entry = &queued;
+  }
+
+  if (entry != NULL && !selective)
+    return;
+
+  if (entry == NULL)
+    entry = _enqueueFrame(PRIORITY_CONTROL);
+
+  if (entry == NULL)
+    return; // Queue full, the sender will retry
+
+  _timers.start(entry->timer, millis(), delay);
+
+  entry->destinationAddress = destinationAddress;
+  entry->packetId = packetId;
+  entry->binaryHeader = !legacyHeader; // Answer with the same header format the packet was received with
+  entry->ack = true;
+  entry->spreadingFactor = spreadingFactor; // The sender listens with the spreading factor it sent the packet
+
+  if (legacyHeader)
+  {
+    memcpy(entry->data, "ACK", 3);
+    entry->dataSize = 3;
+    entry->flags = 0;
+  }
+  else
+  {
+    entry->dataSize = selective ? 4 : 0;
+    entry->flags = HTLORAV3_FLAG_ACK | (selective ? HTLORAV3_FLAG_SACK : 0) | ((rate > 0 ? rate - 5 : 0) << HTLORAV3_FLAG_RATE_SHIFT);
+  }
+}
+
+void HTLORAV3::_removeQueuedFrame(TxPriorities priority, int position)
+{
+  _timers.stop(_txQueue[priority][(_txQueueHead[priority] + position) % HTLORAV3_TX_QUEUE_SIZE].timer);
+
+  for (int i = position; i < _txQueueCount[priority] - 1; i++)
+    _txQueue[priority][(_txQueueHead[priority] + i) % HTLORAV3_TX_QUEUE_SIZE] = _txQueue[priority][(_txQueueHead[priority] + i + 1) % HTLORAV3_TX_QUEUE_SIZE];
+
+  _txQueueCount[priority]--;
+}
+
+void HTLORAV3::_fillACK(LoraTxQueueEntry &entry)
+{
+  if (!entry.ack || !(entry.flags & HTLORAV3_FLAG_SACK))
+    return;
+
+  const ReceivedPacketsWindow &received = _receivedPackets[entry.destinationAddress];
+
+  entry.packetId = received.lastPacketId;
+  entry.data[0] = received.window >> 24;
+  entry.data[1] = received.window >> 16;
+  entry.data[2] = received.window >> 8;
+  entry.data[3] = received.window;
+}
+
+bool HTLORAV3::_canCarryACK(const LoraTxQueueEntry &entry)
+{
+  // The turnaround (and burst) wait of the destination must be over, the hold time is only waiting for company
+  return entry.ack && entry.binaryHeader && _config.ackHoldTime > 0 &&
+         _timers.getRemaining(entry.timer, millis()) <= (uint32_t)_config.ackHoldTime;
+}
+
+bool HTLORAV3::_isACKTurnaround()
+{
+  for (int i = 0; i < _txQueueCount[PRIORITY_CONTROL]; i++)
+  {
+    const LoraTxQueueEntry &queued = _txQueue[PRIORITY_CONTROL][(_txQueueHead[PRIORITY_CONTROL] + i) % HTLORAV3_TX_QUEUE_SIZE];
+
+    if (queued.ack && _timers.isRunning(queued.timer) && !_canCarryACK(queued))
+      return true;
+  }
+
+  return false;
+}
+
+bool HTLORAV3::_takeACK(unsigned int destinationAddress, uint8_t flags, int spreadingFactor, uint16_t frameSize, LoraTxQueueEntry &ack)
+{
+  int frameSpreadingFactor = spreadingFactor > 0 ? spreadingFactor : _config.spreadingFactor;
+
+  for (int i = 0; i < _txQueueCount[PRIORITY_CONTROL]; i++)
+  {
+    const LoraTxQueueEntry &queued = _txQueue[PRIORITY_CONTROL][(_txQueueHead[PRIORITY_CONTROL] + i) % HTLORAV3_TX_QUEUE_SIZE];
+    int ackSpreadingFactor = queued.spreadingFactor > 0 ? queued.spreadingFactor : _config.spreadingFactor;
+
+    // Both share the header, so they must agree on the selective and rate flags
+    if (
+        queued.destinationAddress != destinationAddress ||
+        !_canCarryACK(queued) ||
+        ackSpreadingFactor != frameSpreadingFactor ||
+        (queued.flags & (HTLORAV3_FLAG_SACK | HTLORAV3_FLAG_RATE_MASK)) != (flags & (HTLORAV3_FLAG_SACK | HTLORAV3_FLAG_RATE_MASK)) ||
+        frameSize + queued.dataSize > HTLORAV3_MAX_PACKET_SIZE)
+      continue;
+
+    ack = queued;
+    _removeQueuedFrame(PRIORITY_CONTROL, i);
+    _fillACK(ack);
+
+    return true;
+  }
+
+  return false;
+}
+
+bool HTLORAV3::_transmitCoalescedACKs(LoraTxQueueEntry &ack)
+{
+  if (!_canCarryACK(ack))
+    return false;
+
+  uint8_t data[HTLORAV3_MAX_PACKET_SIZE];
+  uint8_t entrySize = HTLORAV3_COALESCED_ACK_SIZE + ((ack.flags & HTLORAV3_FLAG_SACK) ? 4 : 0);
+  uint16_t dataSize = 0;
+  int ackCount = 0;
+
+  for (int i = -1; i < _txQueueCount[PRIORITY_CONTROL];)
+  {
+    // The taken ACK goes first, then the queued ones ready to go with it
+    LoraTxQueueEntry *entry = i < 0 ? &ack : &_txQueue[PRIORITY_CONTROL][(_txQueueHead[PRIORITY_CONTROL] + i) % HTLORAV3_TX_QUEUE_SIZE];
+
+    if (
+        i >= 0 &&
+        (!_canCarryACK(*entry) ||
+         entry->flags != ack.flags ||
+         entry->spreadingFactor != ack.spreadingFactor ||
+         HTLORAV3_BINARY_HEADER_SIZE + dataSize + entrySize > HTLORAV3_MAX_PACKET_SIZE))
+    {
+      i++;
+      continue;
+    }
+
+    _fillACK(*entry);
+
+    data[dataSize++] = entry->destinationAddress >> 8;
+    data[dataSize++] = entry->destinationAddress;
+    data[dataSize++] = entry->packetId >> 8;
+    data[dataSize++] = entry->packetId;
+    memcpy(data + dataSize, entry->data, entrySize - HTLORAV3_COALESCED_ACK_SIZE);
+    dataSize += entrySize - HTLORAV3_COALESCED_ACK_SIZE;
+    ackCount++;
+
+    if (i < 0)
+      i++;
+    else
+      _removeQueuedFrame(PRIORITY_CONTROL, i);
+  }
+
+  if (ackCount < 2)
+    return false;
+
+  _transmit(data, dataSize, 0, 0, ack.flags, true, TX_ACK, ack.spreadingFactor);
+
+  return true;
+}
+
+bool HTLORAV3::_canTransmit()
+{
+  // Listening is interrupted to transmit, the radio can't receive while sending anyway
+  return _state == IDLE || _state == RECEIVING;
+}
+
+LoraDutyCycleBand *HTLORAV3::_getDutyCycleBand(int channel)
+{
+  LoraDutyCycleBand *band = &_dutyCycleBands[HTLORAV3_DUTY_CYCLE_BANDS - 1];
+  double frequency = _getChannelFrequency(channel);
+
+  for (int i = 0; i < HTLORAV3_DUTY_CYCLE_BANDS - 1; i++)
+    if (frequency >= _dutyCycleBands[i].minFrequency && frequency < _dutyCycleBands[i].maxFrequency)
+      band = &_dutyCycleBands[i];
+
+  int dutyCycle = band->dutyCycle < 0 ? _config.dutyCycle : band->dutyCycle;
+
+  if (dutyCycle <= 0 || dutyCycle >= 1000)
+    return NULL;
+
+  // Refill with the air time earned since the last check, up to one full window
+  unsigned long now = millis();
+  uint32_t capacity = (uint32_t)HTLORAV3_DUTY_CYCLE_WINDOW * dutyCycle;
+  uint64_t budget = band->budget + (uint64_t)(now - band->timestamp) * dutyCycle;
+
+  band->budget = budget > capacity ? capacity : budget;
+  band->timestamp = now;
+
+  return band;
+}
+
+uint32_t HTLORAV3::_getSymbolTime(int spreadingFactor)
+{
+  static const uint32_t bandwidths[] = {125000, 250000, 500000};
+  uint32_t bandwidth = bandwidths[_config.bandwidth >= 0 && _config.bandwidth <= 2 ? _config.bandwidth : 0];
+
+  if (spreadingFactor <= 0)
+    spreadingFactor = _config.spreadingFactor;
+
+  return ((uint32_t)1 << spreadingFactor) * 1000000UL / bandwidth;
+}
+
+bool HTLORAV3::_hasAirTime(uint16_t frameSize, int spreadingFactor, int channel)
+{
+  LoraDutyCycleBand *band = _getDutyCycleBand(channel);
+  uint32_t cost = getTimeOnAir(frameSize, spreadingFactor) * 1000;
+
+  if (band == NULL || band->budget >= cost)
+    return true;
+
+  // Wake up when the budget is refilled enough for the frame
+  uint32_t dutyCycle = band->dutyCycle < 0 ? _config.dutyCycle : band->dutyCycle;
+  uint32_t release = (cost - band->budget + dutyCycle - 1) / dutyCycle;
+
+  if (!_timers.isRunning(TIMER_DUTY_CYCLE) || _timers.getRemaining(TIMER_DUTY_CYCLE, millis()) > release)
+    _timers.start(TIMER_DUTY_CYCLE, millis(), release);
+
+  return false;
+}
+
+uint32_t HTLORAV3::_getTxTimeout()
+{
+  if (_config.txTimeout > 0)
+    return _config.txTimeout;
+
+  return getTimeOnAir(HTLORAV3_MAX_PACKET_SIZE) + HTLORAV3_TX_TIMEOUT_MARGIN;
+}
+
+uint32_t HTLORAV3::_getACKDelay(int spreadingFactor)
+{
+  // The sender still catches the ACK if it starts listening during its preamble
+  uint32_t preambleTime = _config.preambleLength * _getSymbolTime(spreadingFactor) / 1000;
+
+  return preambleTime >= HTLORAV3_RX_TURNAROUND ? 0 : HTLORAV3_RX_TURNAROUND - preambleTime;
+}
+
+uint32_t HTLORAV3::_getACKTimeout(int spreadingFactor)
+{
+  if (_config.ackTimeout > 0)
+    return _config.ackTimeout;
+
+  // Held ACKs may come on a data frame or on a coalesced ACK frame, up to the largest frame
+  if (_config.binaryHeaderOn && _config.ackHoldTime > 0)
+    return _getACKDelay(spreadingFactor) + _config.ackHoldTime + getTimeOnAir(HTLORAV3_MAX_PACKET_SIZE, spreadingFactor) + HTLORAV3_ACK_TIMEOUT_MARGIN;
+
+  // Binary ACKs are only the header (plus the received bitmap on windowed sends), legacy ones carry "ACK"
+  uint16_t ackSize = _getHeaderSize(_config.binaryHeaderOn) + (!_config.binaryHeaderOn ? 3 : _getARQWindow() > 1 ? 4 : 0);
+
+  return _getACKDelay(spreadingFactor) + getTimeOnAir(ackSize, spreadingFactor) + HTLORAV3_ACK_TIMEOUT_MARGIN;
+}
+
+uint32_t HTLORAV3::_getBackoff(uint16_t frameSize, int spreadingFactor)
+{
+  // CSMA/CA: a number of slots in the contention window, the channel is sensed before sending anyway
+  if (_config.csmaOn)
+    return random(0, 1 << _csmaExponent) * _getCSMASlot(spreadingFactor);
+
+  return random(0, getTimeOnAir(frameSize, spreadingFactor) + _getACKTimeout(spreadingFactor));
+}
+
+uint32_t HTLORAV3::_getCSMASlot(int spreadingFactor)
+{
+  return (HTLORAV3_CAD_SYMBOLS + 1) * _getSymbolTime(spreadingFactor) / 1000 + HTLORAV3_CSMA_SLOT_MARGIN;
+}
+
+void HTLORAV3::_deferChannel(uint32_t time)
+{
+  // Keep the longest of the running backoff and the new one
+  if (_timers.getRemaining(TIMER_CSMA, millis()) < time)
+    _timers.start(TIMER_CSMA, millis(), time);
+}
+
+bool HTLORAV3::_senseChannel(int spreadingFactor, int channel)
+{
+  if (!_config.csmaOn)
+    return true;
+
+  // Busy for too long, send anyway
+  if (_csmaBusyCount >= HTLORAV3_CSMA_MAX_BUSY)
+  {
+    _csmaBusyCount = 0;
+    return true;
+  }
+
+  // The channel was just detected clear for this frame
+  if (_channelClear && _channel == channel && (millis() - _channelTimestamp) <= _getCSMASlot(spreadingFactor))
+  {
+    _channelClear = false;
+    return true;
+  }
+
+  _channelClear = false;
+
+  // Detect with the modem of the frame, the preamble of other frames on the same channel and spreading factor is what collides
+  _setChannel(channel);
+  _setModemSpreadingFactor(spreadingFactor);
+
+  if (_state == RECEIVING)
+    _radio->sleep();
+
+  _state = SENSING;
+  _timers.start(TIMER_SENSING, millis(), _getCSMASlot(spreadingFactor) + HTLORAV3_TX_TIMEOUT_MARGIN);
+  _radio->startCad();
+
+  return false;
+}
+
+LoraLinkQuality *HTLORAV3::_getLink(unsigned int address, bool create)
+{
+  if (address == 0)
+    return NULL;
+
+  LoraLinkQuality *replace = NULL;
+
+  for (int i = 0; i < HTLORAV3_MAX_NEIGHBOURS; i++)
+  {
+    LoraLinkQuality &link = _links[i];
+
+    if (link.address == address)
+      return &link;
+
+    if (link.address == 0)
+    {
+      if (replace == NULL || replace->address != 0)
+        replace = &link;
+    }
+    else if (replace == NULL || (replace->address != 0 && (long)(link.lastSeen - replace->lastSeen) < 0))
+      replace = &link;
+  }
+
+  if (!create)
+    return NULL;
+
+  replace->address = address;
+  replace->snr = INT16_MIN; // No SNR sample yet
+  replace->loss = 0;
+  replace->spreadingFactor = 0;
+  replace->sessionTimestamp = 0;
+  replace->lastSeen = millis();
+
+  return replace;
+}
+
+int HTLORAV3::_getBestSpreadingFactor(const LoraLinkQuality *link)
+{
+  if (link == NULL || link->snr == INT16_MIN)
+    return 0;
+
+  // Demodulation floor: -7.5 dB on SF7, 2.5 dB lower on each step (in 0.25 dB)
+  int spreadingFactor = 7;
+  while (spreadingFactor < _config.spreadingFactor && link->snr < -30 - 10 * (spreadingFactor - 7) + HTLORAV3_ADR_MARGIN * 4)
+    spreadingFactor++;
+
+  // Lossy links take one step more
+  if (link->loss > HTLORAV3_ADR_MAX_LOSS)
+    spreadingFactor++;
+
+  return spreadingFactor < _config.spreadingFactor ? spreadingFactor : 0;
+}
+
+int HTLORAV3::_getLinkSpreadingFactor(unsigned int address)
+{
+  LoraLinkQuality *link = _getLink(address, false);
+
+  // The sender drops the session earlier than the receiver, so it doesn't send on a spreading factor the receiver left
+  if (!_config.adrOn || link == NULL || link->spreadingFactor == 0 || (millis() - link->sessionTimestamp) >= HTLORAV3_ADR_SESSION_TIMEOUT / 2)
+    return _config.spreadingFactor;
+
+  return link->spreadingFactor;
+}
+
+int HTLORAV3::_getListenSpreadingFactor()
+{
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    if (_reliableSends[i].destinationAddress != 0 && _reliableSends[i].state != HTLORAV3_RELIABLE_WAITING_SEND)
+      return _reliableSends[i].spreadingFactor;
+
+  if (_sessionAddress != 0 && _timers.isRunning(TIMER_SESSION))
+    return _sessionSpreadingFactor;
+
+  _sessionAddress = 0;
+  return _config.spreadingFactor;
+}
+
+int HTLORAV3::_negotiateRate(unsigned int originAddress, int rate)
+{
+  bool otherSession = _sessionAddress != 0 && _sessionAddress != originAddress && _timers.isRunning(TIMER_SESSION);
+
+  // Accept the highest of the proposed and the one measured here, the link has to hold on both ways
+  int best = _getBestSpreadingFactor(_getLink(originAddress, false));
+  int accepted = rate > 0 && best > 0 && _config.adrOn && !otherSession ? (rate > best ? rate : best) : 0;
+
+  if (accepted > 0)
+  {
+    _sessionAddress = originAddress;
+    _sessionSpreadingFactor = accepted;
+    _timers.start(TIMER_SESSION, millis(), HTLORAV3_ADR_SESSION_TIMEOUT);
+  }
+  else if (_sessionAddress == originAddress)
+    _sessionAddress = 0;
+
+  return accepted;
+}
+
+void HTLORAV3::_processTransmissions()
+{
+  // ACK timeouts are handled by `_onTimer()`
+  bool pendingSends = false;
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    if (_reliableSends[i].destinationAddress != 0)
+      pendingSends = true;
+
+  if (!_canTransmit())
+    return;
+
+  // Control frames first, their senders are already waiting for them
+  if (_transmitFromQueue(PRIORITY_CONTROL))
+    return;
+
+  // An ACK waiting out the turnaround of its destination goes before any data frame, which could outlast its ACK timeout.
+  // Data frames also wait for the backoff of the last busy detection. Listening meanwhile
+  if (_isACKTurnaround() || (_config.csmaOn && _timers.isRunning(TIMER_CSMA)))
+  {
+    _setChannel(_getListenChannel());
+    _setModemSpreadingFactor(_getListenSpreadingFactor());
+
+    if (_state == IDLE && (pendingSends || _userListening))
+    {
+      _state = RECEIVING;
+      _radio->receive(0);
+    }
+
+    return;
+  }
+
+  // Reliable packets which backoff is over, the rest of a burst first
+  unsigned int burstAddress = _burstAddress;
+  _burstAddress = 0;
+
+  if ((burstAddress != 0 && _transmitReliable(burstAddress)) || _transmitReliable(0))
+    return;
+
+  if (_transmitFromQueue(PRIORITY_DATA))
+    return;
+
+  // Keep listening while there are reliable packets waiting for ACK, moving to the channel and spreading factor of the moment
+  _setChannel(_getListenChannel());
+  _setModemSpreadingFactor(_getListenSpreadingFactor());
+
+  if (_state == IDLE && (pendingSends || _userListening))
+  {
+    _state = RECEIVING;
+    _radio->receive(0);
+  }
+}
+
+bool HTLORAV3::_transmitReliable(unsigned int destinationAddress)
+{
+  int window = _getARQWindow();
+
+  // Only one spreading factor and channel can be waiting for ACKs
+  int waitingSpreadingFactor = 0;
+  int waitingChannel = -1;
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    if (_reliableSends[i].destinationAddress != 0 && _reliableSends[i].state != HTLORAV3_RELIABLE_WAITING_SEND)
+    {
+      waitingSpreadingFactor = _reliableSends[i].spreadingFactor;
+      waitingChannel = _getHomeChannel(_reliableSends[i].destinationAddress);
+    }
+
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+  {
+    LoraReliableSend &reliableSend = _reliableSends[i];
+
+    if (
+        reliableSend.destinationAddress == 0 ||
+        (destinationAddress != 0 && reliableSend.destinationAddress != destinationAddress) ||
+        reliableSend.state != HTLORAV3_RELIABLE_WAITING_SEND ||
+        _timers.isRunning(TIMER_RELIABLE_SEND + i) ||
+        !_isInARQWindow(i, window) ||
+        _getNextInWindow(reliableSend.destinationAddress, window) != i)
+      continue;
+
+    int spreadingFactor = _getLinkSpreadingFactor(reliableSend.destinationAddress);
+    int channel = _getTxChannel(reliableSend.destinationAddress, false);
+
+    if (
+        (waitingSpreadingFactor > 0 && waitingSpreadingFactor != spreadingFactor) ||
+        (waitingChannel >= 0 && waitingChannel != channel) ||
+        !_hasAirTime(_getHeaderSize(_config.binaryHeaderOn) + reliableSend.dataSize, spreadingFactor, channel))
+      continue;
+
+    // The rest of a burst holds the channel, it's only sensed before the first packet
+    if (destinationAddress == 0 && !_senseChannel(spreadingFactor, channel))
+      return true;
+
+    reliableSend.attempts++;
+    reliableSend.state = HTLORAV3_RELIABLE_SENDING;
+    reliableSend.spreadingFactor = spreadingFactor;
+    _txReliableIndex = i;
+
+    uint8_t flags = HTLORAV3_FLAG_ACK_REQUEST;
+
+    if (window > 1)
+    {
+      flags |= HTLORAV3_FLAG_SACK;
+
+      // Send the next packet of the window right after this one, the destination holds the ACK until the burst ends
+      int next = _getNextInWindow(reliableSend.destinationAddress, window);
+
+      if (next >= 0)
+      {
+        _timers.stop(TIMER_RELIABLE_SEND + next);
+        flags |= HTLORAV3_FLAG_MORE;
+        _burstAddress = reliableSend.destinationAddress;
+      }
+    }
+
+    // Propose the spreading factor the link supports for the next frames
+    int rate = _config.adrOn ? _getBestSpreadingFactor(_getLink(reliableSend.destinationAddress, false)) : 0;
+    if (rate > 0)
+      flags |= (rate - 5) << HTLORAV3_FLAG_RATE_SHIFT;
+
+    _transmit(reliableSend.data, reliableSend.dataSize, reliableSend.destinationAddress, reliableSend.packetId, flags, _config.binaryHeaderOn, TX_RELIABLE, spreadingFactor);
+    return true;
+  }
+
+  return false;
+}
+
+int HTLORAV3::_getARQWindow()
+{
+  // Legacy ACKs don't carry the packet id, only stop-and-wait works with them
+  if (!_config.binaryHeaderOn || _config.arqWindow <= 1)
+    return 1;
+
+  return _config.arqWindow < HTLORAV3_MAX_RELIABLE_SENDS ? _config.arqWindow : HTLORAV3_MAX_RELIABLE_SENDS;
+}
+
+bool HTLORAV3::_isInARQWindow(int index, int window)
+{
+  const LoraReliableSend &reliableSend = _reliableSends[index];
+
+  // Position of the packet among the pending ones to the same destination, in the order they were queued
+  int position = 0;
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS && position < window; i++)
+    if (
+        _reliableSends[i].destinationAddress == reliableSend.destinationAddress &&
+        (int32_t)(_reliableSends[i].sequence - reliableSend.sequence) < 0)
+      position++;
+
+  return position < window;
+}
+
+int HTLORAV3::_getNextInWindow(unsigned int destinationAddress, int window)
+{
+  int next = -1;
+
+  for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+  {
+    const LoraReliableSend &reliableSend = _reliableSends[i];
+
+    if (
+        reliableSend.destinationAddress == destinationAddress &&
+        reliableSend.state == HTLORAV3_RELIABLE_WAITING_SEND &&
+        (next < 0 || (int32_t)(reliableSend.sequence - _reliableSends[next].sequence) < 0) &&
+        _isInARQWindow(i, window))
+      next = i;
+  }
+
+  return next;
+}
+
+void HTLORAV3::_finishReliableSend(int index, bool success)
+{
+  LoraReliableSend &reliableSend = _reliableSends[index];
+
+  unsigned int destinationAddress = reliableSend.destinationAddress;
+  int retries = reliableSend.attempts > 0 ? reliableSend.attempts - 1 : 0;
+
+  reliableSend.destinationAddress = 0;
+  _timers.stop(TIMER_RELIABLE_SEND + index);
+
+  if (success)
+  {
+    _metrics.reliableDone++;
+
+    int bucket = 0;
+    while (bucket < HTLORAV3_METRICS_LATENCY_BUCKETS - 1 && millis() - reliableSend.timestamp >= (unsigned long)HTLORAV3_METRICS_LATENCY_BASE << bucket)
+      bucket++;
+    _metrics.latency[bucket]++;
+
+    int attempts = reliableSend.attempts < 1 ? 1 : reliableSend.attempts;
+    _metrics.attempts[attempts < HTLORAV3_METRICS_ATTEMPT_BUCKETS ? attempts - 1 : HTLORAV3_METRICS_ATTEMPT_BUCKETS - 1]++;
+  }
+  else
+    _metrics.reliableFailed++;
+
+  // Acknowledged: the channel got through, narrow the contention window
+  if (success && _csmaExponent > HTLORAV3_CSMA_MIN_EXPONENT)
+    _csmaExponent--;
+
+  // A fragmented message is done when its last fragment is acknowledged, or when any fragment fails
+  if (reliableSend.fragmentCount > 0)
+  {
+    bool pending = false;
+
+    for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    {
+      LoraReliableSend &fragment = _reliableSends[i];
+
+      if (fragment.destinationAddress != destinationAddress || fragment.fragmentCount == 0 || fragment.messageId != reliableSend.messageId)
+        continue;
+
+      if (success)
+        pending = true;
+      else
+        fragment.destinationAddress = 0; // Dropped, the destination can't complete the message anymore
+    }
+
+    if (pending)
+      return;
+  }
+
+  if (_onReliableSendDone != NULL)
+    _onReliableSendDone(destinationAddress, success, retries);
+
+  if (success && _onSendDone != NULL)
+    _onSendDone();
+  else if (!success && _onSendTimeout != NULL)
+    _onSendTimeout();
+}
+
+void HTLORAV3::_onTxDone()
+{
+  TxKinds kind = _txKind;
+  _timers.stop(TIMER_TX);
+
+  _txKind = TX_NONE;
+  _state = IDLE;
+  _retune();
+
+  if (kind == TX_RELIABLE && _txReliableIndex >= 0)
+  {
+    // Wait for the ACK on `process()`
+    LoraReliableSend &reliableSend = _reliableSends[_txReliableIndex];
+    _txReliableIndex = -1;
+
+    if (reliableSend.destinationAddress == 0)
+      return; // Already acknowledged
+
+    reliableSend.state = HTLORAV3_RELIABLE_WAITING_ACK;
+
+    // The earlier packets of a burst wait for the same ACK
+    uint32_t ackTimeout = _getACKTimeout(reliableSend.spreadingFactor);
+
+    for (int i = 0; i < HTLORAV3_MAX_RELIABLE_SENDS; i++)
+    {
+      LoraReliableSend &sent = _reliableSends[i];
+
+      if (sent.destinationAddress == reliableSend.destinationAddress && sent.state == HTLORAV3_RELIABLE_WAITING_ACK)
+        _timers.start(TIMER_RELIABLE_SEND + i, millis(), ackTimeout);
+    }
+  }
+  else if (kind == TX_USER)
+  {
+    if (_onPacketSendDone != NULL)
+      _onPacketSendDone(_txDestinationAddress, _txPacketId, true);
+
+    if (_onSendDone != NULL)
+      _onSendDone();
+  }
+}
+
+void HTLORAV3::_onTxTimeout()
+{
+  _radio->sleep();
+
+  TxKinds kind = _txKind;
+  _timers.stop(TIMER_TX);
+
+  _metrics.sendTimeouts++;
+
+  _txKind = TX_NONE;
+  _state = IDLE;
+  _retune();
+
+  if (kind == TX_RELIABLE && _txReliableIndex >= 0)
+  {
+    // Count as an attempt, `process()` retries or gives up (counted on `sendTimeouts` only, no ACK was waited for)
+    int index = _txReliableIndex;
+    _txReliableIndex = -1;
+
+    _reliableSends[index].sendTimedOut = true;
+    _reliableSends[index].state = HTLORAV3_RELIABLE_WAITING_ACK;
+    _timers.start(TIMER_RELIABLE_SEND + index, millis(), 0);
+  }
+  else if (kind == TX_USER)
+  {
+    if (_onPacketSendDone != NULL)
+      _onPacketSendDone(_txDestinationAddress, _txPacketId, false);
+
+    if (_onSendTimeout != NULL)
+      _onSendTimeout();
+  }
+}
+
+void HTLORAV3::_onRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
+{
+  LoraHeader header;
+  uint8_t headerSize = _decodeHeader(payload, size, header);
+  bool hasHeader = headerSize > 0;
+  bool legacyHeader = headerSize == HTLORAV3_LEGACY_HEADER_SIZE;
+
+  int originAddress = hasHeader ? header.originAddress : -1;
+  int destinationAddress = hasHeader ? header.destinationAddress : -1;
+  int packetId = hasHeader ? header.packetId : -1;
+  int rate = hasHeader && (header.flags & HTLORAV3_FLAG_RATE_MASK) ? ((header.flags & HTLORAV3_FLAG_RATE_MASK) >> HTLORAV3_FLAG_RATE_SHIFT) + 5 : 0;
+
+  _metrics.rxFrames++;
+  _metrics.rxBytes += size;
+
+  // Every frame heard measures the link to its origin, even the ones to other nodes
+  LoraLinkQuality *link = originAddress > 0 ? _getLink(originAddress, true) : NULL;
+  if (link != NULL)
+  {
+    link->snr = link->snr == INT16_MIN ? snr * 4 : link->snr + (snr * 4 - link->snr) / 4;
+    link->lastSeen = millis();
+  }
+
+  if (destinationAddress > 0 && (unsigned int)destinationAddress != _address)
+  {
+    // CSMA/CA: its ACK follows after a silent turnaround, which a detection would take as a clear channel
+    if (_config.csmaOn && (legacyHeader || (header.flags & HTLORAV3_FLAG_ACK_REQUEST)))
+      _deferChannel(_getACKTimeout(_modemSpreadingFactor));
+
+    return; // Packet not for this node
+  }
+
+  uint16_t dataSize = size - headerSize;
+  uint16_t dataOffset = headerSize;
+
+  // Coalesced ACK: look for the entries to this node (keep listening)
+  if (hasHeader && !legacyHeader && destinationAddress == 0 && (header.flags & HTLORAV3_FLAG_ACK))
+  {
+    bool selective = header.flags & HTLORAV3_FLAG_SACK;
+    uint8_t entrySize = HTLORAV3_COALESCED_ACK_SIZE + (selective ? 4 : 0);
+
+    for (uint16_t offset = 0; offset + entrySize <= dataSize; offset += entrySize)
+    {
+      const uint8_t *entry = payload + dataOffset + offset;
+
+      if ((unsigned int)((entry[0] << 8) | entry[1]) == _address)
+        _onACK(originAddress, (entry[2] << 8) | entry[3], selective ? entry + HTLORAV3_COALESCED_ACK_SIZE : NULL, false, rate);
+    }
+    return;
+  }
+
+  // ACK of a reliable packet sent by this node (keep listening)
+  bool acked = destinationAddress > 0 &&
+               ((!legacyHeader && (header.flags & HTLORAV3_FLAG_ACK)) ||
+                (legacyHeader && dataSize == 3 && memcmp(payload + dataOffset, "ACK", 3) == 0));
+
+  if (acked)
+  {
+    uint16_t ackDataSize = !legacyHeader && (header.flags & HTLORAV3_FLAG_SACK) && dataSize >= 4 ? 4 : 0;
+
+    _onACK(originAddress, packetId, ackDataSize > 0 ? payload + dataOffset : NULL, legacyHeader, rate);
+
+    if (legacyHeader || dataSize < ackDataSize + 2)
+      return;
+
+    // Data frame carrying the ACK: its packet id and data follow the ACK data
+    packetId = (payload[dataOffset + ackDataSize] << 8) | payload[dataOffset + ackDataSize + 1];
+    dataOffset += ackDataSize + 2;
+    dataSize -= ackDataSize + 2;
+  }
+
+  // Legacy senders wait for ACK on every packet with destination
+  bool ackRequested = destinationAddress > 0 && (legacyHeader || (header.flags & HTLORAV3_FLAG_ACK_REQUEST));
+  int receivedSpreadingFactor = _modemSpreadingFactor;
+  bool selective = hasHeader && (header.flags & HTLORAV3_FLAG_SACK);
+  bool more = hasHeader && (header.flags & HTLORAV3_FLAG_MORE);
+  int acceptedRate = ackRequested && !legacyHeader ? _negotiateRate(originAddress, rate) : 0;
+
+  if (ackRequested && _isDuplicatedPacket(originAddress, packetId, legacyHeader))
+  {
+    // Duplicated packet, the previous ACK was lost: answer again but don't deliver it (keep listening)
+    _metrics.rxDuplicates++;
+    _queueACK(originAddress, packetId, legacyHeader, acceptedRate, receivedSpreadingFactor, selective, more);
+    return;
+  }
+
+  // Fragment of a larger message: put on its reassembly buffer, delivered only when complete
+  if (hasHeader && dataSize > HTLORAV3_FRAGMENT_HEADER_SIZE && payload[dataOffset] == 0)
+  {
+    int reassemblyIndex = _storeFragment(originAddress, payload + dataOffset, dataSize, headerSize);
+
+    if (reassemblyIndex < 0)
+    {
+      _metrics.rxDropped++;
+      return; // No free reassembly buffer, drop the fragment (the sender will retry reliable packets)
+    }
+
+    if (ackRequested)
+    {
+      _markPacketReceived(originAddress, packetId, legacyHeader);
+      _queueACK(originAddress, packetId, legacyHeader, acceptedRate, receivedSpreadingFactor, selective, more);
+    }
+
+    LoraReassembly &reassembly = _reassemblies[reassemblyIndex];
+
+    if (!_isReassembled(reassembly))
+      return; // Keep listening for the other fragments
+
+    LoraDataPacket packet;
+    packet.data = reassembly.data;
+    packet.rssi = rssi;
+    packet.size = reassembly.size;
+    packet.snr = snr;
+    packet.slot = HTLORAV3_RX_POOL_SIZE + reassemblyIndex;
+
+    _userListening = false;
+    _timers.stop(TIMER_RECEIVE);
+
+    _radio->sleep();
+    _state = IDLE;
+
+    _deliverPacket(packet);
+    return;
+  }
+
+  int slot = _acquireSlot();
+
+  if (slot < 0)
+  {
+    _metrics.rxDropped++;
+    return; // No free receive slot, drop the packet (the sender will retry reliable packets)
+  }
+
+  LoraDataPacket packet;
+  packet.data = _receiveSlots[slot].data;
+  packet.rssi = rssi;
+  packet.size = dataSize;
+  packet.snr = snr;
+  packet.slot = slot;
+
+  // Copy only the data without the header
+  memcpy(packet.data, payload + dataOffset, dataSize);
+  packet.data[dataSize] = '\0';
+
+  // The user listen is done with this packet
+  _userListening = false;
+  _timers.stop(TIMER_RECEIVE);
+
+  _radio->sleep();
+  _state = IDLE;
+
+  if (ackRequested)
+  {
+    // The ACK goes on the control queue, data frames (even the ones the user sends from the callback) wait for it on `_processTransmissions()`
+    _markPacketReceived(originAddress, packetId, legacyHeader);
+    _queueACK(originAddress, packetId, legacyHeader, acceptedRate, receivedSpreadingFactor, selective, more);
+  }
+
+  _deliverPacket(packet);
+}
+
+void HTLORAV3::_onRxTimeout()
+{
+  if (_state == RECEIVING)
+    _state = IDLE;
+
+  if (!_userListening)
+    return; // Library listen (waiting for ACK), restarted on `process()`
+
+  _userListening = false;
+  _timers.stop(TIMER_RECEIVE);
+
+  if (_onReceiveTimeout != NULL)
+    _onReceiveTimeout();
+}
+
+void HTLORAV3::_onTimer(int timer)
+{
+  if (timer == TIMER_RECEIVE)
+  {
+    if (!_userListening)
+      return;
+
+    if (_state == RECEIVING)
+      _radio->sleep();
+
+    _onRxTimeout();
+  }
+  else if (timer == TIMER_SESSION)
+    _sessionAddress = 0; // Back to the config spreading factor
+  else if (timer == TIMER_SENSING)
+  {
+    if (_state != SENSING)
+      return;
+
+    // The detection never finished, take the channel as busy
+    _radio->sleep();
+    _onCadDone(true);
+  }
+  else if (timer >= TIMER_RELIABLE_SEND && timer < TIMER_RELIABLE_SEND + HTLORAV3_MAX_RELIABLE_SENDS)
+  {
+    int index = timer - TIMER_RELIABLE_SEND;
+    LoraReliableSend &reliableSend = _reliableSends[index];
+
+    // The backoff of a packet waiting to send is over, it goes on `_processTransmissions()`
+    if (reliableSend.destinationAddress == 0 || reliableSend.state != HTLORAV3_RELIABLE_WAITING_ACK)
+      return;
+
+    // ACK timeout, or a radio send timeout (already counted, the frame never went on the air)
+    bool sendTimedOut = reliableSend.sendTimedOut;
+    reliableSend.sendTimedOut = false;
+
+    if (!sendTimedOut)
+      _metrics.ackTimeouts++;
+
+    if (reliableSend.attempts > _config.maxRetries)
+    {
+      _finishReliableSend(index, false);
+      return;
+    }
+
+    // Lost attempt: a collision is likely, widen the contention window
+    if (!sendTimedOut && _csmaExponent < HTLORAV3_CSMA_MAX_EXPONENT)
+      _csmaExponent++;
+
+    reliableSend.state = HTLORAV3_RELIABLE_WAITING_SEND;
+    _timers.start(timer, millis(), _getBackoff(_getHeaderSize(_config.binaryHeaderOn) + reliableSend.dataSize, reliableSend.spreadingFactor)); // Minimize packet colision
+
+    if (sendTimedOut)
+      return;
+
+    // Lost attempt: count it on the link and fall back to the config spreading factor
+    LoraLinkQuality *link = _getLink(reliableSend.destinationAddress, true);
+    link->loss += (1000 - link->loss) / 4;
+    link->spreadingFactor = 0;
+  }
+  else if (timer >= TIMER_REASSEMBLY && timer < TIMER_COUNT)
+  {
+    // Fragments stopped arriving, free the buffer
+    LoraReassembly &reassembly = _reassemblies[timer - TIMER_REASSEMBLY];
+
+    if (reassembly.inUse && !_isReassembled(reassembly))
+      reassembly.inUse = false;
+  }
+
+  // Duty cycle, CSMA/CA, radio TX and transmit queue timers only wake `process()` up, the frames waiting go on `_processTransmissions()`
+}
+
+void HTLORAV3::_onCadDone(bool channelActivityDetected)
+{
+  if (_state != SENSING)
+    return; // Stopped meanwhile
+
+  _state = IDLE;
+  _channelTimestamp = millis();
+  _timers.stop(TIMER_SENSING);
+
+  // Retuned meanwhile by `updateConfig()`: the detection was on the old channel or modem, the frame senses the channel again
+  if (_retune())
+    return;
+
+  if (!channelActivityDetected)
+  {
+    _csmaBusyCount = 0;
+    _channelClear = true;
+    return;
+  }
+
+  // Busy: back off for a random number of slots in the widened contention window
+  _csmaBusyCount++;
+  if (_csmaExponent < HTLORAV3_CSMA_MAX_EXPONENT)
+    _csmaExponent++;
+
+  _deferChannel(random(1, (1 << _csmaExponent) + 1) * _getCSMASlot(_modemSpreadingFactor));
 }
-HTLORAV3 LoRa;
\ No newline at end of file
+HTLORAV3 LoRa;
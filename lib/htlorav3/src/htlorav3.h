@@ -10,6 +10,27 @@
  *
  * It's possible to configure some parameters by using the `setConfig()` and `updateConfig()` methods.
  *
+ * Radio:
+ *
+ * The radio is used through a `HTLORAV3Radio` backend, the SX1262 of the board by default.
+ * Set another one with `setRadio()` before `begin()` (eg: `HTLORAV3TCP` to run on Linux with the RadioHead ether simulator).
+ *
+ * Timers:
+ *
+ * Every protocol timeout (receive, ACK wait, retry backoff, duty cycle release...) is a timer of a `HTLORAV3Timers` wheel.
+ * `process()` fires the ones due and returns the time until the next one, so the host can sleep until then (or a radio event).
+ *
+ * Channels:
+ *
+ * With a channel plan (`channelCount` > 1), each node listens on the channel of its address (address % `channelCount`).
+ * Frames to a node go on its channel, and ACKs on the channel of the node sending them, where their destination waits for them.
+ * Broadcasts go once on each channel. Links to nodes on different channels don't contend, so disjoint pairs transmit at the same time.
+ *
+ * Metrics:
+ *
+ * Frames and bytes sent and received, drops, timeouts, air time used and histograms of the reliable send latency and attempts
+ * are counted as they happen, `getMetrics()` returns a copy of them to export (eg: periodically over Serial or HTTP).
+ *
  * Depends On:
  * - heltecautomation/Heltec ESP32 Dev-Boards@2.0.2
  *
@@ -21,10 +42,122 @@
 #ifndef HTLORAV3_H
 #define HTLORAV3_H
 
-// LoRa Libs
-#include <SPI.h>
-#include "radio/radio.h"
-#include "ESP32_Mcu.h"
+// Radio backend
+#include "htlorav3radio.h"
+// Protocol timers
+#include "htlorav3timers.h"
+
+// === Constants ===
+
+// Max size of a LoRa frame (header + data) - bytes
+#define HTLORAV3_MAX_PACKET_SIZE 255
+// Size of the legacy ASCII header "XXX-XXX-XX|" - bytes
+#define HTLORAV3_LEGACY_HEADER_SIZE 11
+// Size of the binary header - bytes
+#define HTLORAV3_BINARY_HEADER_SIZE 6
+// Marker bit always set on the first byte of binary headers (legacy headers start with an ASCII digit)
+#define HTLORAV3_FLAG_BINARY 0x80
+// Header flag: the frame acknowledges the packet id in the header
+#define HTLORAV3_FLAG_ACK 0x01
+// Header flag: the sender waits for an ACK of this frame
+#define HTLORAV3_FLAG_ACK_REQUEST 0x02
+// Header flag: more packets of the same burst follow, hold the ACK until the last one
+#define HTLORAV3_FLAG_MORE 0x04
+// Header flag: answer with a selective ACK (on ACKs: the data is the received bitmap)
+#define HTLORAV3_FLAG_SACK 0x08
+// Header flag bits with the spreading factor proposed (or accepted on ACKs) for the next frames of the link, stored as SF - 5 [0: none]
+#define HTLORAV3_FLAG_RATE_MASK 0x70
+#define HTLORAV3_FLAG_RATE_SHIFT 4
+// Size of each entry of a coalesced ACK frame: node address and packet id (plus the received bitmap on selective ACKs) - bytes
+#define HTLORAV3_COALESCED_ACK_SIZE 4
+
+// Time the sender needs to enter listen mode after a transmission, the ACK is delayed by what the preamble doesn't cover - ms
+#define HTLORAV3_RX_TURNAROUND 50
+// Extra time added to the computed ACK timeout, for the processing on both nodes - ms
+#define HTLORAV3_ACK_TIMEOUT_MARGIN 50
+// Extra time added to the computed TX timeout of the largest frame - ms
+#define HTLORAV3_TX_TIMEOUT_MARGIN 100
+
+// CSMA/CA contention window: 2^exponent backoff slots, the exponent grows on a busy channel or a lost ACK and shrinks on each ACK
+#define HTLORAV3_CSMA_MIN_EXPONENT 1
+#define HTLORAV3_CSMA_MAX_EXPONENT 6
+// Time between the end of a clear channel detection and the transmission, added to the detection on each backoff slot - ms
+#define HTLORAV3_CSMA_SLOT_MARGIN 10
+// Busy channel detections in a row before the frame is sent anyway, so a jammed channel doesn't stall the node
+#define HTLORAV3_CSMA_MAX_BUSY 8
+
+// Window where the duty cycle is accounted - ms
+#define HTLORAV3_DUTY_CYCLE_WINDOW 3600000
+// Number of duty cycle bands (regional sub-bands + one for any other frequency)
+#define HTLORAV3_DUTY_CYCLE_BANDS 7
+
+// Margin kept between the link SNR and the demodulation floor of the spreading factor - dB
+#define HTLORAV3_ADR_MARGIN 10
+// Link loss rate above which one more spreading factor step is used - ‰
+#define HTLORAV3_ADR_MAX_LOSS 250
+// Time a negotiated spreading factor is kept after the last frame of the link - ms
+#define HTLORAV3_ADR_SESSION_TIMEOUT 3000
+
+// Max number of channels on the channel plan
+#ifndef HTLORAV3_MAX_CHANNELS
+#define HTLORAV3_MAX_CHANNELS 8
+#endif
+
+// Max node address
+#define HTLORAV3_MAX_ADDRESS 999
+// Number of packet ids kept per origin for duplicated packet check
+#define HTLORAV3_DEDUP_WINDOW 32
+
+// Number of receive slots (received packets that can be held at the same time)
+#ifndef HTLORAV3_RX_POOL_SIZE
+#define HTLORAV3_RX_POOL_SIZE 4
+#endif
+
+// Number of reliable packets that can be pending at the same time (each fragment of a message takes one)
+#ifndef HTLORAV3_MAX_RELIABLE_SENDS
+#define HTLORAV3_MAX_RELIABLE_SENDS 16
+#endif
+
+// Number of frames waiting to be sent on each priority of the transmit queue
+#ifndef HTLORAV3_TX_QUEUE_SIZE
+#define HTLORAV3_TX_QUEUE_SIZE 4
+#endif
+
+// Number of neighbours kept on the link quality table (the least recently heard is replaced)
+#ifndef HTLORAV3_MAX_NEIGHBOURS
+#define HTLORAV3_MAX_NEIGHBOURS 16
+#endif
+
+// Max size of a message sent with `sendReliablePacket()`, larger than a frame it is fragmented - bytes
+#ifndef HTLORAV3_MAX_MESSAGE_SIZE
+#define HTLORAV3_MAX_MESSAGE_SIZE 2048
+#endif
+
+// Number of fragmented messages that can be reassembled at the same time (each takes a `HTLORAV3_MAX_MESSAGE_SIZE` buffer)
+#ifndef HTLORAV3_MAX_REASSEMBLIES
+#define HTLORAV3_MAX_REASSEMBLIES 2
+#endif
+
+// Time to receive all the fragments of a message, counted from the last fragment received - ms
+#ifndef HTLORAV3_REASSEMBLY_TIMEOUT
+#define HTLORAV3_REASSEMBLY_TIMEOUT 30000
+#endif
+
+// Size of the fragment header at the start of the data: 0x00 marker (never on string data), message id, fragment index and fragment count - bytes
+#define HTLORAV3_FRAGMENT_HEADER_SIZE 4
+// Max number of fragments of a message (one bit each on the reassembly bitmap)
+#define HTLORAV3_MAX_FRAGMENTS 32
+
+// Buckets of the reliable send latency histogram, bucket i counts latencies under HTLORAV3_METRICS_LATENCY_BASE << i (the last one, any larger)
+#define HTLORAV3_METRICS_LATENCY_BUCKETS 12
+// Upper bound of the first latency bucket - ms
+#define HTLORAV3_METRICS_LATENCY_BASE 32
+// Buckets of the attempts histogram, bucket i counts packets acknowledged on attempt i + 1 (the last one, on any later attempt)
+#define HTLORAV3_METRICS_ATTEMPT_BUCKETS 8
+
+#if HTLORAV3_MAX_MESSAGE_SIZE > HTLORAV3_MAX_FRAGMENTS * (HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE - HTLORAV3_FRAGMENT_HEADER_SIZE)
+#error "HTLORAV3_MAX_MESSAGE_SIZE doesn't fit in HTLORAV3_MAX_FRAGMENTS fragments"
+#endif
 
 // === Structs ===
 
@@ -37,7 +170,7 @@ typedef struct
   double frequency;
   // Bandwidth - [0: 125 kHz, 1: 250 kHz, 2: 500 kHz, 3: Reserved]
   int bandwidth;
-  // Spreading Factor - [SF7..SF12]
+  // Spreading Factor - [SF7..SF12] - Used for broadcasts and neighbours without a negotiated one
   int spreadingFactor;
   // Coding Rate - [1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8]
   int codingRate;
@@ -49,25 +182,239 @@ typedef struct
   bool iqInversionOn;
   // Output Power - dBm - [-3..22]
   int txOutPower;
-  // TX Timeout - ms
+  // TX Timeout - ms - [0: auto, from the time on air of the largest frame]
   int txTimeout;
   // RX Timeout - Symbols
   int rxTimeout;
+  // Binary Header On - Send the compact binary header instead of the legacy ASCII one (both are accepted on receive)
+  bool binaryHeaderOn;
+  // ACK Timeout - ms - Time to wait for the ACK of each reliable send attempt - [0: auto, from the time on air of the ACK]
+  int ackTimeout;
+  // Max Retries - Reliable send attempts after the first one before giving up
+  int maxRetries;
+  // Duty Cycle - ‰ - Max share of air time on frequencies outside the regional sub-bands - [0: no limit, 1..1000]
+  int dutyCycle;
+  // ADR On - Negotiate a lower spreading factor for reliable packets with close neighbours (binary header only)
+  bool adrOn;
+  // ARQ Window - Reliable packets sent to a destination before waiting for its ACK - [1: stop-and-wait, 2..HTLORAV3_MAX_RELIABLE_SENDS (binary header only)]
+  int arqWindow;
+  // ACK Hold Time - ms - Time an ACK waits for a frame to the same node (or ACKs to other nodes) to ride on, same on every node (raises the auto ACK timeout) - [0: off] (binary header only)
+  int ackHoldTime;
+  // CSMA/CA On - Detect channel activity (CAD) before each data frame, backing off on a binary exponential window while busy (ACKs are sent without it)
+  bool csmaOn;
+  // Channel Count - Channels of `channelPlan` to hop over, same on every node - [0..1: single channel on `frequency`, 2..HTLORAV3_MAX_CHANNELS]
+  int channelCount;
+  // Channel Plan - Hz - Frequency of each channel [only the first `channelCount` are used]
+  double channelPlan[HTLORAV3_MAX_CHANNELS];
 } HTLORAV3Config;
 
+/**
+ * @brief Air time budget of a duty cycle band
+ *
+ * @note The budget is kept in ms * ‰ so it refills without rounding, a frame costs its time on air * 1000.
+ */
+typedef struct
+{
+  // Band start - Hz
+  double minFrequency;
+  // Band end - Hz
+  double maxFrequency;
+  // Duty Cycle - ‰ - [-1: use the config `dutyCycle`]
+  int dutyCycle;
+  // Available air time - ms * ‰
+  uint32_t budget;
+  // Last time the budget was refilled - ms
+  unsigned long timestamp;
+} LoraDutyCycleBand;
+
+/**
+ * @brief Link quality of a neighbour, measured from its frames and from the reliable sends to it
+ */
+typedef struct
+{
+  // Neighbour node address [1-999, 0: free entry]
+  unsigned int address;
+  // Smoothed SNR of the frames heard from the neighbour - 0.25 dB
+  int16_t snr;
+  // Smoothed loss rate of the reliable send attempts to the neighbour - ‰
+  uint16_t loss;
+  // Spreading factor negotiated with the neighbour [0: none, config spreading factor is used]
+  int8_t spreadingFactor;
+  // Millis timestamp of the last ACK at the negotiated spreading factor
+  unsigned long sessionTimestamp;
+  // Millis timestamp of the last frame heard from the neighbour
+  unsigned long lastSeen;
+} LoraLinkQuality;
+
+/**
+ * @brief Link layer metrics, counted since the node started or the last `resetMetrics()`
+ */
+typedef struct
+{
+  // Frames sent (data, ACKs and retries)
+  uint32_t txFrames;
+  // Bytes sent (headers included) - bytes
+  uint32_t txBytes;
+  // Frames received (to this node or not)
+  uint32_t rxFrames;
+  // Bytes received (headers included) - bytes
+  uint32_t rxBytes;
+  // Duplicated packets dropped (their previous ACK was lost)
+  uint32_t rxDuplicates;
+  // Packets dropped without a free receive slot or reassembly buffer
+  uint32_t rxDropped;
+  // Reliable send attempts without ACK
+  uint32_t ackTimeouts;
+  // Frames not sent in the radio TX timeout
+  uint32_t sendTimeouts;
+  // Reliable packets acknowledged
+  uint32_t reliableDone;
+  // Reliable packets given up
+  uint32_t reliableFailed;
+  // Air time used by the frames sent - ms
+  uint32_t airTime;
+  // Time from `sendReliablePacket()` to the ACK of the packets acknowledged (each fragment is a packet)
+  uint32_t latency[HTLORAV3_METRICS_LATENCY_BUCKETS];
+  // Attempts used by the packets acknowledged
+  uint32_t attempts[HTLORAV3_METRICS_ATTEMPT_BUCKETS];
+} LoraMetrics;
+
+/**
+ * @brief Received packet
+ *
+ * @note The data is not a copy, it points into a receive slot of the library and is only valid inside the `onReceive` callback.
+ * Call `retainPacket()` inside the callback to keep it after the callback returns and `releasePacket()` when done.
+ */
 typedef struct
 {
+  // Packet data (null terminated, binary data may hold zeros before `size`)
   char *data;
   int16_t rssi;
   uint16_t size;
   int8_t snr;
+  // Receive slot holding the data [-1: none]
+  int8_t slot;
 } LoraDataPacket;
 
+/**
+ * @brief Receive slot used to hold received packets without heap allocation
+ */
+typedef struct
+{
+  char data[HTLORAV3_MAX_PACKET_SIZE + 1]; // max packet size + '\0'
+  volatile bool inUse;
+  volatile bool retained;
+} LoraReceiveSlot;
+
+/**
+ * @brief Buffer where the fragments of a message are put together, delivered like a receive slot when complete
+ */
+typedef struct
+{
+  char data[HTLORAV3_MAX_MESSAGE_SIZE + 1]; // max message size + '\0'
+  volatile bool inUse;
+  volatile bool retained;
+  // Origin node address of the message
+  unsigned int originAddress;
+  // Message id given by the origin
+  uint8_t messageId;
+  // Number of fragments of the message
+  uint8_t fragmentCount;
+  // Bit i set: fragment i was received
+  uint32_t received;
+  // Message size, set when the last fragment arrives - bytes
+  uint16_t size;
+} LoraReassembly;
+
+/**
+ * @brief Sliding window of the packet ids received from one origin, used to drop duplicated packets
+ */
+typedef struct
+{
+  // Highest packet id received
+  uint16_t lastPacketId;
+  // Bit i set: packet id `lastPacketId - i` was received [0: nothing received yet]
+  uint32_t window;
+  // Millis timestamp of the last packet received
+  unsigned long timestamp;
+} ReceivedPacketsWindow;
+
+/**
+ * @brief Reliable packet waiting to be sent or acknowledged
+ */
+typedef struct
+{
+  // Frame data (header not included)
+  uint8_t data[HTLORAV3_MAX_PACKET_SIZE];
+  uint8_t dataSize;
+  // Destination node address [1-999, 0: free entry]
+  unsigned int destinationAddress;
+  // Packet id, kept on every attempt so the destination can drop duplicates
+  uint16_t packetId;
+  // Order the packet was queued, packets to the same destination are sent in this order
+  uint32_t sequence;
+  // Spreading factor of the current attempt
+  int8_t spreadingFactor;
+  // Fragment of the message with this id [only if `fragmentCount` > 0]
+  uint8_t messageId;
+  // Number of fragments of the message [0: not fragmented]
+  uint8_t fragmentCount;
+  // Send attempts done
+  int attempts;
+  // The last attempt timed out on the radio, it never went on the air (not an ACK timeout)
+  bool sendTimedOut;
+  // Millis timestamp of the `sendReliablePacket()` call, for the latency metrics
+  unsigned long timestamp;
+  // [0: waiting to send (after the backoff timer), 1: sending, 2: waiting for ACK (until the ACK timer)]
+  uint8_t state;
+} LoraReliableSend;
+
+/**
+ * @brief Frame waiting on the transmit queue
+ */
+typedef struct
+{
+  // Frame data (header not included)
+  uint8_t data[HTLORAV3_MAX_PACKET_SIZE];
+  uint8_t dataSize;
+  // Destination node address (0 for broadcast)
+  unsigned int destinationAddress;
+  uint16_t packetId;
+  // Header flags
+  uint8_t flags;
+  // Send with the binary header (false: legacy header)
+  bool binaryHeader;
+  // ACK frame (true) or user frame (false)
+  bool ack;
+  // Spreading factor to send the frame [0: config spreading factor]
+  int8_t spreadingFactor;
+  // Timer of the wait before sending the frame (sent when stopped)
+  int8_t timer;
+} LoraTxQueueEntry;
+
+/**
+ * @brief Link header of a LoRa frame
+ *
+ * @note Binary layout (6 bytes, big endian):
+ * - [0] flags (`HTLORAV3_FLAG_BINARY` always set)
+ * - [1..3] origin address (12 bits) and destination address (12 bits)
+ * - [4..5] packet id (16 bits)
+ *
+ * ACKs (`HTLORAV3_FLAG_ACK`) put the acknowledged packet id on the header and the received bitmap on the data (selective ones).
+ * A data frame carrying an ACK to its destination follows it with its own packet id (16 bits) and data.
+ * Coalesced ACKs are broadcast with one `HTLORAV3_COALESCED_ACK_SIZE` entry per node on the data: address (16 bits), packet id (16 bits) and bitmap.
+ */
 typedef struct
 {
-  unsigned int nodeAddress;
-  unsigned int packetId;
-} ReceivedPacketInfo;
+  // Origin node address [0-999]
+  uint16_t originAddress;
+  // Destination node address [0-999, 0: broadcast]
+  uint16_t destinationAddress;
+  // Packet id [1-65535 (1-99 on legacy header), 0: none]
+  uint16_t packetId;
+  // Header flags (always 0 on legacy header)
+  uint8_t flags;
+} LoraHeader;
 
 /**
  * @class HTLORAV3
@@ -87,17 +434,29 @@ public:
 
   enum LoRaStates
   {
-    IDLE,           // 0
-    SENDING,        // 1
-    SEND_TIMEOUT,   // 2
-    RECEIVING,      // 3
-    RECEIVE_TIMEOUT // 4
+    IDLE,            // 0
+    SENDING,         // 1
+    SEND_TIMEOUT,    // 2
+    RECEIVING,       // 3
+    RECEIVE_TIMEOUT, // 4
+    SENSING          // 5
+  };
+
+  /**
+   * @brief Priority classes of the transmit queue, control frames are always sent before data frames
+   */
+  enum TxPriorities
+  {
+    PRIORITY_CONTROL, // 0
+    PRIORITY_DATA     // 1
   };
 
   /**
    * @brief Setup the configured constants and binding methods
    *
    * @param address LoRa node address [1-999, Default to 0: for anonymous mode]
+   *
+   * @throw std::runtime_error If no radio backend is set (only the board has a default one)
    */
   void begin(unsigned int address = 0);
 
@@ -122,6 +481,67 @@ public:
    */
   LoRaStates getState();
 
+  /**
+   * @brief Check if the node is listening for packets, from `listenToPacket()` until a packet or the listen timeout
+   *
+   * @note Listening goes on while the radio sends, so the state may not be `RECEIVING`
+   *
+   * @return bool True if listening, false otherwise
+   */
+  bool isListening();
+
+  /**
+   * @brief Get the packet id assigned by the last `sendPacket()` or `sendReliablePacket()` call
+   *
+   * @note Use it to match the packet on the `onPacketSendDone` callback
+   *
+   * @return uint16_t Packet id [0: none sent yet]
+   */
+  uint16_t getLastPacketId();
+
+  /**
+   * @brief Get the time on air of a frame with the current config
+   *
+   * @param frameSize Size of the frame (header + data) - bytes
+   * @param spreadingFactor Spreading factor of the frame [0: config spreading factor]
+   *
+   * @return uint32_t Time on air - ms
+   */
+  static uint32_t getTimeOnAir(uint16_t frameSize, int spreadingFactor = 0);
+
+  /**
+   * @brief Get the air time still available on the band of the configured frequency (of the node channel with a channel plan)
+   *
+   * @note Frames are held on the queue until the band has budget for them
+   *
+   * @return uint32_t Available air time - ms [UINT32_MAX: no duty cycle limit]
+   */
+  static uint32_t getAirTimeBudget();
+
+  /**
+   * @brief Get the link quality measured for a neighbour
+   *
+   * @param address Neighbour node address
+   * @param linkQuality Filled with the neighbour link quality
+   *
+   * @return bool True if the neighbour is on the link quality table, false otherwise
+   */
+  bool getLinkQuality(unsigned int address, LoraLinkQuality &linkQuality);
+
+  /**
+   * @brief Get a snapshot of the link layer metrics
+   *
+   * @note Counters are only updated on `process()`, call it from the same task to get a consistent snapshot
+   *
+   * @return LoraMetrics Copy of the metrics
+   */
+  LoraMetrics getMetrics() const;
+
+  /**
+   * @brief Clear every link layer metric
+   */
+  void resetMetrics();
+
   /**
    * @brief Get the default configuration object
    *
@@ -140,6 +560,15 @@ public:
    */
   void setConfig(const HTLORAV3Config &config);
 
+  /**
+   * @brief Set the radio backend
+   *
+   * @param radio Radio backend, must live while the LoRa is used
+   *
+   * @warning Do not use this after the LoRa is initialized
+   */
+  void setRadio(HTLORAV3Radio *radio);
+
   /**
    * @brief Update configuration after the LoRa is initialized
    *
@@ -147,9 +576,11 @@ public:
    *
    * @warning Do not use this to change the configuration before the LoRa is initialized, use `setConfig()` instead
    *
-   * @note Attention points:
-   * - This function will put the LoRa in sleep mode and idle state
-   * - The LoRa should be initialized again after the configuration is updated
+   * @note Only the radio commands of the changed fields are sent:
+   * - Protocol fields (ACK, ARQ, ADR, duty cycle, CSMA/CA...): none, the radio keeps listening
+   * - `txOutPower`, `txTimeout`: the Tx side of the modem, right before the next frame, the radio keeps listening
+   * - Channel and other modem fields: the radio leaves receive mode to be retuned, then listens again
+   * - A frame being sent or a detection goes on, the radio is retuned on a channel or modem change once it is over
    */
   void updateConfig(const HTLORAV3Config &config);
 
@@ -186,37 +617,126 @@ public:
    */
   void setOnSendTimeout(void (*onSendTimeout)());
 
+  /**
+   * @brief Set the onReliableSendDone function called when a reliable packet is acknowledged or given up
+   *
+   * @note `onSendDone` (success) or `onSendTimeout` (failure) are also called
+   *
+   * @param onReliableSendDone Function that should be called with the destination address, the result and the number of retries used
+   */
+  void setOnReliableSendDone(void (*onReliableSendDone)(unsigned int destinationAddress, bool success, int retries));
+
+  /**
+   * @brief Set the onPacketSendDone function called when a packet queued by `sendPacket()` leaves the transmit queue
+   *
+   * @note `onSendDone` (success) or `onSendTimeout` (failure) are also called
+   *
+   * @param onPacketSendDone Function that should be called with the destination address, the packet id and the result
+   */
+  void setOnPacketSendDone(void (*onPacketSendDone)(unsigned int destinationAddress, uint16_t packetId, bool success));
+
+  /**
+   * @brief Set the onInterrupt function called from the radio interrupt when a radio event is pending
+   *
+   * @warning It runs in interrupt context: keep it short and only use ISR safe functions (eg: `xTaskNotifyFromISR()`)
+   *
+   * @note Use this to wake the task calling `process()`, which can then block until this or the time `process()` returns.
+   * Backends without interrupts (`HTLORAV3TCP`, `HTLORAV3Sim`) never call it, keep polling `process()` on them.
+   *
+   * @param onInterrupt Function that should be called when the radio has an event to process
+   */
+  void setOnInterrupt(void (*onInterrupt)());
+
+  // === Packet Ownership ===
+
+  /**
+   * @brief Keep the packet data after the `onReceive` callback returns
+   *
+   * @warning This function should be called inside the `onReceive` callback, and `releasePacket()` must be called when the packet is no longer needed
+   *
+   * @note While retained, the packet receive slot is not reused. When all the slots are retained, new packets are dropped.
+   *
+   * @param packet Packet received on the `onReceive` callback
+   * @return bool True if the packet was retained, false otherwise
+   */
+  bool retainPacket(const LoraDataPacket &packet);
+
+  /**
+   * @brief Release a packet retained with `retainPacket()`, making its receive slot available again
+   *
+   * @param packet Retained packet (its data is set to NULL)
+   */
+  void releasePacket(LoraDataPacket &packet);
+
   // === Handlers ===
 
   /**
-   * @brief Process the radio interruption requests
+   * @brief Process the radio interruption requests and the protocol timers due
    *
    * @warning This function should be called on `loop()`
    *
    * @note Equivalent to Radio.IrqProcess
+   * @note Event-driven hosts call it only when woken by `setOnInterrupt()` or when the time returned elapses
+   *
+   * @return uint32_t Time until the next protocol deadline (receive timeout, ACK wait, retry backoff, duty cycle release...),
+   * the host can sleep that long unless a radio event comes first - ms - [UINT32_MAX: none]
    */
-  void process();
+  uint32_t process();
 
   /**
    * @brief Send data packets
    *
+   * @note The packet is queued and sent by `process()` as soon as the radio is free. Use `setOnPacketSendDone()` to know when it was sent.
+   *
    * @param data Data string to be sent
    * @param destinationAddress Destination node address (0 for broadcast)
-   * @return int [0: ok, 1: busy]
+   * @param priority Transmit queue priority class
+   * @return int [0: ok, 1: busy (transmit queue full)]
+   */
+  int sendPacket(const char *data, unsigned int destinationAddress = 0, TxPriorities priority = PRIORITY_DATA);
+
+  /**
+   * @brief Send binary data packets
+   *
+   * @note Same as `sendPacket()` for strings, the data is received with its `size` on `onReceive`.
+   *
+   * @param data Data to be sent (can't start with a zero byte, it marks fragments)
+   * @param size Data size - bytes
+   * @param destinationAddress Destination node address (0 for broadcast)
+   * @param priority Transmit queue priority class
+   * @return int [0: ok, 1: busy (transmit queue full)]
    */
-  int sendPacket(const char *data, unsigned int destinationAddress = 0);
+  int sendPacket(const uint8_t *data, size_t size, unsigned int destinationAddress = 0, TxPriorities priority = PRIORITY_DATA);
 
   /**
    * @brief Send data packets and wait for ACK
    *
    * @warning You should set an lora address at the `begin()` function to use this.
    *
+   * @note This function does not block, the packet is sent and retried by `process()` until acknowledged or `maxRetries` is reached.
+   * Use `setOnReliableSendDone()` to know the result. Packets keep being received while waiting for the ACK.
+   * Packets to the same destination are sent in the order they were queued, `arqWindow` at a time (one by default).
+   * @note Data larger than a frame (up to `HTLORAV3_MAX_MESSAGE_SIZE`) is sent in fragments, each one a reliable packet,
+   * and delivered on the destination `onReceive` only when complete. `onReliableSendDone` is called once for the whole message.
+   *
    * @param data Data string to be sent
    * @param destinationAddress Destination node address (broadcast not allowed)
-   * @return int [0: ok, 1: busy]
+   * @return int [0: ok, 1: busy (too many pending packets)]
    */
   int sendReliablePacket(const char *data, unsigned int destinationAddress);
 
+  /**
+   * @brief Send binary data packets and wait for ACK
+   *
+   * @note Same as `sendReliablePacket()` for strings, the data is received with its `size` on `onReceive`.
+   *
+   * @param data Data to be sent (can't start with a zero byte, it marks fragments)
+   * @param size Data size - bytes
+   * @param destinationAddress Destination node address (broadcast not allowed)
+   * @return int [0: ok, 1: busy (too many pending packets)]
+   */
+  int sendReliablePacket(const uint8_t *data, size_t size, unsigned int destinationAddress);
+
   /**
    * @brief Start listening for packets
    *
@@ -225,7 +745,7 @@ public:
    * @note Call `setOnReceiveTimeout()` to use listen timeout
    *
    * @param timeout Timeout for the listening in ms [0: continuous, any number]
-   * @return int [0: ok, 1: busy]
+   * @return int [0: ok, 1: busy (already listening)]
    */
   int listenToPacket(uint32_t timeout = 0);
 
@@ -236,64 +756,207 @@ private:
   static unsigned int _address;
 
   /**
-   * @brief Controls when the library is using callbacks internaly before call user callbacks
+   * @brief Kind of the frame being transmitted
+   */
+  enum TxKinds
+  {
+    TX_NONE,
+    TX_USER,
+    TX_RELIABLE,
+    TX_ACK,
+    // Copy of a broadcast sent on the other channels, without callbacks
+    TX_REPEAT
+  };
+
+  /**
+   * @brief Kind of the frame being transmitted
+   */
+  static TxKinds _txKind;
+
+  /**
+   * @brief Protocol timers, indexes on `_timers`
+   */
+  enum TimerIds
+  {
+    // User receive timeout of `listenToPacket()`
+    TIMER_RECEIVE,
+    // ADR session accepted by this node
+    TIMER_SESSION,
+    // Air time budget refilled for the frame waiting
+    TIMER_DUTY_CYCLE,
+    // CSMA/CA: data frames held (busy channel or an ACK to other node)
+    TIMER_CSMA,
+    // CSMA/CA: channel activity detection that never finished
+    TIMER_SENSING,
+    // Radio TX timeout elapsed, wakes the host so the radio `process()` handles it
+    TIMER_TX,
+    // + reliable send index: backoff before the attempt or ACK wait after it
+    TIMER_RELIABLE_SEND,
+    // + handle: wait of a frame on the transmit queues
+    TIMER_TX_QUEUE = TIMER_RELIABLE_SEND + HTLORAV3_MAX_RELIABLE_SENDS,
+    // + reassembly index: fragments stopped arriving
+    TIMER_REASSEMBLY = TIMER_TX_QUEUE + 2 * HTLORAV3_TX_QUEUE_SIZE,
+    TIMER_COUNT = TIMER_REASSEMBLY + HTLORAV3_MAX_REASSEMBLIES
+  };
+
+  /**
+   * @brief Timer wheel with every protocol timer
+   */
+  static HTLORAV3Timers _timers;
+
+  /**
+   * @brief Index on `_reliableSends` of the frame being transmitted [-1: none]
+   */
+  static int _txReliableIndex;
+
+  /**
+   * @brief Destination of the burst being sent, its next packet goes first [0: none]
    */
-  static bool _internalCallbacks;
+  static unsigned int _burstAddress;
 
   /**
-   * @brief Address to send ACK to [1-999, Default to 0: for no ACK]
+   * @brief Reliable packets waiting to be sent or acknowledged
    */
-  static unsigned int _sendACKTo;
+  static LoraReliableSend _reliableSends[HTLORAV3_MAX_RELIABLE_SENDS];
 
   /**
-   * @brief Current set receive timeout
+   * @brief Order given to the next reliable packet queued
    */
-  static unsigned long _receiveTimeoutMillis;
+  static uint32_t _reliableSendsSequence;
 
   /**
-   * @brief Millis timestamp for receive timeout
+   * @brief Transmit queue, one circular buffer per priority class
    */
-  static unsigned long _receiveTimeoutTimestamp;
+  static LoraTxQueueEntry _txQueue[2][HTLORAV3_TX_QUEUE_SIZE];
 
   /**
-   * @brief Current packet id [1-99, Default to 0: for none sent yet]
+   * @brief Index of the first frame of each `_txQueue` circular buffer
    */
-  static int _currentPacketId;
+  static int _txQueueHead[2];
 
   /**
-   * @brief Flag that controls when a packet should be ignored (eg: duplicated packet)
+   * @brief Number of frames on each `_txQueue` circular buffer
    */
-  static bool _ignorePacket;
+  static int _txQueueCount[2];
 
   /**
-   * @brief Last packet received
+   * @brief Destination address of the user frame being transmitted
    */
-  static LoraDataPacket _lastPacket;
+  static unsigned int _txDestinationAddress;
 
   /**
-   * @brief Store the last 10 node address and packet id of the received packets (circular buffer)
+   * @brief Packet id of the user frame being transmitted
    */
-  static ReceivedPacketInfo _receivedPacketsList[10];
+  static uint16_t _txPacketId;
 
   /**
-   * @brief Current index in the `_receivedPacketsList` circular buffer
+   * @brief Controls when the user is listening for packets with `listenToPacket()`
    */
-  static int _receivedPacketsIndex;
+  static bool _userListening;
 
   /**
-   * @brief Number of packets stored in the `_receivedPacketsList` list (0-10)
+   * @brief Current packet id [1-65535 (1-99 on legacy header), Default to 0: for none sent yet]
    */
-  static int _receivedPacketsCount;
+  static uint16_t _currentPacketId;
+
+  /**
+   * @brief Buffer where outgoing frames (header + data) are built before being sent
+   */
+  static uint8_t _txBuffer[HTLORAV3_MAX_PACKET_SIZE];
+
+  /**
+   * @brief Receive slots pool
+   */
+  static LoraReceiveSlot _receiveSlots[HTLORAV3_RX_POOL_SIZE];
+
+  /**
+   * @brief Reassembly buffers of fragmented messages, numbered as receive slots after `HTLORAV3_RX_POOL_SIZE`
+   */
+  static LoraReassembly _reassemblies[HTLORAV3_MAX_REASSEMBLIES];
+
+  /**
+   * @brief Id of the last fragmented message sent
+   */
+  static uint8_t _currentMessageId;
+
+  /**
+   * @brief Received packet ids window of each origin, indexed by the origin address
+   */
+  static ReceivedPacketsWindow _receivedPackets[HTLORAV3_MAX_ADDRESS + 1];
+
+  /**
+   * @brief Air time budget of each duty cycle band
+   */
+  static LoraDutyCycleBand _dutyCycleBands[HTLORAV3_DUTY_CYCLE_BANDS];
+
+  /**
+   * @brief Link quality table of the neighbours
+   */
+  static LoraLinkQuality _links[HTLORAV3_MAX_NEIGHBOURS];
+
+  /**
+   * @brief Link layer metrics
+   */
+  static LoraMetrics _metrics;
+
+  /**
+   * @brief Spreading factor the radio is configured with [0: not configured]
+   */
+  static int _modemSpreadingFactor;
+
+  /**
+   * @brief Tx side of the modem changed by `updateConfig()`, set before the next frame
+   */
+  static bool _txModemPending;
+
+  /**
+   * @brief Channel plan or modem changed by `updateConfig()` while on the air, retuned by `_retune()` once the radio is idle
+   */
+  static bool _channelPending;
+  static bool _modemPending;
+
+  /**
+   * @brief Channel the radio is tuned to, index on the channel plan [-1: not tuned]
+   */
+  static int _channel;
+
+  /**
+   * @brief Channel of the next copy of the broadcast at the head of the data queue
+   */
+  static int _broadcastChannel;
+
+  /**
+   * @brief Receive session: neighbour sending at a negotiated spreading factor [0: none]
+   */
+  static unsigned int _sessionAddress;
+  static int _sessionSpreadingFactor;
+
+  /**
+   * @brief CSMA/CA: contention window exponent and busy detections in a row
+   */
+  static int _csmaExponent;
+  static int _csmaBusyCount;
+
+  /**
+   * @brief CSMA/CA: last detection was clear, the next data frame can go right after it
+   */
+  static bool _channelClear;
+  static unsigned long _channelTimestamp;
 
   /**
    * @brief Config object
    */
-  HTLORAV3Config _config;
+  static HTLORAV3Config _config;
 
   /**
-   * @brief RadioEvents struct for setup Radio Lib
+   * @brief Radio backend
    */
-  static RadioEvents_t _RadioEvents;
+  static HTLORAV3Radio *_radio;
+
+  /**
+   * @brief Events bound to the radio backend
+   */
+  static LoraRadioEvents _RadioEvents;
 
   /**
    * @brief LoRa Chip state
@@ -308,30 +971,376 @@ private:
   void _initializeLora();
 
   /**
-   * @brief Internal version of `sendPacket` that don't return busy when `_internalCallbacks` is enable
+   * @brief Build the frame (header + data) and send it
    *
-   * @param data Data string to be sent
+   * @param data Data to be sent
+   * @param dataSize Data size - bytes
    * @param destinationAddress Destination node address (0 for broadcast)
-   * @return int [0: ok, 1: busy]
+   * @param packetId Packet id to put on the header
+   * @param flags Header flags (ignored on legacy header)
+   * @param binaryHeader Send with the binary header (false: legacy header)
+   * @param kind Kind of the frame
+   * @param spreadingFactor Spreading factor to send the frame [0: config spreading factor]
    */
-  int _sendPacket(const char *data, unsigned int destinationAddress = 0);
+  static void _transmit(const uint8_t *data, uint16_t dataSize, unsigned int destinationAddress, uint16_t packetId, uint8_t flags, bool binaryHeader, TxKinds kind, int spreadingFactor);
 
   /**
-   * @brief Internal version of `sendReliablePacket` that don't return busy when `_internalCallbacks` is enable
+   * @brief Configure the radio to send and listen with a spreading factor, if not already
    *
-   * @param data Data string to be sent
-   * @param destinationAddress Destination node address (broadcast not allowed)
-   * @return int [0: ok, 1: busy]
+   * @param spreadingFactor Spreading factor [0: config spreading factor]
    */
-  int _sendReliablePacket(const char *data, unsigned int destinationAddress);
+  static void _setModemSpreadingFactor(int spreadingFactor);
 
   /**
-   * @brief Internal version of `listenToPacket` that don't return busy when `_internalCallbacks` is enable
+   * @brief Get the modem parameters of the config with a spreading factor
    *
-   * @param timeout Timeout for the listening in ms [0: continuous, any number]
-   * @return int [0: ok, 1: busy]
+   * @param spreadingFactor Spreading factor
+   * @return LoraModemConfig Modem parameters
+   */
+  static LoraModemConfig _getModemConfig(int spreadingFactor);
+
+  /**
+   * @brief Tune the radio to a channel, if not already
+   *
+   * @param channel Index on the channel plan
    */
-  int _listenToPacket(uint32_t timeout = 0);
+  static void _setChannel(int channel);
+
+  /**
+   * @brief Retune the radio to the channel plan or modem changed by `updateConfig()`, if any
+   *
+   * @warning Only call while the radio is not sending nor sensing
+   *
+   * @return bool True if retuned, false if nothing changed
+   */
+  static bool _retune();
+
+  /**
+   * @brief Get the number of channels hopped over
+   *
+   * @return int Channel count [1: single channel]
+   */
+  static int _getChannelCount();
+
+  /**
+   * @brief Get the frequency of a channel
+   *
+   * @param channel Index on the channel plan
+   * @return double Channel RF frequency - Hz
+   */
+  static double _getChannelFrequency(int channel);
+
+  /**
+   * @brief Get the channel a node listens on
+   *
+   * @param address Node address
+   * @return int Index on the channel plan
+   */
+  static int _getHomeChannel(unsigned int address);
+
+  /**
+   * @brief Get the channel to send a frame on: the destination one, this node one for ACKs or the next one for broadcasts
+   *
+   * @param destinationAddress Destination node address (0 for broadcast)
+   * @param ack ACK frame (true) or data frame (false)
+   * @return int Index on the channel plan
+   */
+  static int _getTxChannel(unsigned int destinationAddress, bool ack);
+
+  /**
+   * @brief Get the channel to listen on: the one of a reliable send waiting for ACK or this node one
+   *
+   * @return int Index on the channel plan
+   */
+  static int _getListenChannel();
+
+  /**
+   * @brief Add a frame to the end of the transmit queue
+   *
+   * @param priority Priority class
+   * @return LoraTxQueueEntry* Entry to be filled [NULL: queue full]
+   */
+  static LoraTxQueueEntry *_enqueueFrame(TxPriorities priority);
+
+  /**
+   * @brief Send the first frame of the transmit queue, if its delay is over
+   *
+   * @param priority Priority class
+   * @return bool True if a frame was sent, false otherwise
+   */
+  static bool _transmitFromQueue(TxPriorities priority);
+
+  /**
+   * @brief Queue an ACK to the packet
+   *
+   * @param destinationAddress Origin address of the packet
+   * @param packetId Id of the packet
+   * @param legacyHeader Answer with the legacy header (the packet was received with the legacy header)
+   * @param rate Spreading factor accepted for the next frames of the link [0: none]
+   * @param spreadingFactor Spreading factor the packet was received with
+   * @param selective Answer with a selective ACK, covering every packet received from the destination
+   * @param more More packets of the burst follow, hold the ACK
+   */
+  static void _queueACK(unsigned int destinationAddress, uint16_t packetId, bool legacyHeader, int rate, int spreadingFactor, bool selective, bool more);
+
+  /**
+   * @brief Remove a frame from the middle of the transmit queue, keeping the order of the others
+   *
+   * @param priority Priority class
+   * @param position Position of the frame from the head of the queue
+   */
+  static void _removeQueuedFrame(TxPriorities priority, int position);
+
+  /**
+   * @brief Fill a selective ACK with the highest packet id received from its destination and the window bitmap below it
+   *
+   * @param entry ACK entry (nothing is done on other ACKs)
+   */
+  static void _fillACK(LoraTxQueueEntry &entry);
+
+  /**
+   * @brief Check if a queued ACK is only waiting its hold time, so it can go out with another frame
+   *
+   * @param entry ACK entry
+   * @return bool True if the ACK can be sent now, false otherwise
+   */
+  static bool _canCarryACK(const LoraTxQueueEntry &entry);
+
+  /**
+   * @brief Check if a queued ACK is waiting the turnaround (or burst) of its destination, so data frames must wait for it
+   *
+   * @note An ACK only waiting its hold time doesn't count, a data frame may carry it
+   *
+   * @return bool True if an ACK is in its turnaround, false otherwise
+   */
+  static bool _isACKTurnaround();
+
+  /**
+   * @brief Take a queued ACK to the destination out of the transmit queue, to be sent on a data frame
+   *
+   * @param destinationAddress Destination node address of the data frame
+   * @param flags Header flags of the data frame, the ACK must agree on the selective and rate flags
+   * @param spreadingFactor Spreading factor of the data frame
+   * @param frameSize Size of the data frame with the packet id after the ACK - bytes
+   * @param ack Filled with the ACK taken
+   * @return bool True if an ACK was taken, false otherwise
+   */
+  static bool _takeACK(unsigned int destinationAddress, uint8_t flags, int spreadingFactor, uint16_t frameSize, LoraTxQueueEntry &ack);
+
+  /**
+   * @brief Send the ACK with the other queued ACKs ready to go, on one broadcast frame
+   *
+   * @param ack ACK taken from the head of the queue
+   * @return bool True if a coalesced frame was sent, false if no other ACK could go with it
+   */
+  static bool _transmitCoalescedACKs(LoraTxQueueEntry &ack);
+
+  /**
+   * @brief Get the data size, checking it fits in a LoRa frame with the header and doesn't start with the fragment marker
+   *
+   * @param data Data to be sent
+   * @param dataSize Data size - bytes
+   * @return uint16_t Data size - bytes
+   */
+  static uint16_t _getDataSize(const uint8_t *data, size_t dataSize);
+
+  /**
+   * @brief Get the header size
+   *
+   * @param binaryHeader Binary header, otherwise legacy header
+   * @return uint8_t Header size - bytes
+   */
+  static uint8_t _getHeaderSize(bool binaryHeader);
+
+  /**
+   * @brief Get the next packet id
+   *
+   * @return uint16_t Packet id [1-65535 (1-99 on legacy header)]
+   */
+  static uint16_t _nextPacketId();
+
+  /**
+   * @brief Check if a frame can be transmitted now (radio not transmitting)
+   *
+   * @return bool True if a frame can be transmitted, false otherwise
+   */
+  static bool _canTransmit();
+
+  /**
+   * @brief Get the duty cycle band of a channel, refilling its budget
+   *
+   * @param channel Index on the channel plan
+   * @return LoraDutyCycleBand* Band, NULL if there is no duty cycle limit
+   */
+  static LoraDutyCycleBand *_getDutyCycleBand(int channel);
+
+  /**
+   * @brief Check if the band of a channel has air time for a frame
+   *
+   * @param frameSize Size of the frame (header + data) - bytes
+   * @param spreadingFactor Spreading factor of the frame [0: config spreading factor]
+   * @param channel Channel of the frame, index on the channel plan
+   *
+   * @return bool True if the frame fits in the duty cycle budget, false otherwise
+   */
+  static bool _hasAirTime(uint16_t frameSize, int spreadingFactor, int channel);
+
+  /**
+   * @brief Get the duration of one LoRa symbol with the current config
+   *
+   * @param spreadingFactor Spreading factor [0: config spreading factor]
+   *
+   * @return uint32_t Symbol time - us
+   */
+  static uint32_t _getSymbolTime(int spreadingFactor);
+
+  /**
+   * @brief Get the TX timeout, computed from the largest frame if not configured
+   *
+   * @return uint32_t TX timeout - ms
+   */
+  static uint32_t _getTxTimeout();
+
+  /**
+   * @brief Get the delay before answering with an ACK, the part of the sender turnaround not covered by the preamble
+   *
+   * @param spreadingFactor Spreading factor of the ACK [0: config spreading factor]
+   *
+   * @return uint32_t ACK delay - ms
+   */
+  static uint32_t _getACKDelay(int spreadingFactor);
+
+  /**
+   * @brief Get the time to wait for an ACK, computed from its time on air if not configured
+   *
+   * @param spreadingFactor Spreading factor of the ACK [0: config spreading factor]
+   *
+   * @return uint32_t ACK timeout - ms
+   */
+  static uint32_t _getACKTimeout(int spreadingFactor);
+
+  /**
+   * @brief Get a random backoff before a reliable send attempt, within the time of one exchange (frame + ACK)
+   *
+   * @param frameSize Size of the frame (header + data) - bytes
+   * @param spreadingFactor Spreading factor of the exchange [0: config spreading factor]
+   *
+   * @return uint32_t Backoff - ms
+   */
+  static uint32_t _getBackoff(uint16_t frameSize, int spreadingFactor);
+
+  /**
+   * @brief Get the CSMA/CA backoff slot: one channel activity detection and the time to start sending after it
+   *
+   * @param spreadingFactor Spreading factor [0: config spreading factor]
+   * @return uint32_t Slot - ms
+   */
+  static uint32_t _getCSMASlot(int spreadingFactor);
+
+  /**
+   * @brief CSMA/CA: check if a data frame can be sent now, starting a channel activity detection if needed
+   *
+   * @param spreadingFactor Spreading factor of the frame [0: config spreading factor]
+   * @param channel Channel of the frame, index on the channel plan
+   * @return bool True if the channel was just detected clear (or CSMA/CA is off), false if detecting
+   */
+  static bool _senseChannel(int spreadingFactor, int channel);
+
+  /**
+   * @brief CSMA/CA: hold the data frames for a time, unless they are already held for longer
+   *
+   * @param time Time to hold - ms
+   */
+  static void _deferChannel(uint32_t time);
+
+  /**
+   * @brief Get the neighbour entry on the link quality table
+   *
+   * @param address Neighbour node address
+   * @param create Take a free entry (or the least recently heard) if the neighbour is not on the table
+   * @return LoraLinkQuality* Neighbour entry [NULL: not found]
+   */
+  static LoraLinkQuality *_getLink(unsigned int address, bool create);
+
+  /**
+   * @brief Get the lowest spreading factor the link supports with margin, from its SNR and loss rate
+   *
+   * @param link Neighbour entry
+   * @return int Spreading factor [0: none below the config spreading factor]
+   */
+  static int _getBestSpreadingFactor(const LoraLinkQuality *link);
+
+  /**
+   * @brief Get the spreading factor to send reliable packets to a neighbour
+   *
+   * @param address Neighbour node address
+   * @return int Negotiated spreading factor if the session is alive, config spreading factor otherwise
+   */
+  static int _getLinkSpreadingFactor(unsigned int address);
+
+  /**
+   * @brief Get the spreading factor to listen with: the one of a reliable send waiting for ACK, the receive session or the config one
+   *
+   * @return int Spreading factor
+   */
+  static int _getListenSpreadingFactor();
+
+  /**
+   * @brief Accept or refuse the spreading factor proposed by a neighbour, starting or ending the receive session
+   *
+   * @param originAddress Neighbour node address
+   * @param rate Proposed spreading factor [0: none]
+   * @return int Accepted spreading factor [0: none]
+   */
+  static int _negotiateRate(unsigned int originAddress, int rate);
+
+  /**
+   * @brief Run the transmit state machine: ACK timeouts, retries, transmit queue and listen for ACKs
+   *
+   * @note Frames are sent in this order: control queue (ACKs), reliable packets, data queue. Nothing else is sent while an ACK waits its turnaround
+   */
+  static void _processTransmissions();
+
+  /**
+   * @brief Send the first reliable packet which backoff is over
+   *
+   * @param destinationAddress Only packets to this destination [0: any destination]
+   * @return bool True if a packet was sent, false otherwise
+   */
+  static bool _transmitReliable(unsigned int destinationAddress);
+
+  /**
+   * @brief Get the number of reliable packets sent to a destination before waiting for its ACK
+   *
+   * @return int ARQ window [1: stop-and-wait]
+   */
+  static int _getARQWindow();
+
+  /**
+   * @brief Check if a reliable packet is within the window of the oldest packets to its destination
+   *
+   * @param index Index on `_reliableSends`
+   * @param window ARQ window
+   * @return bool True if the packet can be sent, false otherwise
+   */
+  static bool _isInARQWindow(int index, int window);
+
+  /**
+   * @brief Get the oldest reliable packet waiting to be sent to a destination, within the window
+   *
+   * @param destinationAddress Destination node address
+   * @param window ARQ window
+   * @return int Index on `_reliableSends` [-1: none]
+   */
+  static int _getNextInWindow(unsigned int destinationAddress, int window);
+
+  /**
+   * @brief Finish a reliable send and call the callbacks
+   *
+   * @param index Index on `_reliableSends`
+   * @param success True if the packet was acknowledged
+   */
+  static void _finishReliableSend(int index, bool success);
 
   /**
    * @brief Function to be called when a packet is received
@@ -361,6 +1370,27 @@ private:
    */
   static void (*_onSendTimeout)();
 
+  /**
+   * @brief Function to be called when a reliable packet is acknowledged or given up
+   *
+   * @note Call `setOnReliableSendDone()` to set this function
+   */
+  static void (*_onReliableSendDone)(unsigned int destinationAddress, bool success, int retries);
+
+  /**
+   * @brief Function to be called when a packet queued by `sendPacket()` leaves the transmit queue
+   *
+   * @note Call `setOnPacketSendDone()` to set this function
+   */
+  static void (*_onPacketSendDone)(unsigned int destinationAddress, uint16_t packetId, bool success);
+
+  /**
+   * @brief Function to be called from the radio interrupt
+   *
+   * @note Call `setOnInterrupt()` to set this function
+   */
+  static void (*_onInterrupt)();
+
   // === Static Handlers ===
 
   /**
@@ -391,13 +1421,138 @@ private:
   static void _onRxTimeout();
 
   /**
-   * @brief Check if a packet with the given node address and packet ID is in the buffer
+   * @brief Function to be called when a protocol timer is due
+   *
+   * @param timer Timer (TimerIds)
+   */
+  static void _onTimer(int timer);
+
+  /**
+   * @brief Function to be called when the channel activity detection is done
+   *
+   * @param channelActivityDetected Busy channel, back off before trying again
+   */
+  static void _onCadDone(bool channelActivityDetected);
+
+  /**
+   * @brief Finish the reliable sends acknowledged by an ACK
+   *
+   * @param originAddress Address of the node that sent the ACK
+   * @param packetId Acknowledged packet id (highest packet id received on selective ACKs)
+   * @param bitmap Received bitmap of selective ACKs (4 bytes) [NULL: plain ACK]
+   * @param legacyHeader The ACK came with the legacy header (no packet id)
+   * @param rate Spreading factor accepted for the next frames of the link [0: none]
+   */
+  static void _onACK(unsigned int originAddress, uint16_t packetId, const uint8_t *bitmap, bool legacyHeader, int rate);
+
+  /**
+   * @brief Check if a packet with the given node address and packet ID was already received
+   *
+   * @note Packet ids older than the window are duplicates (late retries), unless the origin was silent for longer than
+   * `_getSequenceTimeout()`: then it restarted and they start a new sequence
    *
    * @param nodeAddress Address of the node to check
    * @param packetId Id of the packet to check
-   * @return bool True if the packet is found in the buffer, false otherwise
+   * @param legacyHeader The packet came with the legacy header (ids from 1 to 99)
+   * @return bool True if the packet was already received, false otherwise
+   */
+  static bool _isDuplicatedPacket(unsigned int nodeAddress, uint16_t packetId, bool legacyHeader);
+
+  /**
+   * @brief Mark a packet with the given node address and packet ID as received
+   *
+   * @param nodeAddress Address of the node that sent the packet
+   * @param packetId Id of the received packet
+   * @param legacyHeader The packet came with the legacy header (ids from 1 to 99)
+   */
+  static void _markPacketReceived(unsigned int nodeAddress, uint16_t packetId, bool legacyHeader);
+
+  /**
+   * @brief Get how much older a packet id is than the highest one received, on the wrap of its header format
+   *
+   * @param lastPacketId Highest packet id received
+   * @param packetId Packet id to compare
+   * @param legacyHeader Legacy header ids (from 1 to 99)
+   * @return int16_t Age [< 0: newer packet id]
+   */
+  static int16_t _getPacketIdAge(uint16_t lastPacketId, uint16_t packetId, bool legacyHeader);
+
+  /**
+   * @brief Get the longest time a reliable send keeps retrying the same packet id
+   *
+   * @param spreadingFactor Spreading factor of the frames
+   * @return uint32_t Time - ms
+   */
+  static uint32_t _getSequenceTimeout(int spreadingFactor);
+
+  /**
+   * @brief Write the header at the start of the buffer
+   *
+   * @param buffer Buffer with at least `HTLORAV3_LEGACY_HEADER_SIZE` bytes available
+   * @param header Header to be written
+   * @param binary Write the binary header instead of the legacy ASCII one
+   * @return uint8_t Header size written - bytes
+   */
+  static uint8_t _encodeHeader(uint8_t *buffer, const LoraHeader &header, bool binary);
+
+  /**
+   * @brief Read the header (binary or legacy ASCII) from the start of the payload
+   *
+   * @param payload Data received payload
+   * @param size Payload size
+   * @param header Header read from the payload
+   * @return uint8_t Header size read - bytes [0: no valid header found]
+   */
+  static uint8_t _decodeHeader(const uint8_t *payload, uint16_t size, LoraHeader &header);
+
+  /**
+   * @brief Parse a fixed length unsigned decimal number
+   *
+   * @param str Digits to parse (not null terminated)
+   * @param length Number of digits
+   * @return int Parsed number [-1: not a number]
+   */
+  static int _parseDigits(const uint8_t *str, uint8_t length);
+
+  /**
+   * @brief Take a free receive slot from the pool
+   *
+   * @return int Slot index [-1: no free slot]
+   */
+  static int _acquireSlot();
+
+  /**
+   * @brief Give a receive slot back to the pool, unless it is retained by the user
+   *
+   * @param slot Slot index [-1: none]
+   */
+  static void _releaseSlot(int slot);
+
+  /**
+   * @brief Put a received fragment on the reassembly buffer of its message
+   *
+   * @param originAddress Origin node address
+   * @param fragment Fragment (fragment header + data)
+   * @param size Fragment size - bytes
+   * @param headerSize Size of the frame header, the fragments of a message fill the frames up to `HTLORAV3_MAX_PACKET_SIZE`
+   * @return int Reassembly index [-1: dropped, no free buffer or invalid fragment]
+   */
+  static int _storeFragment(unsigned int originAddress, const uint8_t *fragment, uint16_t size, uint8_t headerSize);
+
+  /**
+   * @brief Check if all the fragments of a message were received
+   *
+   * @param reassembly Reassembly buffer
+   * @return bool True if the message is complete, false otherwise
+   */
+  static bool _isReassembled(const LoraReassembly &reassembly);
+
+  /**
+   * @brief Call `_onReceive` with the packet and give its slot back to the pool
+   *
+   * @param packet Packet to be delivered
    */
-  static bool _isPacketInBuffer(unsigned int nodeAddress, unsigned int packetId);
+  static void _deliverPacket(LoraDataPacket &packet);
 };
 
 /**
@@ -0,0 +1,159 @@
+/**
+ * @file htlorav3radio.h
+ * @brief Radio backend interface of the HTLORAV3 library
+ *
+ * Description:
+ *
+ * The link layer of `HTLORAV3` only talks to the radio through this interface, so it runs on top of any backend:
+ * - `HTLORAV3SX1262`: the SX1262 chip of the HelTec WiFi LoRa 32 V3 Board (default on the board)
+ * - `HTLORAV3TCP`: the RadioHead `RH_TCP` simulated ether, to run many nodes on one Linux machine
+ * - `HTLORAV3Sim`: the `htsim` discrete-event simulator, to run many nodes in one process on a virtual clock
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ *
+ * */
+
+#ifndef HTLORAV3RADIO_H
+#define HTLORAV3RADIO_H
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+// millis(), delay() and random() from the RadioHead simulator
+#include <RadioHead.h>
+#include <stdexcept>
+#endif
+
+// Length of a channel activity detection on the simulated backends (the SX1262 default) - symbols
+#define HTLORAV3_CAD_SYMBOLS 2
+
+// === Structs ===
+
+/**
+ * @brief Radio events, called from `HTLORAV3Radio::process()`
+ */
+typedef struct
+{
+  // Frame sent
+  void (*txDone)();
+  // Frame not sent in the TX timeout
+  void (*txTimeout)();
+  // Frame received (payload is only valid during the call)
+  void (*rxDone)(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+  // Nothing received in the receive timeout
+  void (*rxTimeout)();
+  // Channel activity detection finished
+  void (*cadDone)(bool channelActivityDetected);
+} LoraRadioEvents;
+
+/**
+ * @brief LoRa modem parameters, the same for Tx and Rx
+ */
+typedef struct
+{
+  // Output Power - dBm - [-3..22]
+  int txOutPower;
+  // Bandwidth - [0: 125 kHz, 1: 250 kHz, 2: 500 kHz, 3: Reserved]
+  int bandwidth;
+  // Spreading Factor - [SF7..SF12]
+  int spreadingFactor;
+  // Coding Rate - [1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8]
+  int codingRate;
+  // Preamble Length - Symbols
+  int preambleLength;
+  // Fix Length Payload On
+  bool fixLengthPayloadOn;
+  // IQ Inversion On
+  bool iqInversionOn;
+  // TX Timeout - ms
+  uint32_t txTimeout;
+  // RX Timeout - Symbols
+  int rxTimeout;
+} LoraModemConfig;
+
+/**
+ * @class HTLORAV3Radio
+ * @brief Radio backend used by `HTLORAV3`
+ *
+ * @note Every event is called from `process()`, never from an interrupt (only the `setOnInterrupt()` function is).
+ */
+class HTLORAV3Radio
+{
+public:
+  virtual ~HTLORAV3Radio() {}
+
+  /**
+   * @brief Initialize the radio and bind the events
+   *
+   * @param address Node address (only used by backends that simulate the links between nodes)
+   * @param events Events to be called, must live while the radio is used
+   */
+  virtual void begin(unsigned int address, const LoraRadioEvents *events) = 0;
+
+  /**
+   * @brief Handle the pending radio events, must be called on every loop
+   */
+  virtual void process() = 0;
+
+  /**
+   * @brief Set a function called from the radio interrupt when an event is pending, to wake the host that calls `process()`
+   *
+   * @note Backends without interrupts (simulated ones) ignore it, the host polls `process()`
+   *
+   * @param onInterrupt Function called in interrupt context [NULL: none]
+   */
+  virtual void setOnInterrupt(void (*)()) {}
+
+  /**
+   * @brief Set the channel frequency
+   *
+   * @param frequency Channel RF frequency - Hz
+   */
+  virtual void setChannel(uint32_t frequency) = 0;
+
+  /**
+   * @brief Configure the modem, out of receive mode
+   *
+   * @param modem Modem parameters
+   */
+  virtual void setModem(const LoraModemConfig &modem) = 0;
+
+  /**
+   * @brief Configure only the Tx side of the modem (output power and TX timeout), right before a send
+   *
+   * @note The default configures the whole modem, backends override it when the Tx side can be set alone
+   *
+   * @param modem Modem parameters
+   */
+  virtual void setTxModem(const LoraModemConfig &modem) { setModem(modem); }
+
+  /**
+   * @brief Send a frame, `txDone` or `txTimeout` is called when finished
+   *
+   * @param buffer Frame (copied before returning)
+   * @param size Frame size - bytes
+   */
+  virtual void send(uint8_t *buffer, uint8_t size) = 0;
+
+  /**
+   * @brief Start listening, `rxDone` is called for every frame received
+   *
+   * @param timeout Receive timeout - ms - [0: continuous]
+   */
+  virtual void receive(uint32_t timeout) = 0;
+
+  /**
+   * @brief Start a channel activity detection (LoRa preamble or symbols on the air) with the current modem, `cadDone` is called when finished
+   *
+   * @note Listening stops, the radio is idle after the detection
+   */
+  virtual void startCad() = 0;
+
+  /**
+   * @brief Stop sending, listening or detecting
+   */
+  virtual void sleep() = 0;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file htlorav3sim.cpp
+ * @brief Discrete-event simulator backend of the HTLORAV3 library
+ *
+ * Depends On:
+ * - htsim (Linux only)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3sim.h"
+
+#if !defined(ARDUINO)
+
+#include "htlorav3.h"
+
+HTLORAV3Sim::HTLORAV3Sim()
+    : _events(NULL),
+      _frequency(0),
+      _sending(false),
+      _sensing(false),
+      _receiving(false),
+      _rxTimestamp(0),
+      _rxTimeout(0)
+{
+  memset(&_modem, 0, sizeof(_modem));
+}
+
+void HTLORAV3Sim::begin(unsigned int, const LoraRadioEvents *events)
+{
+  // The simulator knows the node from the sketch copy running
+  _events = events;
+}
+
+void HTLORAV3Sim::process()
+{
+  if (_sending && !htsimIsSending())
+  {
+    _sending = false;
+    _events->txDone();
+  }
+
+  bool detected;
+  if (_sensing && htsimIsCadDone(&detected))
+  {
+    _sensing = false;
+    _events->cadDone(detected);
+  }
+
+  uint8_t frame[HTLORAV3_MAX_PACKET_SIZE];
+  uint8_t size;
+  int16_t rssi;
+  int8_t snr;
+
+  // Frames are only taken while listening, the simulator drops the ones which preamble was missed
+  while (_receiving && htsimReceive(frame, &size, &rssi, &snr))
+    _events->rxDone(frame, size, rssi, snr);
+
+  if (_receiving && _rxTimeout > 0 && (millis() - _rxTimestamp) >= _rxTimeout)
+  {
+    _receiving = false;
+    htsimSleep();
+    _events->rxTimeout();
+  }
+}
+
+void HTLORAV3Sim::setChannel(uint32_t frequency)
+{
+  _frequency = frequency;
+}
+
+void HTLORAV3Sim::setModem(const LoraModemConfig &modem)
+{
+  _modem = modem;
+}
+
+void HTLORAV3Sim::send(uint8_t *buffer, uint8_t size)
+{
+  _sensing = false;
+  _receiving = false;
+  _sending = true;
+
+  htsimSend(buffer, size, _frequency, _modem);
+}
+
+void HTLORAV3Sim::receive(uint32_t timeout)
+{
+  _sending = false;
+  _sensing = false;
+  _receiving = true;
+  _rxTimestamp = millis();
+  _rxTimeout = timeout;
+
+  htsimListen(_frequency, _modem);
+}
+
+void HTLORAV3Sim::startCad()
+{
+  _sending = false;
+  _receiving = false;
+  _sensing = true;
+
+  htsimStartCad(_frequency, _modem);
+}
+
+void HTLORAV3Sim::sleep()
+{
+  _sending = false;
+  _sensing = false;
+  _receiving = false;
+
+  htsimSleep();
+}
+
+#endif
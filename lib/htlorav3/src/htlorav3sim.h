@@ -0,0 +1,146 @@
+/**
+ * @file htlorav3sim.h
+ * @brief Discrete-event simulator backend of the HTLORAV3 library
+ *
+ * Description:
+ *
+ * Sends and receives the frames through the `htsim` discrete-event simulator (lib/htlorav3/tools/sim).
+ * The simulator loads one copy of the sketch per node in its own process and runs them on a virtual clock,
+ * modeling the time on air, the path loss, the collisions and the capture effect of the frames.
+ *
+ * The simulator API below is implemented by the simulator host and always applies to the node running.
+ *
+ * Depends On:
+ * - htsim (Linux only)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ *
+ * */
+
+#ifndef HTLORAV3SIM_H
+#define HTLORAV3SIM_H
+
+#if !defined(ARDUINO)
+
+#include "htlorav3radio.h"
+
+// === Simulator API ===
+
+/**
+ * @brief Start sending a frame, the radio is busy for its time on air
+ *
+ * @param frame Frame (copied)
+ * @param size Frame size - bytes
+ * @param frequency Channel RF frequency - Hz
+ * @param modem Modem parameters
+ */
+void htsimSend(const uint8_t *frame, uint8_t size, uint32_t frequency, const LoraModemConfig &modem);
+
+/**
+ * @brief Check if the last frame sent is still on the air
+ *
+ * @return bool True if sending, false otherwise
+ */
+bool htsimIsSending();
+
+/**
+ * @brief Start listening, frames which preamble starts while listening with the same channel and spreading factor are received
+ *
+ * @param frequency Channel RF frequency - Hz
+ * @param modem Modem parameters
+ */
+void htsimListen(uint32_t frequency, const LoraModemConfig &modem);
+
+/**
+ * @brief Start a channel activity detection of `HTLORAV3_CAD_SYMBOLS` symbols
+ *
+ * @param frequency Channel RF frequency - Hz
+ * @param modem Modem parameters
+ */
+void htsimStartCad(uint32_t frequency, const LoraModemConfig &modem);
+
+/**
+ * @brief Check if the channel activity detection is over
+ *
+ * @param detected Filled with the result when over: a frame on the same channel and spreading factor was heard during it
+ * @return bool True if over, false otherwise
+ */
+bool htsimIsCadDone(bool *detected);
+
+/**
+ * @brief Stop sending, listening or detecting
+ */
+void htsimSleep();
+
+/**
+ * @brief Take the next frame received (its time on air is over)
+ *
+ * @param frame Buffer with `HTLORAV3_MAX_PACKET_SIZE` bytes
+ * @param size Filled with the frame size - bytes
+ * @param rssi Filled with the Received Signal Strength Indicator - dBm
+ * @param snr Filled with the Signal-to-Noise Ratio - dB
+ * @return bool True if a frame was taken, false if there is none
+ */
+bool htsimReceive(uint8_t *frame, uint8_t *size, int16_t *rssi, int8_t *snr);
+
+/**
+ * @brief Set when the node runs again: the next `loop()` call comes after this time instead of the loop period,
+ * or earlier on a radio event
+ *
+ * @param ms Time from now, eg: the time until the next deadline returned by `HTLORAV3::process()` - ms - [UINT32_MAX: only on radio events]
+ */
+void htsimWakeAfter(uint32_t ms);
+
+/**
+ * @brief Add a sample to a named statistic, reported at the end of the simulation (count, mean, min and max)
+ *
+ * @param name Statistic name
+ * @param value Sample value
+ */
+void htsimRecord(const char *name, double value);
+
+/**
+ * @class HTLORAV3Sim
+ * @brief Radio backend for the htsim discrete-event simulator
+ */
+class HTLORAV3Sim : public HTLORAV3Radio
+{
+public:
+  HTLORAV3Sim();
+
+  void begin(unsigned int address, const LoraRadioEvents *events) override;
+  void process() override;
+  void setChannel(uint32_t frequency) override;
+  void setModem(const LoraModemConfig &modem) override;
+  void send(uint8_t *buffer, uint8_t size) override;
+  void receive(uint32_t timeout) override;
+  void startCad() override;
+  void sleep() override;
+
+private:
+  const LoraRadioEvents *_events;
+  LoraModemConfig _modem;
+  uint32_t _frequency;
+
+  /**
+   * @brief Transmission in progress
+   */
+  bool _sending;
+
+  /**
+   * @brief Channel activity detection in progress
+   */
+  bool _sensing;
+
+  /**
+   * @brief Listening, with the receive timeout
+   */
+  bool _receiving;
+  unsigned long _rxTimestamp;
+  uint32_t _rxTimeout;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file htlorav3sx1262.cpp
+ * @brief SX1262 radio backend of the HTLORAV3 library
+ *
+ * Depends On:
+ * - heltecautomation/Heltec ESP32 Dev-Boards@2.0.2
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3sx1262.h"
+
+#if defined(ARDUINO)
+
+// DIO1 interrupt handler of the Heltec radio driver, chained from ours
+extern "C" void RadioOnDioIrq(void);
+
+void (*volatile HTLORAV3SX1262::_onInterrupt)() = NULL;
+
+void HTLORAV3SX1262::begin(unsigned int, const LoraRadioEvents *events)
+{
+  // Pass the board type and the slow clock type for Heltec Wifi LoRa 32 V3 Board
+  Mcu.begin(HELTEC_BOARD, SLOW_CLK_TPYE);
+
+  // Bind Radio events, the signatures are the same
+  memset(&_RadioEvents, 0, sizeof(_RadioEvents));
+  _RadioEvents.TxDone = events->txDone;
+  _RadioEvents.TxTimeout = events->txTimeout;
+  _RadioEvents.RxDone = events->rxDone;
+  _RadioEvents.RxTimeout = events->rxTimeout;
+  _RadioEvents.CadDone = events->cadDone;
+
+  // Initialize and configure Radio
+  Radio.Init(&_RadioEvents);
+
+  // Replace the driver handler of DIO1 (one per pin) with one that also wakes the host
+  attachInterrupt(RADIO_DIO_1, _onDio1, RISING);
+
+  // Seed once from the radio noise, so nodes that boot together don't share backoff delays
+  randomSeed(Radio.Random());
+}
+
+void HTLORAV3SX1262::process()
+{
+  Mcu.timerhandler();
+  Radio.IrqProcess();
+}
+
+void HTLORAV3SX1262::setOnInterrupt(void (*onInterrupt)())
+{
+  _onInterrupt = onInterrupt;
+}
+
+void HTLORAV3SX1262::setChannel(uint32_t frequency)
+{
+  Radio.SetChannel(frequency);
+}
+
+void HTLORAV3SX1262::setModem(const LoraModemConfig &modem)
+{
+  setTxModem(modem);
+
+  Radio.SetRxConfig(
+      MODEM_LORA,
+      modem.bandwidth,
+      modem.spreadingFactor,
+      modem.codingRate,
+      0,
+      modem.preambleLength,
+      modem.rxTimeout,
+      modem.fixLengthPayloadOn,
+      0,
+      true,
+      0,
+      0,
+      modem.iqInversionOn,
+      true);
+}
+
+void HTLORAV3SX1262::setTxModem(const LoraModemConfig &modem)
+{
+  Radio.SetTxConfig(
+      MODEM_LORA,
+      modem.txOutPower,
+      0,
+      modem.bandwidth,
+      modem.spreadingFactor,
+      modem.codingRate,
+      modem.preambleLength,
+      modem.fixLengthPayloadOn,
+      true,
+      0,
+      0,
+      modem.iqInversionOn,
+      modem.txTimeout);
+}
+
+void HTLORAV3SX1262::send(uint8_t *buffer, uint8_t size)
+{
+  Radio.Send(buffer, size);
+}
+
+void HTLORAV3SX1262::receive(uint32_t timeout)
+{
+  Radio.Rx(timeout);
+}
+
+void HTLORAV3SX1262::startCad()
+{
+  Radio.StartCad();
+}
+
+void HTLORAV3SX1262::sleep()
+{
+  Radio.Sleep();
+}
+
+void IRAM_ATTR HTLORAV3SX1262::_onDio1()
+{
+  RadioOnDioIrq();
+
+  void (*onInterrupt)() = _onInterrupt;
+  if (onInterrupt != NULL)
+    onInterrupt();
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file htlorav3sx1262.h
+ * @brief SX1262 radio backend of the HTLORAV3 library
+ *
+ * Description:
+ *
+ * Drives the SX1262 chip of the HelTec WiFi LoRa 32 V3 Board through the Heltec `Radio` and `Mcu` singletons.
+ * It's the default backend of `HTLORAV3` on the board.
+ *
+ * Depends On:
+ * - heltecautomation/Heltec ESP32 Dev-Boards@2.0.2
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ *
+ * */
+
+#ifndef HTLORAV3SX1262_H
+#define HTLORAV3SX1262_H
+
+#if defined(ARDUINO)
+
+#include "htlorav3radio.h"
+
+// LoRa Libs
+#include <SPI.h>
+#include "radio/radio.h"
+#include "ESP32_Mcu.h"
+
+// SX1262 DIO1 pin on the board (interrupt line of every radio event)
+#ifndef RADIO_DIO_1
+#define RADIO_DIO_1 14
+#endif
+
+/**
+ * @class HTLORAV3SX1262
+ * @brief Radio backend for the SX1262 chip of the board
+ *
+ * @note The Heltec `Radio` is a singleton, only one instance can be used.
+ */
+class HTLORAV3SX1262 : public HTLORAV3Radio
+{
+public:
+  void begin(unsigned int address, const LoraRadioEvents *events) override;
+  void process() override;
+  void setOnInterrupt(void (*onInterrupt)()) override;
+  void setChannel(uint32_t frequency) override;
+  void setModem(const LoraModemConfig &modem) override;
+  void setTxModem(const LoraModemConfig &modem) override;
+  void send(uint8_t *buffer, uint8_t size) override;
+  void receive(uint32_t timeout) override;
+  void startCad() override;
+  void sleep() override;
+
+private:
+  /**
+   * @brief RadioEvents struct for setup Radio Lib
+   */
+  RadioEvents_t _RadioEvents;
+
+  /**
+   * @brief Function called from the DIO1 interrupt [NULL: none]
+   */
+  static void (*volatile _onInterrupt)();
+
+  /**
+   * @brief DIO1 interrupt: flags the event for `Radio.IrqProcess()` and wakes the host
+   */
+  static void _onDio1();
+};
+
+#endif
+
+#endif
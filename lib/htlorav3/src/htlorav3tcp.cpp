@@ -0,0 +1,177 @@
+/**
+ * @file htlorav3tcp.cpp
+ * @brief RadioHead ether simulator backend of the HTLORAV3 library
+ *
+ * Depends On:
+ * - RadioHead (RH_TCP, Linux only)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3tcp.h"
+
+#if !defined(ARDUINO)
+
+#include "htlorav3.h"
+
+HTLORAV3TCP::HTLORAV3TCP(const char *server)
+    : _driver(server),
+      _events(NULL),
+      _sending(false),
+      _sendFailed(false),
+      _txTimestamp(0),
+      _txTimeOnAir(0),
+      _receiving(false),
+      _rxTimestamp(0),
+      _rxTimeout(0),
+      _sensing(false),
+      _cadDetected(false),
+      _cadTimestamp(0),
+      _rxSize(0),
+      _rxFrameTimestamp(0)
+{
+  memset(&_modem, 0, sizeof(_modem));
+}
+
+void HTLORAV3TCP::begin(unsigned int address, const LoraRadioEvents *events)
+{
+  _events = events;
+
+  if (!_driver.init())
+    throw std::runtime_error("Could not connect to the ether simulator server.");
+
+  // Addressing is done by HTLORAV3, every frame is received
+  _driver.setPromiscuous(true);
+  _driver.setThisAddress(address);
+}
+
+void HTLORAV3TCP::process()
+{
+  if (_sending && (_sendFailed || (millis() - _txTimestamp) >= _txTimeOnAir))
+  {
+    bool failed = _sendFailed;
+    _sending = false;
+    _sendFailed = false;
+
+    if (failed)
+      _events->txTimeout();
+    else
+      _events->txDone();
+  }
+
+  while (_driver.available())
+  {
+    uint8_t size = RH_TCP_MAX_MESSAGE_LEN;
+    _driver.recv(_rxBuffer + HTLORAV3_TCP_HEADER_SIZE, &size);
+
+    if (_sensing)
+      _cadDetected = true;
+
+    // Like on the air, a frame is only caught while listening and not already receiving another one
+    if (!_receiving || _rxSize > 0)
+      continue;
+
+    _rxBuffer[0] = _driver.headerTo();
+    _rxBuffer[1] = _driver.headerFrom();
+    _rxBuffer[2] = _driver.headerId();
+    _rxBuffer[3] = _driver.headerFlags();
+
+    _rxSize = HTLORAV3_TCP_HEADER_SIZE + size;
+    _rxFrameTimestamp = millis();
+  }
+
+  // The frame is received at the end of its time on air, when the sender is done too
+  if (_rxSize > 0 && (millis() - _rxFrameTimestamp) >= HTLORAV3::getTimeOnAir(_rxSize, _modem.spreadingFactor))
+  {
+    uint16_t size = _rxSize;
+    _rxSize = 0;
+
+    if (_receiving)
+      _events->rxDone(_rxBuffer, size, HTLORAV3_TCP_RSSI, HTLORAV3_TCP_SNR);
+  }
+
+  if (_sensing && (millis() - _cadTimestamp) >= _getCadTime())
+  {
+    _sensing = false;
+    _events->cadDone(_cadDetected);
+  }
+
+  if (_receiving && _rxTimeout > 0 && (millis() - _rxTimestamp) >= _rxTimeout)
+  {
+    _receiving = false;
+    _events->rxTimeout();
+  }
+}
+
+void HTLORAV3TCP::setChannel(uint32_t)
+{
+  // The ether has a single channel
+}
+
+void HTLORAV3TCP::setModem(const LoraModemConfig &modem)
+{
+  _modem = modem;
+}
+
+void HTLORAV3TCP::send(uint8_t *buffer, uint8_t size)
+{
+  _receiving = false;
+  _sensing = false;
+  _rxSize = 0;
+  _sending = true;
+  _txTimestamp = millis();
+  _txTimeOnAir = HTLORAV3::getTimeOnAir(size, _modem.spreadingFactor);
+
+  if (size < HTLORAV3_TCP_HEADER_SIZE)
+  {
+    _sendFailed = true;
+    return;
+  }
+
+  _driver.setHeaderTo(buffer[0]);
+  _driver.setHeaderFrom(buffer[1]);
+  _driver.setHeaderId(buffer[2]);
+  _driver.setHeaderFlags(buffer[3], 0xFF);
+
+  _sendFailed = !_driver.send(buffer + HTLORAV3_TCP_HEADER_SIZE, size - HTLORAV3_TCP_HEADER_SIZE);
+}
+
+void HTLORAV3TCP::receive(uint32_t timeout)
+{
+  _sending = false;
+  _sensing = false;
+  _receiving = true;
+  _rxTimestamp = millis();
+  _rxTimeout = timeout;
+}
+
+void HTLORAV3TCP::startCad()
+{
+  // A frame being received is still on the air
+  _cadDetected = _receiving && _rxSize > 0;
+  _sending = false;
+  _receiving = false;
+  _rxSize = 0;
+  _sensing = true;
+  _cadTimestamp = millis();
+}
+
+void HTLORAV3TCP::sleep()
+{
+  _sending = false;
+  _receiving = false;
+  _sensing = false;
+  _rxSize = 0;
+}
+
+uint32_t HTLORAV3TCP::_getCadTime()
+{
+  static const uint32_t bandwidths[] = {125000, 250000, 500000};
+  uint32_t bandwidth = bandwidths[_modem.bandwidth >= 0 && _modem.bandwidth <= 2 ? _modem.bandwidth : 0];
+  uint32_t cadTime = HTLORAV3_CAD_SYMBOLS * ((uint32_t)1 << _modem.spreadingFactor) * 1000 / bandwidth;
+
+  return cadTime > 0 ? cadTime : 1;
+}
+
+#endif
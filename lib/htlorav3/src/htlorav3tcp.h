@@ -0,0 +1,111 @@
+/**
+ * @file htlorav3tcp.h
+ * @brief RadioHead ether simulator backend of the HTLORAV3 library
+ *
+ * Description:
+ *
+ * Sends and receives the frames through the RadioHead `RH_TCP` driver, connected to the `tools/etherSimulator.pl` server.
+ * Many nodes run as processes on one Linux machine, the ether delivers each frame to every other node.
+ *
+ * Limitations:
+ * - The ether has no channels nor spreading factors, every node hears every frame
+ * - Channel activity detection only sees the frames that reach the node during it (or the one being received)
+ * - The ether knows the nodes by an 8 bit address (the node address truncated), used on its delivery probability config
+ * - Frames are delivered with fixed RSSI and SNR
+ *
+ * Depends On:
+ * - RadioHead (RH_TCP, Linux only)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ *
+ * */
+
+#ifndef HTLORAV3TCP_H
+#define HTLORAV3TCP_H
+
+#if !defined(ARDUINO)
+
+#include "htlorav3radio.h"
+#include <RH_TCP.h>
+
+// RSSI reported for the frames from the ether - dBm
+#define HTLORAV3_TCP_RSSI -60
+// SNR reported for the frames from the ether - dB
+#define HTLORAV3_TCP_SNR 10
+// Bytes of the frame carried on the RH_TCP header (to, from, id and flags), so a full frame fits on its payload
+#define HTLORAV3_TCP_HEADER_SIZE 4
+
+/**
+ * @class HTLORAV3TCP
+ * @brief Radio backend for the RadioHead ether simulator
+ *
+ * @note The ether delivers frames at once, so the time on air (computed from the `HTLORAV3` config) is waited on both ends:
+ * the sender signals the end of the transmission and the receiver delivers the frame after it.
+ * A frame arriving while another one is being received is lost, like a collision.
+ */
+class HTLORAV3TCP : public HTLORAV3Radio
+{
+public:
+  /**
+   * @brief Construct a new HTLORAV3TCP object
+   *
+   * @param server Ether simulator server "name[:port]"
+   */
+  HTLORAV3TCP(const char *server = "localhost:4000");
+
+  /**
+   * @throw std::runtime_error If the ether simulator server can't be reached
+   */
+  void begin(unsigned int address, const LoraRadioEvents *events) override;
+  void process() override;
+  void setChannel(uint32_t frequency) override;
+  void setModem(const LoraModemConfig &modem) override;
+  void send(uint8_t *buffer, uint8_t size) override;
+  void receive(uint32_t timeout) override;
+  void startCad() override;
+  void sleep() override;
+
+private:
+  /**
+   * @brief Time of a channel activity detection with the current modem - ms
+   */
+  uint32_t _getCadTime();
+
+  RH_TCP _driver;
+  const LoraRadioEvents *_events;
+  LoraModemConfig _modem;
+
+  /**
+   * @brief Transmission in progress, done after its time on air
+   */
+  bool _sending;
+  bool _sendFailed;
+  unsigned long _txTimestamp;
+  uint32_t _txTimeOnAir;
+
+  /**
+   * @brief Listening, frames from the ether are dropped otherwise
+   */
+  bool _receiving;
+  unsigned long _rxTimestamp;
+  uint32_t _rxTimeout;
+
+  /**
+   * @brief Channel activity detection in progress, busy if a frame reaches the node during it
+   */
+  bool _sensing;
+  bool _cadDetected;
+  unsigned long _cadTimestamp;
+
+  /**
+   * @brief Frame being received, delivered after its time on air [size 0: none]
+   */
+  uint8_t _rxBuffer[HTLORAV3_TCP_HEADER_SIZE + RH_TCP_MAX_MESSAGE_LEN];
+  uint16_t _rxSize;
+  unsigned long _rxFrameTimestamp;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file htlorav3timers.cpp
+ * @brief Hierarchical timer wheel of the HTLORAV3 library
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3timers.h"
+
+// Span of the whole wheel, later timers wait on the overflow list - bits of the tick
+#define HTLORAV3_TIMER_WHEEL_BITS (HTLORAV3_TIMER_LEVELS * HTLORAV3_TIMER_SLOT_BITS)
+
+HTLORAV3Timers::HTLORAV3Timers()
+{
+  reset(0);
+}
+
+void HTLORAV3Timers::reset(unsigned long now)
+{
+  for (int i = 0; i < HTLORAV3_MAX_TIMERS; i++)
+    _timers[i].list = LIST_NONE;
+
+  for (int i = 0; i < LIST_NONE; i++)
+    _heads[i] = -1;
+  _dueTail = -1;
+
+  for (int i = 0; i < HTLORAV3_TIMER_LEVELS; i++)
+    _occupied[i] = 0;
+
+  _time = now;
+}
+
+void HTLORAV3Timers::start(int timer, unsigned long now, uint32_t timeout)
+{
+  stop(timer);
+
+  _timers[timer].deadline = (uint32_t)now + timeout;
+  _place(timer);
+}
+
+void HTLORAV3Timers::stop(int timer)
+{
+  if (_timers[timer].list != LIST_NONE)
+    _unlink(timer);
+}
+
+bool HTLORAV3Timers::isRunning(int timer)
+{
+  return _timers[timer].list != LIST_NONE && _timers[timer].list != LIST_DUE;
+}
+
+uint32_t HTLORAV3Timers::getRemaining(int timer, unsigned long now)
+{
+  if (!isRunning(timer))
+    return 0;
+
+  uint32_t remaining = _timers[timer].deadline - (uint32_t)now;
+
+  return (int32_t)remaining > 0 ? remaining : 0;
+}
+
+int HTLORAV3Timers::advance(unsigned long now)
+{
+  while (_heads[LIST_DUE] < 0)
+  {
+    uint32_t tick;
+
+    // Nothing else due up to now, the clock jumps over the empty slots
+    if (!_getNextTick(tick) || (int32_t)(tick - (uint32_t)now) > 0)
+    {
+      if ((int32_t)((uint32_t)now - _time) > 0)
+        _time = now;
+
+      return -1;
+    }
+
+    _time = tick;
+
+    // Blocks the clock entered, from the top: their timers move down
+    if ((tick & ((1UL << HTLORAV3_TIMER_WHEEL_BITS) - 1)) == 0)
+      _cascade(LIST_OVERFLOW);
+
+    for (int level = HTLORAV3_TIMER_LEVELS - 1; level > 0; level--)
+    {
+      int shift = level * HTLORAV3_TIMER_SLOT_BITS;
+
+      if ((tick & ((1UL << shift) - 1)) == 0)
+        _cascade(level * HTLORAV3_TIMER_SLOTS + ((tick >> shift) & (HTLORAV3_TIMER_SLOTS - 1)));
+    }
+
+    // Level 0 slots are one tick, every timer on the slot is due
+    int slot = tick & (HTLORAV3_TIMER_SLOTS - 1);
+
+    while (_heads[slot] >= 0)
+    {
+      int timer = _heads[slot];
+      _unlink(timer);
+      _link(timer, LIST_DUE);
+    }
+  }
+
+  int timer = _heads[LIST_DUE];
+  _unlink(timer);
+
+  return timer;
+}
+
+uint32_t HTLORAV3Timers::getTimeToNext(unsigned long now)
+{
+  if (_heads[LIST_DUE] >= 0)
+    return 0;
+
+  // Timers on a level are due before the ones on the levels above, and on a level the first slot is the earliest
+  int list = LIST_OVERFLOW;
+  uint32_t deadline = 0;
+
+  for (int level = 0; level < HTLORAV3_TIMER_LEVELS && list == LIST_OVERFLOW; level++)
+  {
+    if (_occupied[level] == 0)
+      continue;
+
+    list = level * HTLORAV3_TIMER_SLOTS + __builtin_ctzll(_occupied[level]);
+  }
+
+  if (_heads[list] < 0)
+    return HTLORAV3_TIMER_NONE;
+
+  // Timers on a slot above level 0 (or on the overflow list) are not sorted
+  for (int timer = _heads[list]; timer >= 0; timer = _timers[timer].next)
+    if (timer == _heads[list] || (int32_t)(_timers[timer].deadline - deadline) < 0)
+      deadline = _timers[timer].deadline;
+
+  uint32_t remaining = deadline - (uint32_t)now;
+
+  return (int32_t)remaining > 0 ? remaining : 0;
+}
+
+void HTLORAV3Timers::_place(int timer)
+{
+  uint32_t deadline = _timers[timer].deadline;
+
+  if ((int32_t)(deadline - _time) <= 0)
+  {
+    _link(timer, LIST_DUE);
+    return;
+  }
+
+  // The lowest level which block above holds both the deadline and the clock
+  for (int level = 0; level < HTLORAV3_TIMER_LEVELS; level++)
+  {
+    int shift = (level + 1) * HTLORAV3_TIMER_SLOT_BITS;
+
+    if ((deadline >> shift) == (_time >> shift))
+    {
+      int slot = (deadline >> (level * HTLORAV3_TIMER_SLOT_BITS)) & (HTLORAV3_TIMER_SLOTS - 1);
+      _link(timer, level * HTLORAV3_TIMER_SLOTS + slot);
+      return;
+    }
+  }
+
+  _link(timer, LIST_OVERFLOW);
+}
+
+void HTLORAV3Timers::_link(int timer, int list)
+{
+  Timer &entry = _timers[timer];
+  entry.list = list;
+  entry.next = -1;
+
+  if (list == LIST_DUE)
+  {
+    // Appended, so the due timers come out in order of deadline
+    entry.previous = _dueTail;
+
+    if (_dueTail >= 0)
+      _timers[_dueTail].next = timer;
+    else
+      _heads[LIST_DUE] = timer;
+
+    _dueTail = timer;
+    return;
+  }
+
+  entry.previous = -1;
+  entry.next = _heads[list];
+
+  if (entry.next >= 0)
+    _timers[entry.next].previous = timer;
+
+  _heads[list] = timer;
+
+  if (list < LIST_OVERFLOW)
+    _occupied[list / HTLORAV3_TIMER_SLOTS] |= 1ULL << (list % HTLORAV3_TIMER_SLOTS);
+}
+
+void HTLORAV3Timers::_unlink(int timer)
+{
+  Timer &entry = _timers[timer];
+  int list = entry.list;
+
+  if (entry.previous >= 0)
+    _timers[entry.previous].next = entry.next;
+  else
+    _heads[list] = entry.next;
+
+  if (entry.next >= 0)
+    _timers[entry.next].previous = entry.previous;
+  else if (list == LIST_DUE)
+    _dueTail = entry.previous;
+
+  if (list < LIST_OVERFLOW && _heads[list] < 0)
+    _occupied[list / HTLORAV3_TIMER_SLOTS] &= ~(1ULL << (list % HTLORAV3_TIMER_SLOTS));
+
+  entry.list = LIST_NONE;
+}
+
+void HTLORAV3Timers::_cascade(int list)
+{
+  // Detached first, overflow timers still beyond the wheel go back to the same list
+  int timer = _heads[list];
+  _heads[list] = -1;
+
+  if (list < LIST_OVERFLOW)
+    _occupied[list / HTLORAV3_TIMER_SLOTS] &= ~(1ULL << (list % HTLORAV3_TIMER_SLOTS));
+
+  while (timer >= 0)
+  {
+    int next = _timers[timer].next;
+    _place(timer);
+    timer = next;
+  }
+}
+
+bool HTLORAV3Timers::_getNextTick(uint32_t &time)
+{
+  bool found = false;
+  uint32_t nearest = 0;
+
+  // First slot after the clock on each level: fired on level 0, cascaded when the clock enters it on the others
+  for (int level = 0; level < HTLORAV3_TIMER_LEVELS; level++)
+  {
+    int shift = level * HTLORAV3_TIMER_SLOT_BITS;
+    int current = (_time >> shift) & (HTLORAV3_TIMER_SLOTS - 1);
+    uint64_t later = current == HTLORAV3_TIMER_SLOTS - 1 ? 0 : _occupied[level] & (~0ULL << (current + 1));
+
+    if (later == 0)
+      continue;
+
+    uint32_t block = (_time >> (shift + HTLORAV3_TIMER_SLOT_BITS)) << (shift + HTLORAV3_TIMER_SLOT_BITS);
+    uint32_t tick = block | ((uint32_t)__builtin_ctzll(later) << shift);
+
+    if (!found || tick - _time < nearest)
+      nearest = tick - _time;
+    found = true;
+  }
+
+  // The overflow list is placed again when the clock enters the next block of the whole wheel
+  if (_heads[LIST_OVERFLOW] >= 0)
+  {
+    uint32_t tick = ((_time >> HTLORAV3_TIMER_WHEEL_BITS) + 1) << HTLORAV3_TIMER_WHEEL_BITS;
+
+    if (!found || tick - _time < nearest)
+      nearest = tick - _time;
+    found = true;
+  }
+
+  time = _time + nearest;
+
+  return found;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file htlorav3timers.h
+ * @brief Hierarchical timer wheel of the HTLORAV3 library
+ *
+ * Description:
+ *
+ * One-shot timers with a 1 ms tick, identified by their index [0..HTLORAV3_MAX_TIMERS - 1], without heap allocation.
+ * Starting, stopping and firing a timer take constant time whatever the number of timers running, and the time until
+ * the next deadline is known without scanning them, so the host can sleep exactly that long.
+ *
+ * Each level of the wheel has 64 slots, a slot of level n spans 64^n ms: level 0 holds the timers due in the current
+ * 64 ms block, one slot per ms, level 1 the ones due in the current 4 s block and so on. When the clock enters a new
+ * block, the timers of its slot on the level above move down. Timers beyond the top level (~4.6 h) wait on an overflow list.
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ *
+ * */
+
+#ifndef HTLORAV3TIMERS_H
+#define HTLORAV3TIMERS_H
+
+#include <stdint.h>
+
+// === Constants ===
+
+// Max number of timers
+#ifndef HTLORAV3_MAX_TIMERS
+#define HTLORAV3_MAX_TIMERS 64
+#endif
+// Levels of the wheel, each one 64 times coarser than the one below
+#define HTLORAV3_TIMER_LEVELS 4
+// Slots per level (bits of the tick per level)
+#define HTLORAV3_TIMER_SLOT_BITS 6
+#define HTLORAV3_TIMER_SLOTS (1 << HTLORAV3_TIMER_SLOT_BITS)
+// Time until the next deadline when no timer is running - ms
+#define HTLORAV3_TIMER_NONE UINT32_MAX
+
+/**
+ * @class HTLORAV3Timers
+ * @brief Hierarchical timer wheel
+ *
+ * @note Times are `millis()` values, passed by the caller.
+ */
+class HTLORAV3Timers
+{
+public:
+  /**
+   * @brief Construct a new HTLORAV3Timers object, with every timer stopped
+   */
+  HTLORAV3Timers();
+
+  /**
+   * @brief Stop every timer and set the clock of the wheel
+   *
+   * @param now Current time - ms
+   */
+  void reset(unsigned long now);
+
+  /**
+   * @brief Start (or restart) a timer
+   *
+   * @param timer Timer index
+   * @param now Current time - ms
+   * @param timeout Time until the timer fires - ms - [0: fires on the next `advance()`]
+   */
+  void start(int timer, unsigned long now, uint32_t timeout);
+
+  /**
+   * @brief Stop a timer, it doesn't fire
+   *
+   * @param timer Timer index
+   */
+  void stop(int timer);
+
+  /**
+   * @brief Check if a timer is running (started and not due yet)
+   *
+   * @param timer Timer index
+   * @return bool True if running
+   */
+  bool isRunning(int timer);
+
+  /**
+   * @brief Get the time left on a timer
+   *
+   * @param timer Timer index
+   * @param now Current time - ms
+   * @return uint32_t Time left - ms - [0: not running]
+   */
+  uint32_t getRemaining(int timer, unsigned long now);
+
+  /**
+   * @brief Move the clock of the wheel and take the next timer due
+   *
+   * Call it until it returns -1, the timers come in order of deadline.
+   *
+   * @param now Current time - ms
+   * @return int Index of a timer due, stopped now [-1: none]
+   */
+  int advance(unsigned long now);
+
+  /**
+   * @brief Get the time until the next timer is due
+   *
+   * @param now Current time - ms
+   * @return uint32_t Time until the next deadline - ms - [0: a timer is due, HTLORAV3_TIMER_NONE: no timer running]
+   */
+  uint32_t getTimeToNext(unsigned long now);
+
+private:
+  /**
+   * @brief Where a timer is [0..levels * slots - 1: slot of the wheel]
+   */
+  enum TimerLists
+  {
+    LIST_OVERFLOW = HTLORAV3_TIMER_LEVELS * HTLORAV3_TIMER_SLOTS,
+    LIST_DUE,
+    LIST_NONE
+  };
+
+  /**
+   * @brief Timer entry, linked on the list of its slot
+   */
+  typedef struct
+  {
+    // Deadline - ms
+    uint32_t deadline;
+    // List of the timer (TimerLists or slot)
+    uint16_t list;
+    int16_t next;
+    int16_t previous;
+  } Timer;
+
+  Timer _timers[HTLORAV3_MAX_TIMERS];
+
+  /**
+   * @brief First timer of each slot, of the overflow list and of the due list [-1: empty]
+   */
+  int16_t _heads[LIST_NONE];
+
+  /**
+   * @brief Last timer of the due list, timers are appended in order of deadline
+   */
+  int16_t _dueTail;
+
+  /**
+   * @brief Bit n set: slot n of the level has timers
+   */
+  uint64_t _occupied[HTLORAV3_TIMER_LEVELS];
+
+  /**
+   * @brief Time of the wheel, every timer due up to it is on the due list - ms
+   */
+  uint32_t _time;
+
+  /**
+   * @brief Put a running timer on the slot of its deadline, relative to the time of the wheel
+   *
+   * @param timer Timer index
+   */
+  void _place(int timer);
+
+  /**
+   * @brief Link a timer at the end of a list
+   *
+   * @param timer Timer index
+   * @param list List (TimerLists or slot)
+   */
+  void _link(int timer, int list);
+
+  /**
+   * @brief Unlink a timer from its list
+   *
+   * @param timer Timer index
+   */
+  void _unlink(int timer);
+
+  /**
+   * @brief Place again every timer of a list, the clock entered its block
+   *
+   * @param list List (overflow or slot)
+   */
+  void _cascade(int list);
+
+  /**
+   * @brief Get the next time the wheel has work: a level 0 slot to fire or a slot to cascade
+   *
+   * @param time Set to that time - ms
+   * @return bool False if no timer is running
+   */
+  bool _getNextTick(uint32_t &time);
+};
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file dedup-benchmark.cpp
+ * @brief Host benchmark of the duplicated packet detection on a high rate trace of many senders
+ *
+ * Description:
+ *
+ * Replays a synthetic trace into the receive path of a node (`htsimreplay.h`): every frame is a reliable packet
+ * from a random sender, and some ACKs are lost, so the sender retries the same packet id some frames later
+ * (with every other sender talking in between). The packet ids of each sender start at a random point of the
+ * 16 bits sequence, so they wrap during the trace.
+ *
+ * Reports the receive path CPU time per frame, the duplicates delivered to the user and the packets dropped
+ * as duplicates by mistake, for the per-origin window of the library and for the 10 entries list
+ * (`_isPacketInBuffer()`, ids wrapping at 99) it replaced, run on the same trace.
+ *
+ * Build and run from the repository root: lib/htlorav3/tools/benchmarkBuild && ./htlorav3-dedup-benchmark [senders] [frames]
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htsimreplay.h"
+
+#include <chrono>
+
+#define BENCHMARK_ADDRESS 1
+#define BENCHMARK_FRAME_INTERVAL 20 // milliseconds, 50 frames per second on the node
+#define BENCHMARK_LOST_ACKS 20      // percent of the packets retried
+#define BENCHMARK_RETRY_DELAY 64    // frames, a retry comes up to this many frames later
+#define BENCHMARK_LIST_SIZE 10      // entries of the replaced list
+
+typedef struct
+{
+  uint16_t originAddress;
+  uint16_t packetId;
+  uint32_t index; // Packet of the trace, retries keep it
+} BenchmarkFrame;
+
+static HTLORAV3Sim radio;
+
+static BenchmarkFrame *trace;
+static bool *delivered;
+static uint32_t duplicatesDelivered = 0;
+
+static void onReceive(LoraDataPacket packet)
+{
+  uint32_t index;
+  memcpy(&index, packet.data + 1, sizeof(index));
+
+  if (delivered[index])
+    duplicatesDelivered++;
+  delivered[index] = true;
+
+  LoRa.listenToPacket();
+}
+
+static double nowNs()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Fill the trace, returns the packets in it (without the retries)
+ */
+static uint32_t makeTrace(BenchmarkFrame *frames, uint32_t count, int senders)
+{
+  uint16_t *nextPacketId = new uint16_t[senders];
+  BenchmarkFrame retries[BENCHMARK_RETRY_DELAY] = {};
+  uint32_t packets = 0;
+
+  for (int i = 0; i < senders; i++)
+    nextPacketId[i] = 1 + rand() % 65535;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    BenchmarkFrame &retry = retries[i % BENCHMARK_RETRY_DELAY];
+
+    if (retry.originAddress != 0)
+    {
+      frames[i] = retry;
+      retry.originAddress = 0;
+      continue;
+    }
+
+    int sender = rand() % senders;
+    frames[i].originAddress = BENCHMARK_ADDRESS + 1 + sender;
+    frames[i].packetId = nextPacketId[sender];
+    frames[i].index = packets++;
+
+    // Ids like `_nextPacketId()`: 0 is no id
+    nextPacketId[sender] = nextPacketId[sender] == 65535 ? 1 : nextPacketId[sender] + 1;
+
+    // ACK lost: the same packet again later, on a free slot
+    if (rand() % 100 < BENCHMARK_LOST_ACKS)
+    {
+      BenchmarkFrame &later = retries[(i + 1 + rand() % BENCHMARK_RETRY_DELAY) % BENCHMARK_RETRY_DELAY];
+      if (later.originAddress == 0)
+        later = frames[i];
+    }
+  }
+
+  delete[] nextPacketId;
+  return packets;
+}
+
+/**
+ * @brief Run the trace on the replaced list, counting the duplicates it lets through and the packets it drops
+ */
+static void runList(const BenchmarkFrame *frames, uint32_t count, uint32_t packets, uint32_t *duplicates, uint32_t *dropped)
+{
+  uint16_t listAddress[BENCHMARK_LIST_SIZE] = {0};
+  uint16_t listPacketId[BENCHMARK_LIST_SIZE] = {0};
+  int listIndex = 0;
+  bool *seen = new bool[packets]();
+
+  *duplicates = 0;
+  *dropped = 0;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    // Legacy ids go from 1 to 99
+    uint16_t packetId = (frames[i].packetId - 1) % 99 + 1;
+    bool found = false;
+
+    for (int j = 0; j < BENCHMARK_LIST_SIZE && !found; j++)
+      found = listAddress[j] == frames[i].originAddress && listPacketId[j] == packetId;
+
+    if (found)
+    {
+      if (!seen[frames[i].index])
+        (*dropped)++;
+      continue;
+    }
+
+    if (seen[frames[i].index])
+      (*duplicates)++;
+    seen[frames[i].index] = true;
+
+    listAddress[listIndex] = frames[i].originAddress;
+    listPacketId[listIndex] = packetId;
+    listIndex = (listIndex + 1) % BENCHMARK_LIST_SIZE;
+  }
+
+  delete[] seen;
+}
+
+int main(int argc, char **argv)
+{
+  int senders = argc > 1 ? atoi(argv[1]) : 200;
+  uint32_t count = argc > 2 ? atoi(argv[2]) : 200000;
+
+  if (senders < 1 || senders > HTLORAV3_MAX_ADDRESS - BENCHMARK_ADDRESS)
+  {
+    printf("senders must be from 1 to %d\n", HTLORAV3_MAX_ADDRESS - BENCHMARK_ADDRESS);
+    return 1;
+  }
+
+  trace = new BenchmarkFrame[count];
+  uint32_t packets = makeTrace(trace, count, senders);
+  delivered = new bool[packets]();
+
+  LoRa.setRadio(&radio);
+  LoRa.begin(BENCHMARK_ADDRESS);
+  LoRa.setOnReceive(onReceive);
+  LoRa.listenToPacket();
+
+  double receiveNs = 0;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint8_t data[1 + sizeof(uint32_t)] = {1}; // Not a fragment
+    uint8_t frame[HTLORAV3_MAX_PACKET_SIZE];
+    memcpy(data + 1, &trace[i].index, sizeof(uint32_t));
+    uint8_t size = htsimReplayEncode(frame, trace[i].originAddress, BENCHMARK_ADDRESS, trace[i].packetId, HTLORAV3_FLAG_ACK_REQUEST, data, sizeof(data));
+
+    htsimReplayFrame(frame, size);
+
+    double start = nowNs();
+    LoRa.process();
+    receiveNs += nowNs() - start;
+
+    // Send the ACK and wait for the next frame
+    htsimReplayRun(BENCHMARK_FRAME_INTERVAL);
+  }
+
+  uint32_t dropped = 0;
+  for (uint32_t i = 0; i < packets; i++)
+    if (!delivered[i])
+      dropped++;
+
+  uint32_t acks;
+  htsimReplaySent(&acks);
+
+  uint32_t listDuplicates, listDropped;
+  runList(trace, count, packets, &listDuplicates, &listDropped);
+
+  printf("trace: %d senders, %u frames (%u packets, %u retries), one every %d ms\n", senders, count, packets, count - packets, BENCHMARK_FRAME_INTERVAL);
+  printf("window: %.0f ns/frame receive path, %u duplicates delivered, %u packets dropped, %u detected, %u frames sent\n",
+         receiveNs / count, duplicatesDelivered, dropped, LoRa.getMetrics().rxDuplicates, acks);
+  printf("list of %d: %u duplicates delivered, %u packets dropped\n", BENCHMARK_LIST_SIZE, listDuplicates, listDropped);
+
+  delete[] trace;
+  delete[] delivered;
+  return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file header-benchmark.cpp
+ * @brief Host benchmark of the binary link header against the legacy ASCII one
+ *
+ * Description:
+ *
+ * Encodes and decodes a set of random headers with `_encodeHeader()`/`_decodeHeader()` in both formats,
+ * reporting the CPU time per header, the header size and the time on air of a frame with each header
+ * on every spreading factor (default config: 125 kHz, CR 4/5, 8 symbols preamble).
+ *
+ * Build and run from the repository root: lib/htlorav3/tools/benchmarkBuild && ./htlorav3-header-benchmark [payload bytes]
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+// The header codec is private to the library
+#define private public
+#include "htlorav3.h"
+#undef private
+
+#include "htsimreplay.h"
+
+#include <chrono>
+
+#define BENCHMARK_HEADERS 100000 // headers per run
+#define BENCHMARK_RUNS 5         // runs, the best is reported
+
+static volatile unsigned long sink; // Keeps the decoded values alive
+
+static double nowNs()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+  int payload = argc > 1 ? atoi(argv[1]) : 20;
+
+  if (payload < 0 || payload > HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE)
+  {
+    printf("payload must be from 0 to %d bytes\n", HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE);
+    return 1;
+  }
+
+  LoraHeader *headers = new LoraHeader[BENCHMARK_HEADERS];
+  uint8_t *output = new uint8_t[(size_t)BENCHMARK_HEADERS * HTLORAV3_LEGACY_HEADER_SIZE];
+
+  LoRa.setConfig(HTLORAV3::getDefaultConfig());
+
+  printf("%d headers, %d-byte payload\n", BENCHMARK_HEADERS, payload);
+  printf("%-7s %6s %13s %13s", "format", "bytes", "encode ns/hdr", "decode ns/hdr");
+  for (int sf = 7; sf <= 12; sf++)
+    printf(" %7s%-2d", "ms SF", sf);
+  printf("\n");
+
+  for (int format = 1; format >= 0; format--)
+  {
+    bool binary = format == 1;
+
+    srand(1);
+    for (int i = 0; i < BENCHMARK_HEADERS; i++)
+    {
+      headers[i].originAddress = 1 + rand() % HTLORAV3_MAX_ADDRESS;
+      headers[i].destinationAddress = rand() % (HTLORAV3_MAX_ADDRESS + 1);
+      headers[i].packetId = binary ? 1 + rand() % 65535 : 1 + rand() % 99;
+      headers[i].flags = binary ? HTLORAV3_FLAG_ACK_REQUEST : 0;
+    }
+
+    uint8_t size = 0;
+    double encodeNs = 0, decodeNs = 0;
+
+    // Best of a few runs, the host is not idle
+    for (int run = 0; run < BENCHMARK_RUNS; run++)
+    {
+      double start = nowNs();
+      for (int i = 0; i < BENCHMARK_HEADERS; i++)
+        size = HTLORAV3::_encodeHeader(output + (size_t)i * HTLORAV3_LEGACY_HEADER_SIZE, headers[i], binary);
+      double encoded = nowNs();
+      for (int i = 0; i < BENCHMARK_HEADERS; i++)
+      {
+        LoraHeader header;
+        if (HTLORAV3::_decodeHeader(output + (size_t)i * HTLORAV3_LEGACY_HEADER_SIZE, HTLORAV3_LEGACY_HEADER_SIZE, header) != size ||
+            header.originAddress != headers[i].originAddress || header.destinationAddress != headers[i].destinationAddress ||
+            header.packetId != headers[i].packetId || header.flags != headers[i].flags)
+        {
+          printf("Header %d decoded wrong\n", i);
+          return 1;
+        }
+        sink += header.packetId;
+      }
+      double end = nowNs();
+
+      if (run == 0 || encoded - start < encodeNs)
+        encodeNs = encoded - start;
+      if (run == 0 || end - encoded < decodeNs)
+        decodeNs = end - encoded;
+    }
+
+    printf("%-7s %6u %13.1f %13.1f", binary ? "binary" : "legacy", size, encodeNs / BENCHMARK_HEADERS, decodeNs / BENCHMARK_HEADERS);
+    for (int sf = 7; sf <= 12; sf++)
+      printf(" %9u", HTLORAV3::getTimeOnAir(size + payload, sf));
+    printf("\n");
+  }
+
+  delete[] headers;
+  delete[] output;
+  return 0;
+}
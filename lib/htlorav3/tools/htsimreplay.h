@@ -0,0 +1,223 @@
+/**
+ * @file htsimreplay.h
+ * @brief Single node host of the HTLORAV3 simulator backend, for the host benchmarks and tests
+ *
+ * Description:
+ *
+ * Implements the simulator API (htlorav3sim.h) and the sketch environment (`millis()`, `random()`) for one node,
+ * without the htsim process: the program drives `LoRa` with a `HTLORAV3Sim` radio itself, replaying frames
+ * into its receive path on a virtual clock.
+ * - Frames replayed are taken on the next `LoRa.process()` while listening, like htsim delivers them
+ * - Frames sent are on the air for no time, the last one is kept
+ * - Channel activity detection is never busy
+ *
+ * It defines the API, so include it once per program. It uses no heap, the receive path can be checked for allocations.
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef HTSIMREPLAY_H
+#define HTSIMREPLAY_H
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Frames replayed and not taken yet
+#define HTSIMREPLAY_QUEUE_SIZE 16
+
+typedef struct
+{
+  uint8_t frame[HTLORAV3_MAX_PACKET_SIZE];
+  uint8_t size;
+  int16_t rssi;
+  int8_t snr;
+} HTSimReplayFrame;
+
+static unsigned long _replayTime = 0;
+static bool _replayListening = false;
+static HTSimReplayFrame _replayQueue[HTSIMREPLAY_QUEUE_SIZE];
+static int _replayHead = 0;
+static int _replayCount = 0;
+static HTSimReplayFrame _replaySent;
+static uint32_t _replaySentCount = 0;
+
+// === Sketch Environment ===
+
+unsigned long millis()
+{
+  return _replayTime;
+}
+
+void delay(unsigned long ms)
+{
+  _replayTime += ms;
+}
+
+long random(long to)
+{
+  return to > 0 ? rand() % to : 0;
+}
+
+long random(long from, long to)
+{
+  return to > from ? from + random(to - from) : from;
+}
+
+// === Simulator API ===
+
+void htsimSend(const uint8_t *frame, uint8_t size, uint32_t, const LoraModemConfig &)
+{
+  _replayListening = false;
+  memcpy(_replaySent.frame, frame, size);
+  _replaySent.size = size;
+  _replaySentCount++;
+}
+
+bool htsimIsSending()
+{
+  return false;
+}
+
+void htsimListen(uint32_t, const LoraModemConfig &)
+{
+  _replayListening = true;
+}
+
+void htsimStartCad(uint32_t, const LoraModemConfig &)
+{
+  _replayListening = false;
+}
+
+bool htsimIsCadDone(bool *detected)
+{
+  *detected = false;
+  return true;
+}
+
+void htsimSleep()
+{
+  _replayListening = false;
+}
+
+bool htsimReceive(uint8_t *frame, uint8_t *size, int16_t *rssi, int8_t *snr)
+{
+  if (!_replayListening || _replayCount == 0)
+    return false;
+
+  const HTSimReplayFrame &replayed = _replayQueue[_replayHead];
+  memcpy(frame, replayed.frame, replayed.size);
+  *size = replayed.size;
+  *rssi = replayed.rssi;
+  *snr = replayed.snr;
+
+  _replayHead = (_replayHead + 1) % HTSIMREPLAY_QUEUE_SIZE;
+  _replayCount--;
+  return true;
+}
+
+void htsimWakeAfter(uint32_t)
+{
+  // The program runs the clock, see `htsimReplayRun()`
+}
+
+void htsimRecord(const char *name, double value)
+{
+  printf("%s: %.3f\n", name, value);
+}
+
+// === Replay ===
+
+/**
+ * @brief Write a frame with the binary header (layout on `LoraHeader`)
+ *
+ * @param frame Buffer with `HTLORAV3_MAX_PACKET_SIZE` bytes
+ * @param originAddress Origin node address
+ * @param destinationAddress Destination node address
+ * @param packetId Packet id
+ * @param flags Header flags
+ * @param data Frame data, must not start with a zero byte (fragment)
+ * @param size Data size - bytes
+ * @return uint8_t Frame size - bytes
+ */
+static inline uint8_t htsimReplayEncode(uint8_t *frame, uint16_t originAddress, uint16_t destinationAddress, uint16_t packetId, uint8_t flags,
+                                        const uint8_t *data, uint8_t size)
+{
+  frame[0] = flags | HTLORAV3_FLAG_BINARY;
+  frame[1] = (originAddress >> 4) & 0xFF;
+  frame[2] = ((originAddress & 0x0F) << 4) | ((destinationAddress >> 8) & 0x0F);
+  frame[3] = destinationAddress & 0xFF;
+  frame[4] = packetId >> 8;
+  frame[5] = packetId & 0xFF;
+  memcpy(frame + HTLORAV3_BINARY_HEADER_SIZE, data, size);
+
+  return HTLORAV3_BINARY_HEADER_SIZE + size;
+}
+
+/**
+ * @brief Put a frame on the air of the node, taken on the next `LoRa.process()` while listening
+ *
+ * @param frame Frame (copied)
+ * @param size Frame size - bytes
+ * @param rssi Received Signal Strength Indicator - dBm
+ * @param snr Signal-to-Noise Ratio - dB
+ * @return bool True if queued, false if `HTSIMREPLAY_QUEUE_SIZE` frames are waiting
+ */
+static inline bool htsimReplayFrame(const uint8_t *frame, uint8_t size, int16_t rssi = -60, int8_t snr = 8)
+{
+  if (_replayCount == HTSIMREPLAY_QUEUE_SIZE)
+    return false;
+
+  HTSimReplayFrame &replayed = _replayQueue[(_replayHead + _replayCount) % HTSIMREPLAY_QUEUE_SIZE];
+  memcpy(replayed.frame, frame, size);
+  replayed.size = size;
+  replayed.rssi = rssi;
+  replayed.snr = snr;
+
+  _replayCount++;
+  return true;
+}
+
+/**
+ * @brief Run the node for some time: `LoRa.process()` at each of its deadlines (timers, ACKs, retries)
+ *
+ * @param ms Time to run - ms
+ */
+static inline void htsimReplayRun(uint32_t ms)
+{
+  unsigned long end = _replayTime + ms;
+
+  while (true)
+  {
+    uint32_t wait = LoRa.process();
+
+    if (_replayTime >= end)
+      break;
+
+    // At least 1 ms, the `millis()` resolution
+    if (wait < 1)
+      wait = 1;
+    _replayTime = end - _replayTime < wait ? end : _replayTime + wait;
+  }
+}
+
+/**
+ * @brief Get the last frame sent by the node
+ *
+ * @param count Filled with the frames sent since the start
+ * @return const HTSimReplayFrame& Last frame sent
+ */
+static inline const HTSimReplayFrame &htsimReplaySent(uint32_t *count)
+{
+  *count = _replaySentCount;
+  return _replaySent;
+}
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file rxheap-test.cpp
+ * @brief Host test: the receive path of HTLORAV3 doesn't touch the heap
+ *
+ * Description:
+ *
+ * Counts every `malloc()`/`new` of the program while a node (`htsimreplay.h`) receives frames from several senders
+ * (reliable ones with their ACKs, plain ones and broadcasts, some duplicated), retaining some packets on the
+ * `onReceive` callback and releasing them later. After a warm up, the steady state must do no allocation.
+ *
+ * Build and run from the repository root: lib/htlorav3/tools/testBuild && ./htlorav3-rxheap-test [frames]
+ * Exits with 1 when an allocation is counted or a packet is lost.
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htsimreplay.h"
+
+#include <new>
+
+#define TEST_ADDRESS 1
+#define TEST_SENDERS 8
+#define TEST_WARMUP 100             // frames before counting
+#define TEST_FRAME_INTERVAL 20      // milliseconds
+#define TEST_RETAINED (HTLORAV3_RX_POOL_SIZE - 1) // packets held at once, one slot is left for the receptions
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+extern "C" void __libc_free(void *pointer);
+
+static bool counting = false;
+static uint32_t allocations = 0;
+
+// === Heap Interposition ===
+
+extern "C" void *malloc(size_t size)
+{
+  if (counting)
+    allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  if (counting)
+    allocations++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+  if (counting)
+    allocations++;
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer)
+{
+  __libc_free(pointer);
+}
+
+void *operator new(size_t size)
+{
+  void *pointer = malloc(size);
+  if (pointer == NULL)
+    throw std::bad_alloc();
+  return pointer;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+  free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+  free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+  free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+  free(pointer);
+}
+
+// === Node ===
+
+static HTLORAV3Sim radio;
+
+static LoraDataPacket retained[TEST_RETAINED];
+static int retainedCount = 0;
+static uint32_t received = 0;
+static uint32_t corrupted = 0;
+
+static void onReceive(LoraDataPacket packet)
+{
+  uint32_t frame;
+  memcpy(&frame, packet.data + 1, sizeof(frame));
+  received++;
+
+  // Every other packet is kept after the callback, while a slot is left
+  if (frame % 2 == 0 && retainedCount < TEST_RETAINED && LoRa.retainPacket(packet))
+    retained[retainedCount++] = packet;
+
+  LoRa.listenToPacket();
+}
+
+/**
+ * @brief Release the packets retained, checking their data was kept
+ */
+static void releaseRetained()
+{
+  for (int i = 0; i < retainedCount; i++)
+  {
+    uint32_t frame;
+    memcpy(&frame, retained[i].data + 1, sizeof(frame));
+    if (frame % 2 != 0)
+      corrupted++;
+
+    LoRa.releasePacket(retained[i]);
+  }
+
+  retainedCount = 0;
+}
+
+/**
+ * @brief Replay the frames from `first`, returns the packets the node should deliver
+ */
+static uint32_t replay(uint32_t first, uint32_t count)
+{
+  static uint16_t packetIds[TEST_SENDERS] = {0};
+  static uint8_t lastFrames[TEST_SENDERS][HTLORAV3_MAX_PACKET_SIZE];
+  static uint8_t lastSizes[TEST_SENDERS] = {0};
+  static bool lastReliable[TEST_SENDERS] = {false};
+  uint32_t packets = 0;
+
+  for (uint32_t i = first; i < first + count; i++)
+  {
+    int sender = i % TEST_SENDERS;
+
+    // The ACK of the last frame of the sender was lost: the same frame again, only delivered if it wasn't reliable
+    if (i % 7 == 0 && lastSizes[sender] > 0)
+    {
+      htsimReplayFrame(lastFrames[sender], lastSizes[sender]);
+      if (!lastReliable[sender])
+        packets++;
+    }
+    else
+    {
+      bool broadcast = i % 5 == 0;
+      bool reliable = !broadcast && i % 3 != 0;
+
+      packetIds[sender] = packetIds[sender] == 65535 ? 1 : packetIds[sender] + 1;
+
+      uint8_t data[1 + sizeof(uint32_t)] = {1}; // Not a fragment
+      memcpy(data + 1, &i, sizeof(i));
+      lastSizes[sender] = htsimReplayEncode(lastFrames[sender], TEST_ADDRESS + 1 + sender, broadcast ? 0 : TEST_ADDRESS, packetIds[sender],
+                                            reliable ? HTLORAV3_FLAG_ACK_REQUEST : 0, data, sizeof(data));
+      lastReliable[sender] = reliable;
+
+      htsimReplayFrame(lastFrames[sender], lastSizes[sender]);
+      packets++;
+    }
+
+    htsimReplayRun(TEST_FRAME_INTERVAL);
+
+    if (i % 4 == 3)
+      releaseRetained();
+  }
+
+  releaseRetained();
+  return packets;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? atoi(argv[1]) : 100000;
+
+  LoRa.setRadio(&radio);
+  LoRa.begin(TEST_ADDRESS);
+  LoRa.setOnReceive(onReceive);
+  LoRa.listenToPacket();
+
+  // First use of the library and the C library (eg: stdio buffers) may allocate
+  replay(0, TEST_WARMUP);
+  received = 0;
+
+  counting = true;
+  uint32_t packets = replay(TEST_WARMUP, count);
+  counting = false;
+
+  uint32_t acks;
+  htsimReplaySent(&acks);
+
+  printf("%u frames from %d senders: %u packets received of %u, %u ACKs sent, %u duplicates dropped\n",
+         count, TEST_SENDERS, received, packets, acks, LoRa.getMetrics().rxDuplicates);
+  printf("heap: %u allocations on the steady state\n", allocations);
+
+  if (allocations > 0 || received != packets || corrupted > 0)
+  {
+    printf("FAILED%s\n", corrupted > 0 ? " (retained packets changed)" : "");
+    return 1;
+  }
+
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file batch-policy.cpp
+ * @brief htsim scenario: air time per sensor reading with and without holding the readings for full batches
+ *
+ * Description:
+ *
+ * Node 1 is the sink, every other node reads a sensor every period and sends its readings to the previous address,
+ * which forwards them with its own, like `src/main.cpp`: a reliable batch at a time, one series per origin (`sensorseries.h`).
+ * When a batch is sent is decided by a `SensorBatchPolicy`: with a max age of 0 the readings go out as soon as the node
+ * is free to send (one or ten), otherwise they wait for a full frame, or until the oldest one is max age old.
+ *
+ * Recorded statistics:
+ * - taken: readings taken by the sensors
+ * - covered: readings the sink got, counted once
+ * - latency: time from the reading to the sink - ms
+ * - airtime: air time of every frame sent, ACKs included - ms
+ * - fill: payload of the batches sent over the payload budget [0-1]
+ * - delivered: reliable sends acknowledged (1) or failed (0)
+ * - dropped: readings dropped on a full relay queue
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/batch-policy.cpp lib/sensorcodec/src/*.cpp
+ * ./htsim -c lib/htlorav3/tools/sim/batch-policy.conf -t 3600 ./batch-policy.so 10 60 # read period - s, max age - s
+ *
+ * Or the air time per reading of several read periods and max ages with `lib/htlorav3/tools/sim/batch-policy.sh`.
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ * - sensorcodec (sensorseries.h, sensorbatchpolicy.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+#include "sensorbatchpolicy.h"
+#include "sensorseries.h"
+
+#include <string.h>
+
+#define SINK_ADDRESS 1
+// Readings waiting to be sent on each node
+#define QUEUE_LENGTH 256
+// One frame with any header - bytes
+#define BATCH_SIZE (HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE)
+// Origins and readings per origin tracked by the sink
+#define MAX_ORIGINS 32
+#define MAX_READINGS 8640
+
+HTLORAV3Sim radio;
+SensorBatchPolicy policy;
+
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+
+unsigned int address = 0;
+unsigned long period = 10000;
+unsigned long readTimestamp = 0;
+int readIndex = 0;
+uint32_t airTime = 0;
+
+SensorData readings[QUEUE_LENGTH];
+int readingCount = 0;
+
+// Batch waiting for its ACK, removed from the queue once delivered
+int sendingReadings = 0;
+
+// Readings covered at the sink, by origin and index
+bool covered[MAX_ORIGINS][MAX_READINGS];
+
+void queueReading(const SensorData &data)
+{
+  if (readingCount == QUEUE_LENGTH)
+  {
+    htsimRecord("dropped", 1);
+    return;
+  }
+
+  readings[readingCount++] = data;
+  policy.add(millis());
+}
+
+bool writeBatch(SensorSeriesWriter &writer, int count)
+{
+  SensorData series[QUEUE_LENGTH];
+  bool written[QUEUE_LENGTH] = {false};
+
+  writer.begin(address);
+
+  // One series per origin, in the order they were queued
+  for (int i = 0; i < count; i++)
+  {
+    if (written[i])
+      continue;
+
+    int seriesCount = 0;
+    for (int j = i; j < count; j++)
+      if (readings[j].nodeId == readings[i].nodeId)
+      {
+        series[seriesCount++] = readings[j];
+        written[j] = true;
+      }
+
+    if (writer.write(series, seriesCount) < (unsigned int)seriesCount)
+      return false;
+  }
+
+  return true;
+}
+
+void sendBatch()
+{
+  uint8_t batch[BATCH_SIZE];
+  SensorSeriesWriter writer(batch, policy.getConfig().maxPayload);
+
+  // The largest run of the oldest readings that fits
+  int low = 1, high = readingCount;
+
+  while (low < high)
+  {
+    int middle = (low + high + 1) / 2;
+
+    if (writeBatch(writer, middle))
+      low = middle;
+    else
+      high = middle - 1;
+  }
+
+  writeBatch(writer, low);
+
+  if (!policy.shouldSend(writer.size(), low, low < readingCount, millis()))
+    return;
+
+  if (LoRa.sendReliablePacket(batch, writer.size(), address - 1) != 0)
+    return;
+
+  sendingReadings = low;
+  policy.sent(writer.size(), low, readingCount - low, millis());
+  htsimRecord("fill", (double)writer.size() / policy.getConfig().maxPayload);
+}
+
+void setup()
+{
+  address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : SINK_ADDRESS;
+  period = (_simulator_argc > 2 ? atoi(_simulator_argv[2]) : 10) * 1000UL;
+
+  SensorBatchPolicyConfig policyConfig = SensorBatchPolicy::getDefaultConfig();
+  policyConfig.maxPayload = BATCH_SIZE;
+  policyConfig.maxAge = (_simulator_argc > 3 ? atoi(_simulator_argv[3]) : 60) * 1000UL;
+  policy.setConfig(policyConfig);
+
+  HTLORAV3Config config = HTLORAV3::getDefaultConfig();
+  config.csmaOn = true;
+
+  LoRa.setRadio(&radio);
+  LoRa.setConfig(config);
+  LoRa.begin(address);
+
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  LoRa.listenToPacket();
+
+  // Spread the first readings over the period
+  readTimestamp = random(period);
+}
+
+void loop()
+{
+  if (address != SINK_ADDRESS && millis() >= readTimestamp)
+  {
+    SensorData data;
+    data.nodeId = address;
+    data.index = readIndex++;
+    data.temperature = 20 + address + (random(0, 100) - 50) / 100.0;
+    data.timestamp = millis();
+
+    queueReading(data);
+    htsimRecord("taken", 1);
+    readTimestamp += period;
+  }
+
+  if (address != SINK_ADDRESS && sendingReadings == 0 && policy.check(readingCount, millis()))
+    sendBatch();
+
+  // Run again at the next protocol deadline, read or batch due, radio events wake the node earlier
+  uint32_t wait = LoRa.process();
+
+  unsigned long untilRead = millis() < readTimestamp ? readTimestamp - millis() : 0;
+  if (address != SINK_ADDRESS && untilRead < wait)
+    wait = untilRead;
+
+  uint32_t untilDue = policy.getNextDeadline(millis());
+  if (sendingReadings == 0 && untilDue < wait)
+    wait = untilDue;
+
+  if (LoRa.getMetrics().airTime != airTime)
+  {
+    htsimRecord("airtime", LoRa.getMetrics().airTime - airTime);
+    airTime = LoRa.getMetrics().airTime;
+  }
+
+  htsimWakeAfter(wait);
+}
+
+void onReceive(LoraDataPacket packet)
+{
+  unsigned int senderId;
+  SensorData data;
+
+  SensorSeriesReader reader((const uint8_t *)packet.data, packet.size);
+
+  if (reader.begin(senderId))
+    while (reader.next(data))
+    {
+      if (address != SINK_ADDRESS)
+        queueReading(data);
+      else if (data.nodeId < MAX_ORIGINS && data.index >= 0 && data.index < MAX_READINGS && !covered[data.nodeId][data.index])
+      {
+        covered[data.nodeId][data.index] = true;
+        htsimRecord("covered", 1);
+        htsimRecord("latency", millis() - data.timestamp);
+      }
+    }
+
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int, bool success, int retries)
+{
+  htsimRecord("delivered", success ? 1 : 0);
+
+  // Delivered, removed from the queue. Otherwise sent again on the next batch
+  if (success)
+  {
+    memmove(readings, readings + sendingReadings, (readingCount - sendingReadings) * sizeof(SensorData));
+    readingCount -= sendingReadings;
+  }
+  else
+    policy.add(millis());
+
+  sendingReadings = 0;
+}
@@ -0,0 +1,34 @@
+#!/bin/bash
+#
+# batch-policy.sh
+# air time per reading of the batch-policy scenario, for several read periods, sending at once (max age 0) or holding full batches.
+#
+# usage: lib/htlorav3/tools/sim/batch-policy.sh [seconds] [max ages - s]
+# Run from the repository root, builds the scenario and htsim in the current directory.
+# Air time of every frame sent (relays and ACKs included) over the readings covered at the sink, mean fill of the batches
+# sent, mean latency of the readings to the sink and readings covered at the sink against the readings taken.
+
+SECONDS_SIMULATED=${1:-3600}
+MAX_AGES=${2:-"0 60 300"}
+
+CONFIG=lib/htlorav3/tools/sim/batch-policy.conf
+
+lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/batch-policy.cpp lib/sensorcodec/src/*.cpp || exit 1
+
+printf "%8s %8s | %10s %12s %8s | %10s %10s\n" "period" "max age" "batches" "airtime/rd" "fill" "latency" "covered"
+
+for PERIOD in 2 5 10 30 60; do
+  for MAX_AGE in $MAX_AGES; do
+    ./htsim -c $CONFIG -t $SECONDS_SIMULATED ./batch-policy.so $PERIOD $MAX_AGE |
+      awk -v period=$PERIOD -v maxAge=$MAX_AGE '
+        /^airtime:/ { airtime = $3 * $5 }
+        /^fill:/ { batches = $3 + 0; fill = $5 + 0 }
+        /^latency:/ { latency = $5 / 1000 }
+        /^covered:/ { covered = $3 + 0 }
+        /^taken:/ { taken = $3 + 0 }
+        END {
+          printf "%7ss %7ss | %10d %10.1fms %7.1f%% | %9.1fs %9.1f%%\n", period, maxAge, batches, airtime / covered,
+                 fill * 100, latency, covered * 100 / taken
+        }'
+  done
+done
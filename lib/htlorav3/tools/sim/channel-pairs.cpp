@@ -0,0 +1,122 @@
+/**
+ * @file channel-pairs.cpp
+ * @brief htsim scenario: aggregate throughput of disjoint node pairs over a channel plan
+ *
+ * Description:
+ *
+ * Every node is paired with its neighbour address (2-3, 4-5...) and offers reliable packets to it on a Poisson process
+ * of the given mean period, every node in range of each other. With a channel plan each node listens on the channel of
+ * its address, so the links to nodes on other channels don't contend and the pairs transmit at the same time.
+ *
+ * Recorded statistics:
+ * - offered: packets handed to `sendReliablePacket()` (1), or refused because the reliable sends were full (0)
+ * - received: packets received from the partner, duplicates excluded
+ * - delivered: reliable sends acknowledged (1) or failed (0)
+ * - retries: retries of the acknowledged sends
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/channel-pairs.cpp
+ * ./htsim -c lib/htlorav3/tools/sim/channel-pairs.conf -t 3600 ./channel-pairs.so 4 2000 # channels, mean period - ms
+ *
+ * Or the throughput against the number of channels with `lib/htlorav3/tools/sim/channel-pairs.sh`.
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+
+#include <math.h>
+
+// Data size of every packet - bytes
+#define PACKET_SIZE 32
+// First channel of the plan and spacing between channels (US915 uplink channels) - Hz
+#define FIRST_CHANNEL 902.3E6
+#define CHANNEL_SPACING 200E3
+
+HTLORAV3Sim radio;
+
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+unsigned long nextArrival();
+
+unsigned int address = 0;
+unsigned int partner = 0;
+unsigned long period = 2000;
+unsigned long sendTimestamp = 0;
+
+void setup()
+{
+  address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : 2;
+  int channelCount = _simulator_argc > 2 ? atoi(_simulator_argv[2]) : 1;
+  period = _simulator_argc > 3 ? atoi(_simulator_argv[3]) : 2000;
+
+  partner = address ^ 1;
+
+  HTLORAV3Config config = HTLORAV3::getDefaultConfig();
+  config.csmaOn = true;
+  config.channelCount = channelCount;
+
+  for (int i = 0; i < HTLORAV3_MAX_CHANNELS; i++)
+    config.channelPlan[i] = FIRST_CHANNEL + i * CHANNEL_SPACING;
+
+  LoRa.setRadio(&radio);
+  LoRa.setConfig(config);
+  LoRa.begin(address);
+
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  LoRa.listenToPacket();
+
+  sendTimestamp = nextArrival();
+}
+
+void loop()
+{
+  if (millis() >= sendTimestamp)
+  {
+    char data[PACKET_SIZE + 1];
+    snprintf(data, sizeof(data), "%0*lu", PACKET_SIZE, millis());
+
+    htsimRecord("offered", LoRa.sendReliablePacket(data, partner) == 0 ? 1 : 0);
+    sendTimestamp += nextArrival();
+  }
+
+  // Run again at the next protocol deadline or send, radio events wake the node earlier
+  uint32_t wait = LoRa.process();
+
+  unsigned long untilSend = millis() < sendTimestamp ? sendTimestamp - millis() : 0;
+  if (untilSend < wait)
+    wait = untilSend;
+
+  htsimWakeAfter(wait);
+}
+
+unsigned long nextArrival()
+{
+  // Exponential inter-arrival time of the mean period
+  double uniform = (random(1, 1000000)) / 1000000.0;
+
+  return (unsigned long)(-log(uniform) * period);
+}
+
+void onReceive(LoraDataPacket)
+{
+  htsimRecord("received", 1);
+
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int, bool success, int retries)
+{
+  htsimRecord("delivered", success ? 1 : 0);
+
+  if (success)
+    htsimRecord("retries", retries);
+}
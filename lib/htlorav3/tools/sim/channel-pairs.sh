@@ -0,0 +1,30 @@
+#!/bin/bash
+#
+# channel-pairs.sh
+# aggregate delivered throughput of the channel-pairs scenario against the number of channels hopped over.
+#
+# usage: lib/htlorav3/tools/sim/channel-pairs.sh [seconds] [mean period - ms] [channel counts...]
+# Run from the repository root, builds the scenario and htsim in the current directory.
+# Loads are in packets per second offered by all nodes, throughput in packets per second received by all nodes.
+
+SECONDS_SIMULATED=${1:-1800}
+PERIOD=${2:-2000}
+shift 2
+CHANNELS=${@:-1 2 4 8}
+
+CONFIG=lib/htlorav3/tools/sim/channel-pairs.conf
+NODES=$(awk -F: '/^grid:/ { n += $3 } /^node:/ { n++ } END { print n }' $CONFIG)
+OFFERED=$(awk -v n=$NODES -v p=$PERIOD 'BEGIN { printf "%.3f", n * 1000 / p }')
+
+lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/channel-pairs.cpp || exit 1
+
+printf "%10s %10s | %10s %10s %10s\n" "channels" "offered" "throughput" "delivered" "retries"
+
+for CHANNEL_COUNT in $CHANNELS; do
+  ./htsim -c $CONFIG -t $SECONDS_SIMULATED ./channel-pairs.so $CHANNEL_COUNT $PERIOD |
+    awk -v seconds=$SECONDS_SIMULATED -v channels=$CHANNEL_COUNT -v offered=$OFFERED '
+      /^received:/ { received = $3 + 0 }
+      /^delivered:/ { delivered = $5 + 0 }
+      /^retries:/ { retries = $5 + 0 }
+      END { printf "%10s %10s | %10.3f %9.1f%% %10.2f\n", channels, offered, received / seconds, delivered * 100, retries }'
+done
@@ -0,0 +1,114 @@
+/**
+ * @file csma-load.cpp
+ * @brief htsim scenario: offered load against delivered throughput, with and without CSMA/CA
+ *
+ * Description:
+ *
+ * Node 1 is the sink, it listens all the time. Every other node offers reliable packets to the sink on a Poisson process
+ * of the given mean period, every node in range of each other. The access scheme is the random backoff within one exchange
+ * (0) or CSMA/CA with channel activity detection (1).
+ *
+ * Recorded statistics:
+ * - offered: packets handed to `sendReliablePacket()` (1), or refused because the reliable sends were full (0)
+ * - received: packets received at the sink, duplicates excluded
+ * - delivered: reliable sends acknowledged (1) or failed (0)
+ * - retries: retries of the acknowledged sends
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/csma-load.cpp
+ * ./htsim -c lib/htlorav3/tools/sim/csma-load.conf -t 3600 ./csma-load.so 1 10000 # scheme, mean period - ms
+ *
+ * Or the throughput curves of both schemes with `lib/htlorav3/tools/sim/csma-load.sh`.
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+
+#include <math.h>
+
+#define SINK_ADDRESS 1
+// Data size of every packet - bytes
+#define PACKET_SIZE 32
+
+HTLORAV3Sim radio;
+
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+unsigned long nextArrival();
+
+unsigned int address = 0;
+unsigned long period = 10000;
+unsigned long sendTimestamp = 0;
+
+void setup()
+{
+  address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : SINK_ADDRESS;
+  bool csmaOn = _simulator_argc > 2 && atoi(_simulator_argv[2]) != 0;
+  period = _simulator_argc > 3 ? atoi(_simulator_argv[3]) : 10000;
+
+  HTLORAV3Config config = HTLORAV3::getDefaultConfig();
+  config.csmaOn = csmaOn;
+
+  LoRa.setRadio(&radio);
+  LoRa.setConfig(config);
+  LoRa.begin(address);
+
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  LoRa.listenToPacket();
+
+  sendTimestamp = nextArrival();
+}
+
+void loop()
+{
+  if (address != SINK_ADDRESS && millis() >= sendTimestamp)
+  {
+    char data[PACKET_SIZE + 1];
+    snprintf(data, sizeof(data), "%0*lu", PACKET_SIZE, millis());
+
+    htsimRecord("offered", LoRa.sendReliablePacket(data, SINK_ADDRESS) == 0 ? 1 : 0);
+    sendTimestamp += nextArrival();
+  }
+
+  // Run again at the next protocol deadline or send, radio events wake the node earlier
+  uint32_t wait = LoRa.process();
+
+  unsigned long untilSend = millis() < sendTimestamp ? sendTimestamp - millis() : 0;
+  if (address != SINK_ADDRESS && untilSend < wait)
+    wait = untilSend;
+
+  htsimWakeAfter(wait);
+}
+
+unsigned long nextArrival()
+{
+  // Exponential inter-arrival time of the mean period
+  double uniform = (random(1, 1000000)) / 1000000.0;
+
+  return (unsigned long)(-log(uniform) * period);
+}
+
+void onReceive(LoraDataPacket packet)
+{
+  if (address == SINK_ADDRESS)
+    htsimRecord("received", 1);
+
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int, bool success, int retries)
+{
+  htsimRecord("delivered", success ? 1 : 0);
+
+  if (success)
+    htsimRecord("retries", retries);
+}
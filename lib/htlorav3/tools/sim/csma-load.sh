@@ -0,0 +1,33 @@
+#!/bin/bash
+#
+# csma-load.sh
+# delivered throughput against offered load of the csma-load scenario, for the random backoff and CSMA/CA schemes.
+#
+# usage: lib/htlorav3/tools/sim/csma-load.sh [seconds] [mean periods - ms...]
+# Run from the repository root, builds the scenario and htsim in the current directory.
+# Loads are in packets per second offered by all nodes, throughput in packets per second received at the sink.
+
+SECONDS_SIMULATED=${1:-1800}
+shift
+PERIODS=${@:-60000 30000 15000 8000 4000 2000}
+
+CONFIG=lib/htlorav3/tools/sim/csma-load.conf
+SENDERS=$(awk -F: '/^grid:/ { n += $3 } /^node:/ { n++ } END { print n - 1 }' $CONFIG)
+
+lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/csma-load.cpp || exit 1
+
+# Throughput and delivery ratio of one run
+run() {
+  ./htsim -c $CONFIG -t $SECONDS_SIMULATED ./csma-load.so $1 $2 |
+    awk -v seconds=$SECONDS_SIMULATED '
+      /^received:/ { received = $3 + 0 }
+      /^delivered:/ { delivered = $5 + 0 }
+      END { printf "%10.3f %9.1f%%", received / seconds, delivered * 100 }'
+}
+
+printf "%10s %10s | %10s %10s | %10s %10s\n" "period" "offered" "backoff" "delivered" "csma" "delivered"
+
+for PERIOD in $PERIODS; do
+  OFFERED=$(awk -v n=$SENDERS -v p=$PERIOD 'BEGIN { printf "%.3f", n * 1000 / p }')
+  printf "%10s %10s | %s | %s\n" "$PERIOD" "$OFFERED" "$(run 0 $PERIOD)" "$(run 1 $PERIOD)"
+done
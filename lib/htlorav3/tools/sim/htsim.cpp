@@ -0,0 +1,855 @@
+/**
+ * @file htsim.cpp
+ * @brief Virtual-time discrete-event simulator for HTLORAV3 sketches
+ *
+ * Description:
+ *
+ * Runs many nodes of a sketch in one process, replacing the real-time `etherSimulator.pl` ether.
+ * Each node is a copy of the sketch shared object (built with `htsimBuild`), so every node has its own globals,
+ * and `millis()`/`delay()` run on the node virtual clock.
+ *
+ * Scheduling:
+ *
+ * The node with the earliest virtual time runs next, one `loop()` call at a time. A `loop()` call takes at least
+ * the loop period (`-k`) of virtual time, or more if the sketch calls `delay()`. A sketch can replace the loop period
+ * with the time until its next deadline (`htsimWakeAfter(LoRa.process())`), so idle nodes skip ahead instead of
+ * polling. Radio events (a frame received or sent) wake the node earlier. Since nodes only act at their own time, which is never behind the earliest one,
+ * every frame is known before a receiver decides on it.
+ *
+ * Radio model:
+ *
+ * - Time on air from the Semtech formula of the frame modem parameters
+ * - Log-distance path loss between the node positions, RSSI from the transmit power
+ * - A frame is demodulated if its SNR is above the floor of its spreading factor
+ * - The receiver must be listening on the same channel, bandwidth and spreading factor for the whole frame (half-duplex)
+ * - Overlapping frames on the same channel and spreading factor collide, unless one is stronger by the capture threshold
+ * - Optional extra delivery probability per link, as on `etherSimulator.pl` configs
+ * - Channel activity detection is busy if a frame on the same channel and spreading factor, in range, is on the air during it
+ *
+ * Usage:
+ *
+ * htsim [-h] [-c configfile] [-n nodes] [-t seconds] [-k loopms] [-s seed] sketch.so [sketch args...]
+ *
+ * Each node runs with `_simulator_argv` = [sketch, node address, sketch args...].
+ *
+ * Config file (one directive per line, `#` for comments):
+ * - node:address:x:y - node at the position (m)
+ * - grid:first:count:columns:spacing - count nodes from the first address, on a grid with the spacing (m)
+ * - probability:nodea:nodeb:probability - delivery probability of the link (bidirectional) [0.0..1.0]
+ * - pathloss:distance:loss:exponent - log-distance path loss: reference distance (m), loss at it (dB) and exponent
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3sim.h"
+
+#include <dlfcn.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Power difference a frame needs over each overlapping frame to be received anyway - dB
+#define HTSIM_CAPTURE_THRESHOLD 6
+// Receiver noise figure - dB
+#define HTSIM_NOISE_FIGURE 6
+// Time the frames and radio modes are kept after the earliest node, longer than any frame - us
+#define HTSIM_HISTORY 20000000ULL
+
+// Radio modes
+#define HTSIM_MODE_SLEEP 0
+#define HTSIM_MODE_RX 1
+#define HTSIM_MODE_TX 2
+#define HTSIM_MODE_CAD 3
+
+// === Structs ===
+
+typedef struct
+{
+  uint64_t start;
+  uint64_t end;
+  int sender;
+  uint32_t frequency;
+  LoraModemConfig modem;
+  std::vector<uint8_t> frame;
+} HTSimTransmission;
+
+typedef struct
+{
+  uint64_t time;
+  int mode;
+  uint32_t frequency;
+  LoraModemConfig modem;
+} HTSimModeChange;
+
+typedef struct
+{
+  std::vector<uint8_t> frame;
+  int16_t rssi;
+  int8_t snr;
+} HTSimReception;
+
+typedef struct
+{
+  unsigned int address;
+  double x;
+  double y;
+
+  void (*setup)();
+  void (*loop)();
+  std::vector<std::string> args;
+  std::vector<char *> argv;
+
+  // Virtual clock - us
+  uint64_t time;
+  // Scheduled run - us
+  uint64_t nextRun;
+  // Run asked by the sketch with `htsimWakeAfter()`, instead of the loop period [UINT64_MAX: none] - us
+  uint64_t wakeTime;
+  // End of the frame on the air - us
+  uint64_t txEnd;
+  // Channel activity detection in progress - us
+  bool cadActive;
+  uint64_t cadStart;
+  uint64_t cadEnd;
+  uint32_t cadFrequency;
+  LoraModemConfig cadModem;
+
+  std::deque<HTSimModeChange> modes;
+  // Frames heard, decided once their time on air is over (index of `_transmissions` + `_transmissionsBase`)
+  std::deque<uint64_t> pending;
+  std::deque<HTSimReception> received;
+} HTSimNode;
+
+typedef struct
+{
+  uint64_t count;
+  double sum;
+  double min;
+  double max;
+} HTSimRecord;
+
+// === Simulator State ===
+
+static std::vector<HTSimNode> _nodes;
+static int _current = -1;
+static std::set<std::pair<uint64_t, int>> _schedule;
+static std::mt19937_64 _random;
+
+static std::deque<HTSimTransmission> _transmissions;
+static uint64_t _transmissionsBase = 0;
+
+static std::map<std::pair<unsigned int, unsigned int>, double> _probabilities;
+static double _referenceDistance = 40;
+static double _referenceLoss = 127.41;
+static double _pathLossExponent = 2.08;
+
+static std::map<std::string, HTSimRecord> _records;
+
+static uint64_t _framesSent = 0;
+static uint64_t _airTime = 0;
+static uint64_t _delivered = 0;
+static uint64_t _captured = 0;
+static uint64_t _collided = 0;
+static uint64_t _missed = 0;
+static uint64_t _dropped = 0;
+static uint64_t _cads = 0;
+static uint64_t _cadsBusy = 0;
+
+// === Sketch Environment ===
+
+SerialSimulator Serial;
+int _simulator_argc = 0;
+char **_simulator_argv = NULL;
+
+unsigned long millis()
+{
+  return _current >= 0 ? _nodes[_current].time / 1000 : 0;
+}
+
+void delay(unsigned long ms)
+{
+  if (_current >= 0)
+    _nodes[_current].time += (uint64_t)ms * 1000;
+}
+
+long random(long to)
+{
+  return to > 0 ? (long)(_random() % (uint64_t)to) : 0;
+}
+
+long random(long from, long to)
+{
+  return to > from ? from + random(to - from) : from;
+}
+
+// === Radio Model ===
+
+static uint32_t getBandwidth(const LoraModemConfig &modem)
+{
+  static const uint32_t bandwidths[] = {125000, 250000, 500000};
+  return bandwidths[modem.bandwidth >= 0 && modem.bandwidth <= 2 ? modem.bandwidth : 0];
+}
+
+static uint64_t getTimeOnAir(uint8_t size, const LoraModemConfig &modem)
+{
+  // Semtech formula (SX1262 datasheet 6.1.4), CRC on
+  double symbolTime = (double)(1 << modem.spreadingFactor) * 1000000.0 / getBandwidth(modem);
+  int lowDataRate = symbolTime > 16000 ? 1 : 0;
+  int implicitHeader = modem.fixLengthPayloadOn ? 1 : 0;
+
+  int numerator = 8 * size - 4 * modem.spreadingFactor + 28 + 16 - 20 * implicitHeader;
+  int denominator = 4 * (modem.spreadingFactor - 2 * lowDataRate);
+
+  int payloadSymbols = 8;
+  if (numerator > 0)
+    payloadSymbols += ((numerator + denominator - 1) / denominator) * (modem.codingRate + 4);
+
+  return (uint64_t)((modem.preambleLength + 4.25 + payloadSymbols) * symbolTime);
+}
+
+static double getRSSI(const HTSimTransmission &transmission, int receiver)
+{
+  const HTSimNode &a = _nodes[transmission.sender];
+  const HTSimNode &b = _nodes[receiver];
+
+  double distance = sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+  if (distance < _referenceDistance)
+    distance = _referenceDistance;
+
+  return transmission.modem.txOutPower - (_referenceLoss + 10 * _pathLossExponent * log10(distance / _referenceDistance));
+}
+
+static double getNoiseFloor(const LoraModemConfig &modem)
+{
+  return -174 + 10 * log10((double)getBandwidth(modem)) + HTSIM_NOISE_FIGURE;
+}
+
+static double getSNRFloor(int spreadingFactor)
+{
+  return -7.5 - 2.5 * (spreadingFactor - 7);
+}
+
+static bool isSameChannel(uint32_t frequencyA, const LoraModemConfig &modemA, uint32_t frequencyB, const LoraModemConfig &modemB)
+{
+  return frequencyA == frequencyB && modemA.bandwidth == modemB.bandwidth && modemA.spreadingFactor == modemB.spreadingFactor;
+}
+
+static bool isInRange(const HTSimTransmission &transmission, int receiver)
+{
+  return getRSSI(transmission, receiver) - getNoiseFloor(transmission.modem) >= getSNRFloor(transmission.modem.spreadingFactor);
+}
+
+static double getProbability(unsigned int a, unsigned int b)
+{
+  auto probability = _probabilities.find(std::make_pair(a, b));
+  return probability == _probabilities.end() ? 1.0 : probability->second;
+}
+
+static void setMode(HTSimNode &node, int mode, uint32_t frequency, const LoraModemConfig &modem)
+{
+  // A new mode cancels the ones set ahead (eg: the standby at the end of a frame)
+  while (!node.modes.empty() && node.modes.back().time > node.time)
+    node.modes.pop_back();
+
+  HTSimModeChange change;
+  change.time = node.time;
+  change.mode = mode;
+  change.frequency = frequency;
+  change.modem = modem;
+  node.modes.push_back(change);
+}
+
+static bool wasListening(const HTSimNode &node, const HTSimTransmission &transmission)
+{
+  // Listening on the frame channel since before its preamble and all along
+  const HTSimModeChange *atStart = NULL;
+
+  for (const HTSimModeChange &change : node.modes)
+  {
+    if (change.time <= transmission.start)
+      atStart = &change;
+    else if (change.time < transmission.end)
+      return false;
+  }
+
+  return atStart != NULL &&
+         atStart->mode == HTSIM_MODE_RX &&
+         isSameChannel(atStart->frequency, atStart->modem, transmission.frequency, transmission.modem);
+}
+
+static void decide(int receiver, const HTSimTransmission &transmission)
+{
+  HTSimNode &node = _nodes[receiver];
+
+  if (!wasListening(node, transmission))
+  {
+    _missed++;
+    return;
+  }
+
+  double rssi = getRSSI(transmission, receiver);
+  bool overlapped = false;
+
+  for (const HTSimTransmission &other : _transmissions)
+  {
+    if (
+        &other == &transmission ||
+        other.sender == receiver ||
+        other.end <= transmission.start ||
+        other.start >= transmission.end ||
+        !isSameChannel(other.frequency, other.modem, transmission.frequency, transmission.modem))
+      continue;
+
+    overlapped = true;
+
+    if (rssi - getRSSI(other, receiver) < HTSIM_CAPTURE_THRESHOLD)
+    {
+      _collided++;
+      return;
+    }
+  }
+
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  if (uniform(_random) >= getProbability(_nodes[transmission.sender].address, node.address))
+  {
+    _dropped++;
+    return;
+  }
+
+  if (overlapped)
+    _captured++;
+  _delivered++;
+
+  HTSimReception reception;
+  reception.frame = transmission.frame;
+  reception.rssi = (int16_t)lround(rssi);
+  reception.snr = (int8_t)lround(rssi - getNoiseFloor(transmission.modem));
+  node.received.push_back(reception);
+}
+
+static void decidePending(int receiver)
+{
+  HTSimNode &node = _nodes[receiver];
+
+  for (size_t i = 0; i < node.pending.size();)
+  {
+    uint64_t index = node.pending[i];
+
+    if (index < _transmissionsBase)
+    {
+      node.pending.erase(node.pending.begin() + i); // Pruned, far in the past
+      continue;
+    }
+
+    const HTSimTransmission &transmission = _transmissions[index - _transmissionsBase];
+
+    if (transmission.end > node.time)
+    {
+      i++;
+      continue;
+    }
+
+    decide(receiver, transmission);
+    node.pending.erase(node.pending.begin() + i);
+  }
+}
+
+// === Scheduling ===
+
+static void schedule(int index, uint64_t time)
+{
+  HTSimNode &node = _nodes[index];
+
+  if (time < node.time)
+    time = node.time;
+
+  if (index == _current)
+  {
+    // Running: woken right after the current `loop()` call if earlier
+    if (time < node.nextRun)
+      node.nextRun = time;
+    return;
+  }
+
+  if (time >= node.nextRun)
+    return;
+
+  _schedule.erase(std::make_pair(node.nextRun, index));
+  node.nextRun = time;
+  _schedule.insert(std::make_pair(node.nextRun, index));
+}
+
+static void prune()
+{
+  if (_schedule.empty())
+    return;
+
+  uint64_t earliest = _schedule.begin()->first;
+  if (earliest < HTSIM_HISTORY)
+    return;
+
+  uint64_t limit = earliest - HTSIM_HISTORY;
+
+  while (!_transmissions.empty() && _transmissions.front().end < limit)
+  {
+    _transmissions.pop_front();
+    _transmissionsBase++;
+  }
+
+  for (HTSimNode &node : _nodes)
+    while (node.modes.size() > 1 && node.modes[1].time < limit)
+      node.modes.pop_front();
+}
+
+// === Simulator API ===
+
+void htsimSend(const uint8_t *frame, uint8_t size, uint32_t frequency, const LoraModemConfig &modem)
+{
+  if (_current < 0)
+    return;
+
+  HTSimNode &node = _nodes[_current];
+  decidePending(_current);
+  node.received.clear();
+  node.cadActive = false;
+
+  HTSimTransmission transmission;
+  transmission.start = node.time;
+  transmission.end = node.time + getTimeOnAir(size, modem);
+  transmission.sender = _current;
+  transmission.frequency = frequency;
+  transmission.modem = modem;
+  transmission.frame.assign(frame, frame + size);
+
+  setMode(node, HTSIM_MODE_TX, frequency, modem);
+  node.modes.push_back(node.modes.back());
+  node.modes.back().time = transmission.end;
+  node.modes.back().mode = HTSIM_MODE_SLEEP;
+
+  node.txEnd = transmission.end;
+  _framesSent++;
+  _airTime += transmission.end - transmission.start;
+
+  _transmissions.push_back(transmission);
+  uint64_t index = _transmissionsBase + _transmissions.size() - 1;
+
+  for (size_t i = 0; i < _nodes.size(); i++)
+  {
+    if ((int)i == _current || !isInRange(transmission, i))
+      continue;
+
+    _nodes[i].pending.push_back(index);
+
+    if (!_nodes[i].modes.empty() && _nodes[i].modes.back().mode == HTSIM_MODE_RX)
+      schedule(i, transmission.end);
+  }
+
+  schedule(_current, transmission.end);
+}
+
+void htsimStartCad(uint32_t frequency, const LoraModemConfig &modem)
+{
+  if (_current < 0)
+    return;
+
+  HTSimNode &node = _nodes[_current];
+  decidePending(_current);
+  node.received.clear();
+
+  double symbolTime = (double)(1 << modem.spreadingFactor) * 1000000.0 / getBandwidth(modem);
+
+  node.cadActive = true;
+  node.cadStart = node.time;
+  node.cadEnd = node.time + (uint64_t)(HTLORAV3_CAD_SYMBOLS * symbolTime);
+  node.cadFrequency = frequency;
+  node.cadModem = modem;
+
+  // Not receiving during the detection, idle after it
+  setMode(node, HTSIM_MODE_CAD, frequency, modem);
+  node.modes.push_back(node.modes.back());
+  node.modes.back().time = node.cadEnd;
+  node.modes.back().mode = HTSIM_MODE_SLEEP;
+
+  schedule(_current, node.cadEnd);
+}
+
+bool htsimIsCadDone(bool *detected)
+{
+  if (_current < 0)
+    return false;
+
+  HTSimNode &node = _nodes[_current];
+
+  if (!node.cadActive || node.time < node.cadEnd)
+    return false;
+
+  // Every frame starting before the end is known, the other nodes are past it
+  *detected = false;
+  for (const HTSimTransmission &transmission : _transmissions)
+  {
+    if (
+        transmission.sender != _current &&
+        transmission.start < node.cadEnd &&
+        transmission.end > node.cadStart &&
+        isSameChannel(transmission.frequency, transmission.modem, node.cadFrequency, node.cadModem) &&
+        isInRange(transmission, _current))
+    {
+      *detected = true;
+      break;
+    }
+  }
+
+  node.cadActive = false;
+  _cads++;
+  if (*detected)
+    _cadsBusy++;
+
+  return true;
+}
+
+bool htsimIsSending()
+{
+  return _current >= 0 && _nodes[_current].time < _nodes[_current].txEnd;
+}
+
+void htsimListen(uint32_t frequency, const LoraModemConfig &modem)
+{
+  if (_current < 0)
+    return;
+
+  decidePending(_current);
+  _nodes[_current].cadActive = false;
+  setMode(_nodes[_current], HTSIM_MODE_RX, frequency, modem);
+}
+
+void htsimSleep()
+{
+  if (_current < 0)
+    return;
+
+  HTSimNode &node = _nodes[_current];
+  decidePending(_current);
+  node.received.clear();
+  node.cadActive = false;
+
+  if (node.modes.empty() || node.modes.back().mode != HTSIM_MODE_SLEEP)
+    setMode(node, HTSIM_MODE_SLEEP, 0, node.modes.empty() ? LoraModemConfig() : node.modes.back().modem);
+}
+
+bool htsimReceive(uint8_t *frame, uint8_t *size, int16_t *rssi, int8_t *snr)
+{
+  if (_current < 0)
+    return false;
+
+  HTSimNode &node = _nodes[_current];
+  decidePending(_current);
+
+  if (node.received.empty())
+    return false;
+
+  HTSimReception &reception = node.received.front();
+  memcpy(frame, reception.frame.data(), reception.frame.size());
+  *size = reception.frame.size();
+  *rssi = reception.rssi;
+  *snr = reception.snr;
+  node.received.pop_front();
+
+  return true;
+}
+
+void htsimWakeAfter(uint32_t ms)
+{
+  if (_current < 0)
+    return;
+
+  HTSimNode &node = _nodes[_current];
+  node.wakeTime = ms == UINT32_MAX ? UINT64_MAX - 1 : node.time + (uint64_t)ms * 1000;
+}
+
+void htsimRecord(const char *name, double value)
+{
+  HTSimRecord &record = _records[name];
+
+  if (record.count == 0 || value < record.min)
+    record.min = value;
+  if (record.count == 0 || value > record.max)
+    record.max = value;
+
+  record.count++;
+  record.sum += value;
+}
+
+// === Setup ===
+
+static void addNode(unsigned int address, double x, double y)
+{
+  for (HTSimNode &node : _nodes)
+    if (node.address == address)
+    {
+      node.x = x;
+      node.y = y;
+      return;
+    }
+
+  HTSimNode node = HTSimNode();
+  node.address = address;
+  node.x = x;
+  node.y = y;
+  _nodes.push_back(node);
+}
+
+static void readConfig(const char *path)
+{
+  std::ifstream config(path);
+  if (!config)
+  {
+    fprintf(stderr, "htsim: could not open config %s\n", path);
+    exit(1);
+  }
+
+  std::string line;
+  while (std::getline(config, line))
+  {
+    std::vector<std::string> fields;
+    std::stringstream stream(line.substr(0, line.find('#')));
+    std::string field;
+
+    while (std::getline(stream, field, ':'))
+      fields.push_back(field);
+
+    if (fields.size() == 4 && fields[0] == "node")
+      addNode(atoi(fields[1].c_str()), atof(fields[2].c_str()), atof(fields[3].c_str()));
+    else if (fields.size() == 5 && fields[0] == "grid")
+    {
+      int first = atoi(fields[1].c_str());
+      int count = atoi(fields[2].c_str());
+      int columns = atoi(fields[3].c_str());
+      double spacing = atof(fields[4].c_str());
+
+      for (int i = 0; i < count && columns > 0; i++)
+        addNode(first + i, (i % columns) * spacing, (i / columns) * spacing);
+    }
+    else if (fields.size() == 4 && fields[0] == "probability")
+    {
+      unsigned int a = atoi(fields[1].c_str());
+      unsigned int b = atoi(fields[2].c_str());
+      _probabilities[std::make_pair(a, b)] = atof(fields[3].c_str());
+      _probabilities[std::make_pair(b, a)] = atof(fields[3].c_str());
+    }
+    else if (fields.size() == 4 && fields[0] == "pathloss")
+    {
+      _referenceDistance = atof(fields[1].c_str());
+      _referenceLoss = atof(fields[2].c_str());
+      _pathLossExponent = atof(fields[3].c_str());
+    }
+  }
+}
+
+static void loadSketch(HTSimNode &node, const std::vector<uint8_t> &image, const char *path)
+{
+  // A distinct file per node, so the dynamic loader gives each one its own copy of the globals
+  int fd = memfd_create("htsim-node", 0);
+  if (fd < 0 || write(fd, image.data(), image.size()) != (ssize_t)image.size())
+  {
+    fprintf(stderr, "htsim: could not copy %s\n", path);
+    exit(1);
+  }
+
+  char fdPath[64];
+  snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d", fd);
+
+  void *handle = dlopen(fdPath, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL)
+  {
+    fprintf(stderr, "htsim: could not load %s: %s\n", path, dlerror());
+    exit(1);
+  }
+
+  node.setup = (void (*)())dlsym(handle, "_Z5setupv");
+  node.loop = (void (*)())dlsym(handle, "_Z4loopv");
+
+  if (node.setup == NULL || node.loop == NULL)
+  {
+    fprintf(stderr, "htsim: %s has no setup() and loop()\n", path);
+    exit(1);
+  }
+}
+
+static void usage()
+{
+  printf("usage: htsim [-h] [-c configfile] [-n nodes] [-t seconds] [-k loopms] [-s seed] sketch.so [sketch args...]\n");
+  exit(1);
+}
+
+// === Main ===
+
+int main(int argc, char **argv)
+{
+  const char *config = NULL;
+  int nodeCount = 0;
+  double seconds = 3600;
+  double loopPeriod = 1;
+  unsigned long seed = 1;
+
+  int option;
+  while ((option = getopt(argc, argv, "+hc:n:t:k:s:")) != -1)
+  {
+    switch (option)
+    {
+    case 'c':
+      config = optarg;
+      break;
+    case 'n':
+      nodeCount = atoi(optarg);
+      break;
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'k':
+      loopPeriod = atof(optarg);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (optind >= argc)
+    usage();
+
+  const char *sketch = argv[optind];
+
+  _random.seed(seed);
+
+  if (config != NULL)
+    readConfig(config);
+
+  // Nodes not placed by the config share the same spot
+  for (int address = 1; address <= nodeCount; address++)
+  {
+    bool placed = false;
+    for (HTSimNode &node : _nodes)
+      placed = placed || node.address == (unsigned int)address;
+
+    if (!placed)
+      addNode(address, 0, 0);
+  }
+
+  if (_nodes.empty())
+    usage();
+
+  std::ifstream file(sketch, std::ios::binary);
+  std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (image.empty())
+  {
+    fprintf(stderr, "htsim: could not read %s\n", sketch);
+    return 1;
+  }
+
+  uint64_t duration = (uint64_t)(seconds * 1000000);
+  uint64_t loopTime = (uint64_t)(loopPeriod * 1000);
+  if (loopTime == 0)
+    loopTime = 1;
+
+  struct timespec wallStart;
+  clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+  for (size_t i = 0; i < _nodes.size(); i++)
+  {
+    HTSimNode &node = _nodes[i];
+    loadSketch(node, image, sketch);
+
+    node.args.push_back(sketch);
+    node.args.push_back(std::to_string(node.address));
+    for (int arg = optind + 1; arg < argc; arg++)
+      node.args.push_back(argv[arg]);
+
+    for (std::string &arg : node.args)
+      node.argv.push_back(&arg[0]);
+    node.argv.push_back(NULL);
+  }
+
+  for (size_t i = 0; i < _nodes.size(); i++)
+  {
+    _current = i;
+    _simulator_argc = _nodes[i].args.size();
+    _simulator_argv = _nodes[i].argv.data();
+    _nodes[i].nextRun = UINT64_MAX;
+    _nodes[i].wakeTime = UINT64_MAX;
+
+    _nodes[i].setup();
+
+    _nodes[i].nextRun = _nodes[i].time;
+    _schedule.insert(std::make_pair(_nodes[i].nextRun, (int)i));
+  }
+
+  uint64_t steps = 0;
+
+  while (!_schedule.empty() && _schedule.begin()->first < duration)
+  {
+    int index = _schedule.begin()->second;
+    HTSimNode &node = _nodes[index];
+    _schedule.erase(_schedule.begin());
+
+    _current = index;
+    _simulator_argc = node.args.size();
+    _simulator_argv = node.argv.data();
+
+    node.time = node.nextRun > node.time ? node.nextRun : node.time;
+    uint64_t start = node.time;
+    node.nextRun = UINT64_MAX;
+    node.wakeTime = UINT64_MAX;
+
+    node.loop();
+
+    uint64_t next = start + loopTime > node.time ? start + loopTime : node.time;
+    if (node.wakeTime != UINT64_MAX)
+      next = node.wakeTime > start + 1000 ? node.wakeTime : start + 1000; // At least 1 ms, the `millis()` resolution
+    if (node.nextRun < next)
+      next = node.nextRun < node.time ? node.time : node.nextRun;
+
+    node.nextRun = next;
+    _schedule.insert(std::make_pair(node.nextRun, index));
+
+    if ((++steps & 0xFFFF) == 0)
+      prune();
+  }
+
+  _current = -1;
+
+  struct timespec wallEnd;
+  clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+  double wallTime = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+
+  printf("htsim: %zu nodes, %.0f s simulated in %.1f s (%llu loop calls)\n", _nodes.size(), seconds, wallTime, (unsigned long long)steps);
+  printf("frames: %llu sent, %.1f s on air\n", (unsigned long long)_framesSent, _airTime / 1e6);
+  printf("cad: %llu detections, %llu busy\n", (unsigned long long)_cads, (unsigned long long)_cadsBusy);
+  printf("receptions: %llu delivered (%llu captured), %llu collided, %llu missed (not listening), %llu dropped (link probability)\n",
+         (unsigned long long)_delivered, (unsigned long long)_captured, (unsigned long long)_collided, (unsigned long long)_missed, (unsigned long long)_dropped);
+
+  for (auto &record : _records)
+    printf("%s: count %llu, mean %.3f, min %.3f, max %.3f\n",
+           record.first.c_str(), (unsigned long long)record.second.count, record.second.sum / record.second.count, record.second.min, record.second.max);
+
+  fflush(stdout);
+
+  // The sketches are not unloaded, their destructors would run without a node
+  _exit(0);
+}
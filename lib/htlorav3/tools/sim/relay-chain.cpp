@@ -0,0 +1,299 @@
+/**
+ * @file relay-chain.cpp
+ * @brief htsim scenario: sensor readings relayed along a chain to the sink, with and without in-network aggregation
+ *
+ * Description:
+ *
+ * Node 1 is the sink, every other node reads a sensor every period and sends its readings to the previous address,
+ * which forwards them with its own, like `src/main.cpp`: a reliable batch at a time, one series per origin (`sensorseries.h`).
+ * Each node reaches its neighbours and the nodes two hops away (CSMA/CA on), so the node next to the sink carries the readings of the whole chain.
+ *
+ * The relays pass the readings they receive through a `SensorAggregator` of the given mode:
+ * off (0), summaries per window (1, sent as `sensorsummary.h` batches) or decimation (2, one reading per window).
+ *
+ * Recorded statistics:
+ * - taken: readings taken by the sensors
+ * - sink-frames: frames received at the sink, duplicates excluded
+ * - sink-bytes: payload size of the frames received at the sink - bytes
+ * - sink-readings: readings stood for by each frame received at the sink (summaries count their readings, duplicates included)
+ * - covered: readings the sink got, or got in a summary, counted once
+ * - sink-airtime: air time of the frames sent by the sink and by the node next to it - ms
+ * - delivered: reliable sends acknowledged (1) or failed (0)
+ * - dropped: readings or summaries dropped on a full relay queue
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/relay-chain.cpp lib/sensorcodec/src/*.cpp
+ * ./htsim -c lib/htlorav3/tools/sim/relay-chain.conf -t 3600 ./relay-chain.so 1 10 300 # mode, read period - s, window - s
+ *
+ * Or the sink channel load of every mode with `lib/htlorav3/tools/sim/relay-chain.sh`.
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ * - sensorcodec (sensorseries.h, sensorsummary.h, sensoraggregator.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+#include "sensoraggregator.h"
+#include "sensorseries.h"
+#include "sensorsummary.h"
+
+#include <string.h>
+
+#define SINK_ADDRESS 1
+// Readings and summaries waiting to be sent on each relay
+#define QUEUE_LENGTH 128
+// One frame with any header - bytes
+#define BATCH_SIZE (HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE)
+// Origins and readings per origin tracked by the sink
+#define MAX_ORIGINS 32
+#define MAX_READINGS 8640
+
+HTLORAV3Sim radio;
+SensorAggregator aggregator;
+
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+
+unsigned int address = 0;
+unsigned long period = 10000;
+unsigned long readTimestamp = 0;
+int readIndex = 0;
+uint32_t airTime = 0;
+
+SensorData readings[QUEUE_LENGTH];
+int readingCount = 0;
+SensorSummary summaries[QUEUE_LENGTH];
+int summaryCount = 0;
+
+// Batch waiting for its ACK, removed from its queue once delivered
+int sendingReadings = 0;
+int sendingSummaries = 0;
+
+// Readings covered at the sink, by origin and index
+bool covered[MAX_ORIGINS][MAX_READINGS];
+
+void cover(int nodeId, int firstIndex, int lastIndex)
+{
+  for (int index = firstIndex; index <= lastIndex; index++)
+    if (nodeId < MAX_ORIGINS && index >= 0 && index < MAX_READINGS && !covered[nodeId][index])
+    {
+      covered[nodeId][index] = true;
+      htsimRecord("covered", 1);
+    }
+}
+
+void queueReading(const SensorData &data)
+{
+  if (readingCount == QUEUE_LENGTH)
+    htsimRecord("dropped", 1);
+  else
+    readings[readingCount++] = data;
+}
+
+void queueSummary(const SensorSummary &summary)
+{
+  if (summaryCount == QUEUE_LENGTH)
+    htsimRecord("dropped", summary.count);
+  else
+    summaries[summaryCount++] = summary;
+}
+
+bool writeBatch(SensorSeriesWriter &writer, int count)
+{
+  SensorData series[QUEUE_LENGTH];
+  bool written[QUEUE_LENGTH] = {false};
+
+  writer.begin(address);
+
+  // One series per origin, in the order they were queued
+  for (int i = 0; i < count; i++)
+  {
+    if (written[i])
+      continue;
+
+    int seriesCount = 0;
+    for (int j = i; j < count; j++)
+      if (readings[j].nodeId == readings[i].nodeId)
+      {
+        series[seriesCount++] = readings[j];
+        written[j] = true;
+      }
+
+    if (writer.write(series, seriesCount) < (unsigned int)seriesCount)
+      return false;
+  }
+
+  return true;
+}
+
+void sendBatch()
+{
+  uint8_t batch[BATCH_SIZE];
+  size_t size;
+
+  if (summaryCount > 0)
+  {
+    SensorSummaryWriter writer(batch, sizeof(batch));
+    writer.begin(address);
+
+    while (sendingSummaries < summaryCount && writer.write(summaries[sendingSummaries]))
+      sendingSummaries++;
+
+    size = writer.size();
+  }
+  else
+  {
+    // The largest run of the oldest readings that fits
+    SensorSeriesWriter writer(batch, sizeof(batch));
+    int low = 1, high = readingCount;
+
+    while (low < high)
+    {
+      int middle = (low + high + 1) / 2;
+
+      if (writeBatch(writer, middle))
+        low = middle;
+      else
+        high = middle - 1;
+    }
+
+    writeBatch(writer, low);
+    sendingReadings = low;
+    size = writer.size();
+  }
+
+  if (LoRa.sendReliablePacket(batch, size, address - 1) != 0)
+    sendingReadings = sendingSummaries = 0;
+}
+
+void setup()
+{
+  address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : SINK_ADDRESS;
+
+  SensorAggregatorConfig aggregatorConfig = SensorAggregator::getDefaultConfig();
+  aggregatorConfig.mode = _simulator_argc > 2 ? atoi(_simulator_argv[2]) : SENSORAGGREGATOR_MODE_OFF;
+  period = (_simulator_argc > 3 ? atoi(_simulator_argv[3]) : 10) * 1000UL;
+  aggregatorConfig.window = (_simulator_argc > 4 ? atoi(_simulator_argv[4]) : 300) * 1000UL;
+  aggregator.setConfig(aggregatorConfig);
+
+  HTLORAV3Config config = HTLORAV3::getDefaultConfig();
+  config.csmaOn = true;
+
+  LoRa.setRadio(&radio);
+  LoRa.setConfig(config);
+  LoRa.begin(address);
+
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  LoRa.listenToPacket();
+
+  // Spread the first readings over the period
+  readTimestamp = random(period);
+}
+
+void loop()
+{
+  if (address != SINK_ADDRESS && millis() >= readTimestamp)
+  {
+    SensorData data;
+    data.nodeId = address;
+    data.index = readIndex++;
+    data.temperature = 20 + address + (random(0, 100) - 50) / 100.0;
+    data.timestamp = millis();
+
+    queueReading(data);
+    htsimRecord("taken", 1);
+    readTimestamp += period;
+  }
+
+  SensorSummary summary;
+  while (aggregator.poll(summary, millis()))
+    queueSummary(summary);
+
+  if (address != SINK_ADDRESS && sendingReadings + sendingSummaries == 0 && readingCount + summaryCount > 0)
+    sendBatch();
+
+  // Run again at the next protocol deadline, read or window close, radio events wake the node earlier
+  uint32_t wait = LoRa.process();
+
+  unsigned long untilRead = millis() < readTimestamp ? readTimestamp - millis() : 0;
+  if (address != SINK_ADDRESS && untilRead < wait)
+    wait = untilRead;
+
+  uint32_t untilClose = aggregator.getNextDeadline(millis());
+  if (untilClose < wait)
+    wait = untilClose;
+
+  // Channel load around the sink: the frames it sends (ACKs) and the ones of the node next to it
+  if (address <= SINK_ADDRESS + 1 && LoRa.getMetrics().airTime != airTime)
+  {
+    htsimRecord("sink-airtime", LoRa.getMetrics().airTime - airTime);
+    airTime = LoRa.getMetrics().airTime;
+  }
+
+  htsimWakeAfter(wait);
+}
+
+void onReceive(LoraDataPacket packet)
+{
+  unsigned int senderId;
+  SensorData data;
+  SensorSummary summary;
+  int count = 0;
+
+  SensorSeriesReader seriesReader((const uint8_t *)packet.data, packet.size);
+  SensorSummaryReader summaryReader((const uint8_t *)packet.data, packet.size);
+
+  if (seriesReader.begin(senderId))
+    while (seriesReader.next(data))
+    {
+      count++;
+
+      if (address == SINK_ADDRESS)
+        cover(data.nodeId, data.index, data.index);
+      else if (!aggregator.add(data, millis()))
+        queueReading(data);
+    }
+  else if (summaryReader.begin(senderId))
+    while (summaryReader.next(summary))
+    {
+      count += summary.count;
+
+      // Already aggregated, forwarded as is
+      if (address == SINK_ADDRESS)
+        cover(summary.nodeId, summary.firstIndex, summary.lastIndex);
+      else
+        queueSummary(summary);
+    }
+
+  if (address == SINK_ADDRESS)
+  {
+    htsimRecord("sink-frames", 1);
+    htsimRecord("sink-bytes", packet.size);
+    htsimRecord("sink-readings", count);
+  }
+
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int, bool success, int retries)
+{
+  htsimRecord("delivered", success ? 1 : 0);
+
+  // Delivered, removed from the queues. Otherwise sent again on the next batch
+  if (success)
+  {
+    memmove(readings, readings + sendingReadings, (readingCount - sendingReadings) * sizeof(SensorData));
+    readingCount -= sendingReadings;
+    memmove(summaries, summaries + sendingSummaries, (summaryCount - sendingSummaries) * sizeof(SensorSummary));
+    summaryCount -= sendingSummaries;
+  }
+
+  sendingReadings = sendingSummaries = 0;
+}
@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# relay-chain.sh
+# channel load at the sink of the relay-chain scenario, without aggregation, with summaries and with decimation.
+#
+# usage: lib/htlorav3/tools/sim/relay-chain.sh [seconds] [read period - s] [window - s]
+# Run from the repository root, builds the scenario and htsim in the current directory.
+# Frames and bytes received by the sink per hour, air time around the sink (its ACKs and the frames of the node next to it)
+# as a share of the channel time, and readings covered at the sink against the readings taken.
+
+SECONDS_SIMULATED=${1:-3600}
+PERIOD=${2:-10}
+WINDOW=${3:-300}
+
+CONFIG=lib/htlorav3/tools/sim/relay-chain.conf
+
+lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/relay-chain.cpp lib/sensorcodec/src/*.cpp || exit 1
+
+printf "%-10s | %12s %12s %10s %10s | %10s %10s\n" "mode" "frames/h" "bytes/h" "airtime/h" "channel" "covered" "delivered"
+
+for MODE in 0 1 2; do
+  NAME=$(echo "off summary decimate" | cut -d' ' -f$((MODE + 1)))
+  ./htsim -c $CONFIG -t $SECONDS_SIMULATED ./relay-chain.so $MODE $PERIOD $WINDOW |
+    awk -v seconds=$SECONDS_SIMULATED -v name=$NAME '
+      /^sink-frames:/ { frames = $3 + 0 }
+      /^sink-bytes:/ { bytes = $3 * $5 }
+      /^sink-airtime:/ { airtime = $3 * $5 / 1000 }
+      /^covered:/ { covered = $3 + 0 }
+      /^taken:/ { taken = $3 + 0 }
+      /^delivered:/ { delivered = $5 + 0 }
+      END {
+        hours = seconds / 3600
+        printf "%-10s | %12.0f %12.0f %9.1fs %9.2f%% | %9.1f%% %9.1f%%\n", name, frames / hours, bytes / hours, airtime / hours,
+               airtime * 100 / seconds, covered * 100 / taken, delivered * 100
+      }'
+done
@@ -0,0 +1,93 @@
+/**
+ * @file sensor-grid.cpp
+ * @brief htsim scenario: sensors on a grid reporting to one sink
+ *
+ * Description:
+ *
+ * Node 1 is the sink, it listens all the time. Every other node sends a reliable reading to the sink every period,
+ * starting at a random time. The reading carries its send time, so the sink records the latency on the shared virtual clock.
+ *
+ * Recorded statistics:
+ * - latency: from the send call to the reception at the sink - ms
+ * - delivered: reliable sends acknowledged (1) or failed (0)
+ * - retries: retries of the acknowledged sends
+ *
+ * Usage:
+ *
+ * lib/htlorav3/tools/htsimBuild lib/htlorav3/tools/sim/sensor-grid.cpp
+ * ./htsim -c lib/htlorav3/tools/sim/sensor-grid.conf -t 86400 ./sensor-grid.so 300 # period - s
+ *
+ * Depends On:
+ * - htlorav3 (htlorav3sim.h)
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htlorav3.h"
+#include "htlorav3sim.h"
+
+#define SINK_ADDRESS 1
+
+HTLORAV3Sim radio;
+
+void onReceive(LoraDataPacket packet);
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries);
+
+unsigned int address = 0;
+unsigned long period = 300000;
+unsigned long sendTimestamp = 0;
+
+void setup()
+{
+  address = _simulator_argc > 1 ? atoi(_simulator_argv[1]) : SINK_ADDRESS;
+  period = (_simulator_argc > 2 ? atoi(_simulator_argv[2]) : 300) * 1000UL;
+
+  LoRa.setRadio(&radio);
+  LoRa.begin(address);
+
+  LoRa.setOnReceive(onReceive);
+  LoRa.setOnReliableSendDone(onReliableSendDone);
+
+  LoRa.listenToPacket();
+
+  // Spread the first readings over the period
+  sendTimestamp = random(period);
+}
+
+void loop()
+{
+  if (address != SINK_ADDRESS && millis() >= sendTimestamp)
+  {
+    char reading[16];
+    snprintf(reading, sizeof(reading), "%lu", millis());
+
+    LoRa.sendReliablePacket(reading, SINK_ADDRESS);
+    sendTimestamp += period;
+  }
+
+  // Run again at the next protocol deadline or send, radio events wake the node earlier
+  uint32_t wait = LoRa.process();
+
+  unsigned long untilSend = millis() < sendTimestamp ? sendTimestamp - millis() : 0;
+  if (address != SINK_ADDRESS && untilSend < wait)
+    wait = untilSend;
+
+  htsimWakeAfter(wait);
+}
+
+void onReceive(LoraDataPacket packet)
+{
+  if (address == SINK_ADDRESS)
+    htsimRecord("latency", millis() - strtoul(packet.data, NULL, 10));
+
+  LoRa.listenToPacket();
+}
+
+void onReliableSendDone(unsigned int, bool success, int retries)
+{
+  htsimRecord("delivered", success ? 1 : 0);
+
+  if (success)
+    htsimRecord("retries", retries);
+}
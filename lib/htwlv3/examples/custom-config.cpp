@@ -61,8 +61,18 @@ void config()
   // loraConfig.fixLengthPayloadOn = false;
   // loraConfig.iqInversionOn = false;
   loraConfig.txOutPower = 12;
-  // loraConfig.txTimeout = 3000;
+  // loraConfig.txTimeout = 0;
   // loraConfig.rxTimeout = 0;
+  // loraConfig.binaryHeaderOn = true;
+  // loraConfig.ackTimeout = 0;
+  // loraConfig.maxRetries = 5;
+  // loraConfig.dutyCycle = 0;
+  // loraConfig.adrOn = false;
+  // loraConfig.arqWindow = 1;
+  // loraConfig.ackHoldTime = 0;
+  // loraConfig.csmaOn = false;
+  // loraConfig.channelCount = 0;
+  // loraConfig.channelPlan[0] = 902.3E6;
 
   Board.lora->setConfig(loraConfig);
 
@@ -80,13 +80,22 @@ void HTWLV3::updateConfig(const HTWLV3Config &config)
 
 // === Handlers ===
 
-void HTWLV3::process()
+uint32_t HTWLV3::process()
 {
+  uint32_t wait = UINT32_MAX;
+
   if (lora)
-    lora->process();
+    wait = lora->process();
 
   if (wifi)
+  {
     wifi->process();
+
+    if (wifi->getConfig().serverEnable && wait > HTWLV3_WIFI_POLL_INTERVAL)
+      wait = HTWLV3_WIFI_POLL_INTERVAL;
+  }
+
+  return wait;
 }
 
 // === Print Template implementations ===
@@ -35,6 +35,11 @@
 // WiFi Lib
 #include "htwifiv3.h"
 
+// === Constants ===
+
+// Max time `process()` asks the host to wait while the WiFi server is on, its clients are polled - ms
+#define HTWLV3_WIFI_POLL_INTERVAL 10
+
 // === Structs ===
 
 typedef struct
@@ -125,8 +130,12 @@ public:
    * @brief Process all the enabled devices
    *
    * @warning This function should be called on `loop()`
+   *
+   * @note Event-driven hosts block between calls for the time returned, woken earlier by the LoRa `setOnInterrupt()`
+   *
+   * @return uint32_t Time until the devices need to be processed again - ms - [UINT32_MAX: only on a LoRa interrupt]
    */
-  void process();
+  uint32_t process();
 
   /**
    * @brief Print on all enabled outputs (display, Serial)
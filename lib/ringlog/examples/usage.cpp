@@ -0,0 +1,99 @@
+/**
+ * @file usage.cpp
+ * @brief Example to use the ringlog library as a store-and-forward queue of sensor readings
+ *
+ * Description:
+ *
+ * This example appends a reading to a ring log on the flash every second and sends the oldest ones in a batch
+ * with `sendReliablePacket()`. They are removed from the log only when the batch is acknowledged,
+ * so the readings taken while the destination is unreachable (or before a reset) are sent when it comes back.
+ *
+ * Depends On:
+ * - ringlog
+ * - sensorcodec
+ * - htwlv3
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htwlv3.h"
+#include "ringlog.h"
+#include "ringlogflash.h"
+#include "sensorcodec.h"
+
+#ifndef NODE_ID
+#define NODE_ID 2
+#endif
+
+#define DESTINATION_ID 1
+#define BATCH_READINGS 16
+
+// 16 flash sectors of the `spiffs` partition, ~3600 readings
+RingLogFlash storage(RINGLOGFLASH_PARTITION, 16);
+RingLog readings(&storage, sizeof(SensorData));
+
+int packetIndex = 0;
+unsigned int sending = 0; // Readings waiting for the ACK
+
+void onReliableSendDone(unsigned int destinationAddress, bool success, int retries)
+{
+  // Delivered, the readings can be removed. Otherwise they are sent again on the next batch
+  if (success)
+    readings.pop(sending);
+
+  Board.println(String(success ? "Sent " : "Not sent ") + String(sending) + " readings, " + String(readings.count()) + " on the log");
+  sending = 0;
+}
+
+void setup()
+{
+  HTWLV3Config boardConfig = HTWLV3::getDefaultConfig();
+  boardConfig.serialEnable = true;
+  boardConfig.displayEnable = true;
+  boardConfig.loraEnable = true;
+  Board.setConfig(boardConfig);
+
+  Board.lora->setOnReliableSendDone(onReliableSendDone);
+
+  Board.begin(NODE_ID);
+
+  if (!readings.begin())
+    Board.println("No flash partition for the log");
+
+  Board.println(String(readings.count()) + " readings recovered");
+}
+
+void loop()
+{
+  SensorData data;
+  data.nodeId = NODE_ID;
+  data.index = packetIndex++;
+  data.temperature = random(200, 300) / 10.0;
+  data.timestamp = millis();
+
+  if (!readings.append(&data))
+    Board.println("Log full, reading lost");
+
+  // One batch at a time, the oldest readings first
+  if (sending == 0 && readings.count() > 0)
+  {
+    SensorData batch[BATCH_READINGS];
+    unsigned int count = readings.peek(batch, BATCH_READINGS);
+
+    uint8_t frame[HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE];
+    SensorRecordWriter writer(frame, sizeof(frame));
+    writer.begin(NODE_ID);
+
+    while (sending < count && writer.write(batch[sending]))
+      sending++;
+
+    if (Board.lora->sendReliablePacket(frame, writer.size(), DESTINATION_ID) != 0)
+      sending = 0;
+  }
+
+  // Send and receive for 1 second
+  unsigned long start = millis();
+  while (millis() - start < 1000)
+    Board.process();
+}
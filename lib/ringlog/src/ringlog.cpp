@@ -0,0 +1,315 @@
+/**
+ * @file ringlog.cpp
+ * @brief Persistent ring log of fixed-size records on flash, for store-and-forward queues
+ *
+ * Description:
+ *
+ * This library keeps records in a ring of append-only segments of a NOR flash (or any `RingLogStorage`).
+ * Check `ringlog.h` for the layout and the crash safety.
+ *
+ * Depends On:
+ * - ringlogstorage.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "ringlog.h"
+
+#include <stdexcept>
+#include <string.h>
+
+/**
+ * @brief CRC-8 (polynomial 0x07) of a record
+ */
+static uint8_t _crc8(const uint8_t *data, size_t size)
+{
+  uint8_t crc = 0;
+
+  for (size_t i = 0; i < size; i++)
+  {
+    crc ^= data[i];
+
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+
+  return crc;
+}
+
+RingLog::RingLog(RingLogStorage *storage, size_t recordSize)
+    : _storage(storage), _recordSize(recordSize), _slotSize(RINGLOG_SLOT_HEADER_SIZE + recordSize), _segmentCount(0), _slotsPerSegment(0),
+      _headSegment(0), _headSlot(0), _tailSegment(0), _tailSlot(0), _sequence(0), _count(0)
+{
+}
+
+bool RingLog::begin()
+{
+  if (!_storage->begin())
+    return false;
+
+  size_t segmentSize = _storage->getSegmentSize();
+  _segmentCount = _storage->getSegmentCount();
+
+  if (segmentSize < RINGLOG_SEGMENT_HEADER_SIZE + _slotSize)
+    throw std::runtime_error("Ring log record doesn't fit in a segment.");
+
+  if (_segmentCount < 2)
+    throw std::runtime_error("Ring log needs at least 2 segments, one is erased while the other is in use.");
+
+  _slotsPerSegment = (segmentSize - RINGLOG_SEGMENT_HEADER_SIZE) / _slotSize;
+  _count = 0;
+
+  // Head: the newest segment
+  bool found = false;
+  uint32_t sequence;
+
+  for (int segment = 0; segment < _segmentCount; segment++)
+    if (_readSegmentHeader(segment, sequence) && (!found || sequence > _sequence))
+    {
+      found = true;
+      _sequence = sequence;
+      _headSegment = segment;
+    }
+
+  if (!found)
+  {
+    // Empty storage, the first append opens segment 0
+    _sequence = 0;
+    _headSegment = _segmentCount - 1;
+    _headSlot = _slotsPerSegment;
+    _tailSegment = 0;
+    _tailSlot = 0;
+    return true;
+  }
+
+  // Appends are sequential, the head is the first slot never written (a torn append may have written only its CRC)
+  uint8_t *record = new uint8_t[_slotSize];
+  _headSlot = _slotsPerSegment;
+
+  for (unsigned int slot = 0; slot < _slotsPerSegment; slot++)
+  {
+    bool erased = _storage->read(_headSegment, _getSlotOffset(slot), record, _slotSize);
+
+    for (size_t i = 0; erased && i < _slotSize; i++)
+      erased = record[i] == 0xFF;
+
+    if (erased)
+    {
+      _headSlot = slot;
+      break;
+    }
+  }
+
+  // Tail: the first written slot from the oldest segment, the one after the head on the ring
+  bool tailFound = false;
+
+  for (int i = 1; i <= _segmentCount; i++)
+  {
+    int segment = (_headSegment + i) % _segmentCount;
+
+    if (!_readSegmentHeader(segment, sequence))
+      continue;
+
+    unsigned int slots = segment == _headSegment ? _headSlot : _slotsPerSegment;
+
+    for (unsigned int slot = 0; slot < slots; slot++)
+    {
+      uint8_t state = _readSlot(segment, slot, record);
+
+      // Consumed from now on, so it is skipped without being counted
+      if (state == RINGLOG_SLOT_CORRUPTED)
+      {
+        uint8_t consumed = RINGLOG_SLOT_CONSUMED;
+        _storage->write(segment, _getSlotOffset(slot), &consumed, 1);
+      }
+
+      if (state != RINGLOG_SLOT_WRITTEN)
+        continue;
+
+      if (!tailFound)
+      {
+        tailFound = true;
+        _tailSegment = segment;
+        _tailSlot = slot;
+      }
+
+      _count++;
+    }
+  }
+
+  delete[] record;
+
+  // Empty log, the tail is the head (the first slot of the next segment when the head one is full)
+  if (!tailFound)
+  {
+    _tailSegment = _headSlot == _slotsPerSegment ? (_headSegment + 1) % _segmentCount : _headSegment;
+    _tailSlot = _headSlot == _slotsPerSegment ? 0 : _headSlot;
+  }
+
+  return true;
+}
+
+bool RingLog::append(const void *record)
+{
+  if (_headSlot == _slotsPerSegment && !_openSegment())
+    return false;
+
+  size_t offset = _getSlotOffset(_headSlot);
+  uint8_t crc = _crc8((const uint8_t *)record, _recordSize);
+  uint8_t state = RINGLOG_SLOT_WRITTEN;
+
+  // The state is written last, a reset before it leaves a torn slot that is skipped
+  if (!_storage->write(_headSegment, offset + 1, &crc, 1) ||
+      !_storage->write(_headSegment, offset + RINGLOG_SLOT_HEADER_SIZE, record, _recordSize) ||
+      !_storage->write(_headSegment, offset, &state, 1))
+    return false;
+
+  if (_count == 0)
+  {
+    _tailSegment = _headSegment;
+    _tailSlot = _headSlot;
+  }
+
+  _headSlot++;
+  _count++;
+
+  return true;
+}
+
+unsigned int RingLog::peek(void *records, unsigned int max)
+{
+  unsigned int read = 0;
+  unsigned int slots = _getSlotsToHead();
+  int segment = _tailSegment;
+  unsigned int slot = _tailSlot;
+
+  // Corrupted records are skipped, and removed with the others by `pop()`
+  for (; read < max && slots > 0; slots--)
+  {
+    if (_readSlot(segment, slot, (uint8_t *)records + read * _recordSize) == RINGLOG_SLOT_WRITTEN)
+      read++;
+
+    _advance(segment, slot);
+  }
+
+  return read;
+}
+
+unsigned int RingLog::pop(unsigned int count)
+{
+  unsigned int popped = 0;
+  unsigned int slots = _getSlotsToHead();
+  uint8_t consumed = RINGLOG_SLOT_CONSUMED;
+
+  // The tail stops on the next written slot (or the head), skipping the torn and consumed ones
+  for (; slots > 0; slots--)
+  {
+    if (_readSlot(_tailSegment, _tailSlot, NULL) == RINGLOG_SLOT_WRITTEN)
+    {
+      if (popped == count)
+        break;
+
+      if (!_storage->write(_tailSegment, _getSlotOffset(_tailSlot), &consumed, 1))
+        break;
+
+      popped++;
+      _count--;
+    }
+
+    _advance(_tailSegment, _tailSlot);
+  }
+
+  return popped;
+}
+
+unsigned int RingLog::count() const
+{
+  return _count;
+}
+
+unsigned int RingLog::capacity() const
+{
+  return (_segmentCount - 1) * _slotsPerSegment;
+}
+
+bool RingLog::_openSegment()
+{
+  int segment = (_headSegment + 1) % _segmentCount;
+
+  // The next segment still holds the oldest records
+  if (_count > 0 && segment == _tailSegment)
+    return false;
+
+  uint32_t sequence = _sequence + 1;
+  uint32_t magic = RINGLOG_MAGIC;
+
+  // The magic is written last, a reset before it leaves a segment without a valid header, still free
+  if (!_storage->erase(segment) ||
+      !_storage->write(segment, sizeof(magic), &sequence, sizeof(sequence)) ||
+      !_storage->write(segment, 0, &magic, sizeof(magic)))
+    return false;
+
+  _sequence++;
+  _headSegment = segment;
+  _headSlot = 0;
+
+  return true;
+}
+
+bool RingLog::_readSegmentHeader(int segment, uint32_t &sequence)
+{
+  uint32_t header[2];
+
+  if (!_storage->read(segment, 0, header, sizeof(header)) || header[0] != RINGLOG_MAGIC)
+    return false;
+
+  sequence = header[1];
+  return true;
+}
+
+uint8_t RingLog::_readSlot(int segment, unsigned int slot, void *record)
+{
+  size_t offset = _getSlotOffset(slot);
+  uint8_t header[RINGLOG_SLOT_HEADER_SIZE];
+
+  if (record == NULL)
+    return _storage->read(segment, offset, header, 1) ? header[0] : RINGLOG_SLOT_CONSUMED;
+
+  if (!_storage->read(segment, offset, header, sizeof(header)) ||
+      !_storage->read(segment, offset + RINGLOG_SLOT_HEADER_SIZE, record, _recordSize))
+    return RINGLOG_SLOT_CONSUMED;
+
+  if (header[0] == RINGLOG_SLOT_WRITTEN && header[1] != _crc8((const uint8_t *)record, _recordSize))
+    return RINGLOG_SLOT_CORRUPTED;
+
+  return header[0];
+}
+
+size_t RingLog::_getSlotOffset(unsigned int slot) const
+{
+  return RINGLOG_SEGMENT_HEADER_SIZE + slot * _slotSize;
+}
+
+void RingLog::_advance(int &segment, unsigned int &slot) const
+{
+  if (++slot >= _slotsPerSegment)
+  {
+    segment = (segment + 1) % _segmentCount;
+    slot = 0;
+  }
+}
+
+unsigned int RingLog::_getSlotsToHead() const
+{
+  if (_count == 0)
+    return 0;
+
+  unsigned int ring = _segmentCount * _slotsPerSegment;
+  unsigned int head = _headSegment * _slotsPerSegment + _headSlot;
+  unsigned int tail = _tailSegment * _slotsPerSegment + _tailSlot;
+  unsigned int slots = (head + ring - tail) % ring;
+
+  // With every segment in use the head wraps around to the tail
+  return slots == 0 ? ring : slots;
+}
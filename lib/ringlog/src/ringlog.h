@@ -0,0 +1,185 @@
+/**
+ * @file ringlog.h
+ * @brief Persistent ring log of fixed-size records on flash, for store-and-forward queues
+ *
+ * Description:
+ *
+ * This library keeps records in a ring of append-only segments of a NOR flash (or any `RingLogStorage`),
+ * so readings survive an outage of the uplink, and a reset, and are drained in large batches when it returns.
+ *
+ * Layout:
+ * - Segment: header (magic, sequence) + slots, erased as a whole when the ring comes back to it
+ * - Slot: state (1 byte) + CRC-8 of the record (1 byte) + record
+ *
+ * Crash safety, every write only clears bits and the one that commits a change is written last:
+ * - Append: the CRC and the record are written first, then the state goes from free (0xFF) to written (0x7F).
+ *   A reset in between leaves a slot that is neither free nor written, skipped on recovery.
+ * - Pop: the state goes from written (0x7F) to consumed (0x3F), once the records were delivered (at least once delivery).
+ * - Segment: erased, then its sequence is written, then its magic. A segment without a valid magic is free.
+ *
+ * `begin()` recovers the head (after the last used slot of the newest segment) and the tail (first written slot from the oldest segment).
+ *
+ * @note Not thread safe, guard the calls with a mutex when the log is shared between tasks.
+ *
+ * Depends On:
+ * - ringlogstorage.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef RINGLOG_H
+#define RINGLOG_H
+
+#include "ringlogstorage.h"
+
+// Segment header magic
+#define RINGLOG_MAGIC 0x31474C52 // "RLG1"
+
+// Size of the segment header (magic, sequence) - bytes
+#define RINGLOG_SEGMENT_HEADER_SIZE 8
+
+// Size of the slot header (state, CRC) - bytes
+#define RINGLOG_SLOT_HEADER_SIZE 2
+
+// Slot states, each one only clears bits of the previous one
+#define RINGLOG_SLOT_FREE 0xFF
+#define RINGLOG_SLOT_WRITTEN 0x7F
+#define RINGLOG_SLOT_CONSUMED 0x3F
+
+// Written slot with a wrong CRC, never stored
+#define RINGLOG_SLOT_CORRUPTED 0x00
+
+/**
+ * @brief Persistent ring log of fixed-size records
+ */
+class RingLog
+{
+public:
+  /**
+   * @brief Construct a new Ring Log
+   *
+   * @param storage Storage of the log, kept open by the log
+   * @param recordSize Size of a record - bytes
+   */
+  RingLog(RingLogStorage *storage, size_t recordSize);
+
+  /**
+   * @brief Open the storage and recover the head and tail of the log
+   *
+   * @note Throws if a record doesn't fit in a segment or there are less than 2 segments
+   *
+   * @return bool Opened [false: storage not available]
+   */
+  bool begin();
+
+  /**
+   * @brief Append a record at the head of the log
+   *
+   * @param record Record to append (`recordSize` bytes)
+   * @return bool Appended [false: log full or storage error]
+   */
+  bool append(const void *record);
+
+  /**
+   * @brief Read the oldest records without removing them
+   *
+   * @param records Buffer to read to (`max * recordSize` bytes)
+   * @param max Maximum number of records
+   * @return unsigned int Records read
+   */
+  unsigned int peek(void *records, unsigned int max);
+
+  /**
+   * @brief Remove the oldest records, once they were delivered
+   *
+   * @param count Number of records
+   * @return unsigned int Records removed
+   */
+  unsigned int pop(unsigned int count);
+
+  /**
+   * @brief Get the number of records in the log
+   *
+   * @return unsigned int Record count
+   */
+  unsigned int count() const;
+
+  /**
+   * @brief Get the number of records the log always holds
+   *
+   * @note Up to a segment more of records fits, the oldest segment is only erased when all of its records were removed
+   *
+   * @return unsigned int Record capacity
+   */
+  unsigned int capacity() const;
+
+private:
+  RingLogStorage *_storage;
+  size_t _recordSize;
+  size_t _slotSize;
+  int _segmentCount;
+  unsigned int _slotsPerSegment;
+
+  // Next slot to append to, `_slotsPerSegment` when a new segment has to be opened
+  int _headSegment;
+  unsigned int _headSlot;
+  // Oldest slot not consumed, equal to the head when the log is empty
+  int _tailSegment;
+  unsigned int _tailSlot;
+
+  // Sequence of the newest segment
+  uint32_t _sequence;
+  unsigned int _count;
+
+  /**
+   * @brief Erase the segment after the head and write its header
+   *
+   * @return bool Opened [false: log full or storage error]
+   */
+  bool _openSegment();
+
+  /**
+   * @brief Read the header of a segment
+   *
+   * @param segment Segment index
+   * @param sequence Sequence of the segment
+   * @return bool Valid header
+   */
+  bool _readSegmentHeader(int segment, uint32_t &sequence);
+
+  /**
+   * @brief Read the state of a slot, and its record
+   *
+   * @param segment Segment index
+   * @param slot Slot index
+   * @param record Buffer to read the record to, checking its CRC [NULL: state only]
+   * @return uint8_t Slot state [RINGLOG_SLOT_FREE, RINGLOG_SLOT_WRITTEN, RINGLOG_SLOT_CONSUMED, RINGLOG_SLOT_CORRUPTED, other: torn write]
+   */
+  uint8_t _readSlot(int segment, unsigned int slot, void *record);
+
+  /**
+   * @brief Get the offset of a slot in its segment
+   *
+   * @param slot Slot index
+   * @return size_t Offset - bytes
+   */
+  size_t _getSlotOffset(unsigned int slot) const;
+
+  /**
+   * @brief Move a position to the next slot, on the next segment of the ring after the last slot
+   *
+   * @param segment Segment index
+   * @param slot Slot index
+   */
+  void _advance(int &segment, unsigned int &slot) const;
+
+  /**
+   * @brief Get the number of slots from the tail to the head
+   *
+   * @return unsigned int Slot count
+   */
+  unsigned int _getSlotsToHead() const;
+};
+
+#endif
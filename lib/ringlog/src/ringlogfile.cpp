@@ -0,0 +1,109 @@
+/**
+ * @file ringlogfile.cpp
+ * @brief File storage of the RingLog library, to run the log on a host
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "ringlogfile.h"
+
+#if !defined(ARDUINO)
+
+#include <string.h>
+
+// Bytes handled at once when erasing or clearing bits - bytes
+#define RINGLOGFILE_CHUNK_SIZE 256
+
+RingLogFile::RingLogFile(const char *path, size_t segmentSize, int segmentCount)
+    : _path(path), _segmentSize(segmentSize), _segmentCount(segmentCount), _file(NULL)
+{
+}
+
+RingLogFile::~RingLogFile()
+{
+  if (_file != NULL)
+    fclose(_file);
+}
+
+bool RingLogFile::begin()
+{
+  if (_file != NULL)
+    return true;
+
+  _file = fopen(_path, "r+b");
+
+  if (_file == NULL)
+  {
+    // New storage, erased like a new flash
+    _file = fopen(_path, "w+b");
+
+    if (_file == NULL)
+      return false;
+
+    for (int segment = 0; segment < _segmentCount; segment++)
+      if (!erase(segment))
+        return false;
+  }
+
+  return true;
+}
+
+size_t RingLogFile::getSegmentSize()
+{
+  return _segmentSize;
+}
+
+int RingLogFile::getSegmentCount()
+{
+  return _segmentCount;
+}
+
+bool RingLogFile::read(int segment, size_t offset, void *data, size_t size)
+{
+  return fseek(_file, (long)(segment * _segmentSize + offset), SEEK_SET) == 0 && fread(data, 1, size, _file) == size;
+}
+
+bool RingLogFile::write(int segment, size_t offset, const void *data, size_t size)
+{
+  uint8_t chunk[RINGLOGFILE_CHUNK_SIZE];
+  const uint8_t *bytes = (const uint8_t *)data;
+
+  // Like a flash, only the bits cleared by the data are cleared
+  for (size_t done = 0; done < size; done += sizeof(chunk))
+  {
+    size_t length = size - done < sizeof(chunk) ? size - done : sizeof(chunk);
+
+    if (!read(segment, offset + done, chunk, length))
+      return false;
+
+    for (size_t i = 0; i < length; i++)
+      chunk[i] &= bytes[done + i];
+
+    if (fseek(_file, (long)(segment * _segmentSize + offset + done), SEEK_SET) != 0 || fwrite(chunk, 1, length, _file) != length)
+      return false;
+  }
+
+  return fflush(_file) == 0;
+}
+
+bool RingLogFile::erase(int segment)
+{
+  uint8_t chunk[RINGLOGFILE_CHUNK_SIZE];
+  memset(chunk, 0xFF, sizeof(chunk));
+
+  if (fseek(_file, (long)(segment * _segmentSize), SEEK_SET) != 0)
+    return false;
+
+  for (size_t done = 0; done < _segmentSize; done += sizeof(chunk))
+  {
+    size_t length = _segmentSize - done < sizeof(chunk) ? _segmentSize - done : sizeof(chunk);
+
+    if (fwrite(chunk, 1, length, _file) != length)
+      return false;
+  }
+
+  return fflush(_file) == 0;
+}
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file ringlogfile.h
+ * @brief File storage of the RingLog library, to run the log on a host
+ *
+ * Description:
+ *
+ * Keeps the segments in a file, with the semantics of a NOR flash: erased segments are all ones and writes only clear bits,
+ * so the log behaves on a host (tests, benchmarks, simulators) like on the board, resets included.
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef RINGLOGFILE_H
+#define RINGLOGFILE_H
+
+#if !defined(ARDUINO)
+
+#include "ringlogstorage.h"
+
+#include <stdio.h>
+
+/**
+ * @brief File storage of a `RingLog`
+ */
+class RingLogFile : public RingLogStorage
+{
+public:
+  /**
+   * @brief Construct a new Ring Log File
+   *
+   * @param path File path, created erased when it doesn't exist
+   * @param segmentSize Segment size - bytes
+   * @param segmentCount Segment count
+   */
+  RingLogFile(const char *path, size_t segmentSize, int segmentCount);
+  ~RingLogFile();
+
+  bool begin() override;
+  size_t getSegmentSize() override;
+  int getSegmentCount() override;
+  bool read(int segment, size_t offset, void *data, size_t size) override;
+  bool write(int segment, size_t offset, const void *data, size_t size) override;
+  bool erase(int segment) override;
+
+private:
+  const char *_path;
+  size_t _segmentSize;
+  int _segmentCount;
+  FILE *_file;
+};
+
+#endif
+
+#endif
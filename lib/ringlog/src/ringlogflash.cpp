@@ -0,0 +1,56 @@
+/**
+ * @file ringlogflash.cpp
+ * @brief Flash storage of the RingLog library, on a data partition of the ESP32
+ *
+ * Depends On:
+ * - esp_partition.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "ringlogflash.h"
+
+#if defined(ARDUINO)
+
+RingLogFlash::RingLogFlash(const char *label, int maxSegments)
+    : _label(label), _maxSegments(maxSegments), _partition(NULL)
+{
+}
+
+bool RingLogFlash::begin()
+{
+  if (_partition == NULL)
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, _label);
+
+  return _partition != NULL;
+}
+
+size_t RingLogFlash::getSegmentSize()
+{
+  return SPI_FLASH_SEC_SIZE;
+}
+
+int RingLogFlash::getSegmentCount()
+{
+  int count = _partition->size / SPI_FLASH_SEC_SIZE;
+
+  return _maxSegments > 0 && _maxSegments < count ? _maxSegments : count;
+}
+
+bool RingLogFlash::read(int segment, size_t offset, void *data, size_t size)
+{
+  return esp_partition_read(_partition, segment * SPI_FLASH_SEC_SIZE + offset, data, size) == ESP_OK;
+}
+
+bool RingLogFlash::write(int segment, size_t offset, const void *data, size_t size)
+{
+  return esp_partition_write(_partition, segment * SPI_FLASH_SEC_SIZE + offset, data, size) == ESP_OK;
+}
+
+bool RingLogFlash::erase(int segment)
+{
+  return esp_partition_erase_range(_partition, segment * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+#endif
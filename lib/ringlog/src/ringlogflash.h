@@ -0,0 +1,58 @@
+/**
+ * @file ringlogflash.h
+ * @brief Flash storage of the RingLog library, on a data partition of the ESP32
+ *
+ * Description:
+ *
+ * Keeps the segments in a data partition of the flash, one segment per flash sector (4 KB).
+ * By default the `spiffs` partition of the Arduino partition tables is used, it must not be mounted as a file system.
+ *
+ * Depends On:
+ * - esp_partition.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef RINGLOGFLASH_H
+#define RINGLOGFLASH_H
+
+#if defined(ARDUINO)
+
+#include "ringlogstorage.h"
+
+#include <esp_partition.h>
+
+// Default partition label
+#define RINGLOGFLASH_PARTITION "spiffs"
+
+/**
+ * @brief Flash storage of a `RingLog`
+ */
+class RingLogFlash : public RingLogStorage
+{
+public:
+  /**
+   * @brief Construct a new Ring Log Flash
+   *
+   * @param label Label of the data partition
+   * @param maxSegments Maximum number of segments used, to bound the recovery scan on `begin()` [0: whole partition]
+   */
+  RingLogFlash(const char *label = RINGLOGFLASH_PARTITION, int maxSegments = 0);
+
+  bool begin() override;
+  size_t getSegmentSize() override;
+  int getSegmentCount() override;
+  bool read(int segment, size_t offset, void *data, size_t size) override;
+  bool write(int segment, size_t offset, const void *data, size_t size) override;
+  bool erase(int segment) override;
+
+private:
+  const char *_label;
+  int _maxSegments;
+  const esp_partition_t *_partition;
+};
+
+#endif
+
+#endif
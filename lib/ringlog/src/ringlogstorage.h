@@ -0,0 +1,85 @@
+/**
+ * @file ringlogstorage.h
+ * @brief Storage interface of the RingLog library
+ *
+ * Description:
+ *
+ * `RingLog` only talks to its storage through this interface, with the semantics of a NOR flash:
+ * - The storage is split in segments, erased as a whole to all ones (0xFF)
+ * - A write can only clear bits, so bytes are written once after an erase (or cleared further, like the slot states)
+ *
+ * Implementations:
+ * - `RingLogFlash`: a flash partition of the ESP32
+ * - `RingLogFile`: a file, to run and benchmark the log on a host
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef RINGLOGSTORAGE_H
+#define RINGLOGSTORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Storage of a `RingLog`
+ */
+class RingLogStorage
+{
+public:
+  virtual ~RingLogStorage() {}
+
+  /**
+   * @brief Open the storage
+   *
+   * @return bool Opened [false: storage not available]
+   */
+  virtual bool begin() = 0;
+
+  /**
+   * @brief Get the size of a segment, the erase unit
+   *
+   * @return size_t Segment size - bytes
+   */
+  virtual size_t getSegmentSize() = 0;
+
+  /**
+   * @brief Get the number of segments
+   *
+   * @return int Segment count
+   */
+  virtual int getSegmentCount() = 0;
+
+  /**
+   * @brief Read bytes of a segment
+   *
+   * @param segment Segment index
+   * @param offset Offset in the segment - bytes
+   * @param data Buffer to read to
+   * @param size Number of bytes
+   * @return bool Read [false: storage error]
+   */
+  virtual bool read(int segment, size_t offset, void *data, size_t size) = 0;
+
+  /**
+   * @brief Write bytes of a segment, only clearing bits
+   *
+   * @param segment Segment index
+   * @param offset Offset in the segment - bytes
+   * @param data Bytes to write
+   * @param size Number of bytes
+   * @return bool Written [false: storage error]
+   */
+  virtual bool write(int segment, size_t offset, const void *data, size_t size) = 0;
+
+  /**
+   * @brief Erase a segment to all ones
+   *
+   * @param segment Segment index
+   * @return bool Erased [false: storage error]
+   */
+  virtual bool erase(int segment) = 0;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file benchmark.cpp
+ * @brief Host benchmark of the ring log on a file, with the geometry of the ESP32 flash
+ *
+ * Description:
+ *
+ * Fills a log of 4 KB segments with readings (16 bytes, the size of `SensorData` on the board), like a relay during an outage,
+ * recovers it as after a reset, then drains it in batches of different sizes, like the relay when the link returns.
+ *
+ * Reports records per second on the host and the storage operations per record (reads, writes, bytes written, erases),
+ * which don't depend on the host and give the flash cost on the board.
+ *
+ * Build and run from the repository root: lib/ringlog/tools/benchmarkBuild && ./ringlog-benchmark [segments] [file]
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "ringlog.h"
+#include "ringlogfile.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCHMARK_SEGMENT_SIZE 4096 // bytes, one flash sector
+#define BENCHMARK_MAX_BATCH 256     // records
+
+/**
+ * @brief Reading as stored on the board (`SensorData` with 32-bit `long`)
+ */
+typedef struct
+{
+  int32_t index;
+  int32_t nodeId;
+  float temperature;
+  uint32_t timestamp;
+} Record;
+
+/**
+ * @brief Storage counting the operations of another one
+ */
+class CountingStorage : public RingLogStorage
+{
+public:
+  unsigned long reads = 0, writes = 0, bytesWritten = 0, erases = 0;
+
+  CountingStorage(RingLogStorage *storage) : _storage(storage) {}
+
+  bool begin() override { return _storage->begin(); }
+  size_t getSegmentSize() override { return _storage->getSegmentSize(); }
+  int getSegmentCount() override { return _storage->getSegmentCount(); }
+
+  bool read(int segment, size_t offset, void *data, size_t size) override
+  {
+    reads++;
+    return _storage->read(segment, offset, data, size);
+  }
+
+  bool write(int segment, size_t offset, const void *data, size_t size) override
+  {
+    writes++;
+    bytesWritten += size;
+    return _storage->write(segment, offset, data, size);
+  }
+
+  bool erase(int segment) override
+  {
+    erases++;
+    return _storage->erase(segment);
+  }
+
+  void reset() { reads = writes = bytesWritten = erases = 0; }
+
+private:
+  RingLogStorage *_storage;
+};
+
+static double nowS()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char *label, unsigned int records, double seconds, const CountingStorage &counter)
+{
+  printf("%-12s %8u %12.0f %10.2f %10.2f %12.1f %10.4f\n", label, records, records / seconds,
+         (double)counter.reads / records, (double)counter.writes / records, (double)counter.bytesWritten / records,
+         (double)counter.erases / records);
+}
+
+/**
+ * @brief Fill the log until it is full
+ */
+static unsigned int fill(RingLog &log, uint32_t &next)
+{
+  unsigned int count = 0;
+  Record record;
+
+  while (true)
+  {
+    record.index = next;
+    record.nodeId = 2 + next % 4;
+    record.temperature = 20 + (next % 100) / 10.0f;
+    record.timestamp = next * 10000;
+
+    if (!log.append(&record))
+      return count;
+
+    next++;
+    count++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int segments = argc > 1 ? atoi(argv[1]) : 64;
+  const char *path = argc > 2 ? argv[2] : "ringlog-benchmark.bin";
+  unsigned int batches[] = {1, 10, 80, BENCHMARK_MAX_BATCH};
+
+  remove(path);
+
+  RingLogFile file(path, BENCHMARK_SEGMENT_SIZE, segments);
+  CountingStorage counter(&file);
+  RingLog log(&counter, sizeof(Record));
+
+  if (!log.begin())
+  {
+    printf("Can't open %s\n", path);
+    return 1;
+  }
+
+  printf("%d segments of %d bytes, %zu-byte records, capacity %u records\n", segments, BENCHMARK_SEGMENT_SIZE, sizeof(Record), log.capacity());
+  printf("%-12s %8s %12s %10s %10s %12s %10s\n", "operation", "records", "records/s", "reads/rec", "writes/rec", "bytes wr/rec", "erases/rec");
+
+  static Record records[BENCHMARK_MAX_BATCH];
+  uint32_t next = 0;
+
+  for (unsigned int batch : batches)
+  {
+    // Outage: the relay spills its readings until the log is full
+    counter.reset();
+    double start = nowS();
+    unsigned int appended = fill(log, next);
+    report("append", appended, nowS() - start, counter);
+
+    // Reset: the head and the tail are recovered from the flash
+    RingLog recovered(&counter, sizeof(Record));
+    counter.reset();
+    start = nowS();
+    recovered.begin();
+    double seconds = nowS() - start;
+    printf("%-12s %8u %12.0f %10.2f %10s %12s %10s   (%.2f ms)\n", "recover", recovered.count(), recovered.count() / seconds,
+           (double)counter.reads / recovered.count(), "-", "-", "-", seconds * 1000);
+
+    if (recovered.count() != log.count())
+    {
+      printf("Recovered %u records of %u\n", recovered.count(), log.count());
+      return 1;
+    }
+
+    // Link back: drained in batches, each one removed once delivered
+    char label[16];
+    snprintf(label, sizeof(label), "drain %u", batch);
+    counter.reset();
+    start = nowS();
+    unsigned int drained = 0;
+    uint32_t expected = recovered.count() > 0 ? next - recovered.count() : next;
+
+    while (recovered.count() > 0)
+    {
+      unsigned int count = recovered.peek(records, batch);
+
+      for (unsigned int i = 0; i < count; i++)
+        if ((uint32_t)records[i].index != expected++)
+        {
+          printf("Read record %d, expected %u\n", records[i].index, expected - 1);
+          return 1;
+        }
+
+      drained += recovered.pop(count);
+    }
+
+    report(label, drained, nowS() - start, counter);
+
+    // The next round appends on the recovered log
+    log.begin();
+  }
+
+  remove(path);
+  return 0;
+}
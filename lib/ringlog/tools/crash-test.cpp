@@ -0,0 +1,242 @@
+/**
+ * @file crash-test.cpp
+ * @brief Host test of the ring log crash safety, resets at random points of its writes and erases
+ *
+ * Description:
+ *
+ * Runs appends and pops on a small log (4 segments of 6 slots, so it wraps often) on a file with the semantics of a NOR flash,
+ * and cuts the power at a random storage operation: the write or erase going on is torn partway through
+ * (a prefix of its bytes done, the next byte with only some of its bits cleared) and nothing else reaches the storage.
+ * The log is then recovered with `begin()`, like after a reset, and the test checks that:
+ * - The records recovered are contiguous and in order
+ * - No record appended and not popped is lost, only the append torn may be there or not
+ * - No record popped comes back, only the one being popped when torn may be there or not
+ *
+ * Each trial goes on from the log recovered on the last one, and a few appends and pops are checked against the records expected
+ * before the next reset.
+ *
+ * Build and run from the repository root: lib/ringlog/tools/benchmarkBuild && ./ringlog-crash-test [trials] [file]
+ * Exits with 1 on the first check that fails.
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "ringlog.h"
+#include "ringlogfile.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SEGMENT_SIZE 128 // bytes, 6 slots of 18 bytes
+#define TEST_SEGMENT_COUNT 4
+#define TEST_MAX_OPERATIONS 400 // storage operations before the reset, at most
+#define TEST_MAX_BATCH 8        // records popped at once, at most
+#define TEST_MAX_RECORDS (TEST_SEGMENT_COUNT * (TEST_SEGMENT_SIZE / 16))
+
+/**
+ * @brief Reading as stored on the board (`SensorData` with 32-bit `long`), the index orders them
+ */
+typedef struct
+{
+  int32_t index;
+  int32_t nodeId;
+  float temperature;
+  uint32_t timestamp;
+} Record;
+
+/**
+ * @brief Storage that loses the power on a given operation, tearing it
+ */
+class CrashStorage : public RingLogStorage
+{
+public:
+  unsigned long tornWrites = 0, tornErases = 0;
+
+  CrashStorage(RingLogStorage *storage) : _storage(storage), _operations(-1), _crashed(false) {}
+
+  bool begin() override { return _storage->begin(); }
+  size_t getSegmentSize() override { return _storage->getSegmentSize(); }
+  int getSegmentCount() override { return _storage->getSegmentCount(); }
+
+  bool read(int segment, size_t offset, void *data, size_t size) override
+  {
+    return !_crashed && _storage->read(segment, offset, data, size);
+  }
+
+  bool write(int segment, size_t offset, const void *data, size_t size) override
+  {
+    if (_crashed)
+      return false;
+
+    if (_operations < 0 || --_operations > 0)
+      return _storage->write(segment, offset, data, size);
+
+    // Torn: a prefix of the bytes, then some of the bits of the next one
+    size_t done = rand() % size;
+    uint8_t partial = ((const uint8_t *)data)[done] | (uint8_t)rand();
+
+    if (done > 0)
+      _storage->write(segment, offset, data, done);
+    _storage->write(segment, offset + done, &partial, 1);
+
+    tornWrites++;
+    _crashed = true;
+    return false;
+  }
+
+  bool erase(int segment) override
+  {
+    if (_crashed)
+      return false;
+
+    if (_operations < 0 || --_operations > 0)
+      return _storage->erase(segment);
+
+    // Torn: the segment erased up to some point, it keeps the rest of its bytes
+    size_t done = rand() % getSegmentSize();
+    uint8_t kept[TEST_SEGMENT_SIZE];
+
+    _storage->read(segment, 0, kept, getSegmentSize());
+    _storage->erase(segment);
+    _storage->write(segment, done, kept + done, getSegmentSize() - done);
+
+    tornErases++;
+    _crashed = true;
+    return false;
+  }
+
+  /**
+   * @brief Lose the power on an operation
+   *
+   * @param operations Writes and erases until the torn one [-1: never]
+   */
+  void crashAfter(long operations)
+  {
+    _operations = operations;
+    _crashed = false;
+  }
+
+  bool crashed() const { return _crashed; }
+
+private:
+  RingLogStorage *_storage;
+  long _operations;
+  bool _crashed;
+};
+
+/**
+ * @brief Read every record of the log, checking they are contiguous and in order
+ *
+ * @return bool Checked [false: reported]
+ */
+static bool readAll(RingLog &log, Record *records, unsigned int &count)
+{
+  count = log.peek(records, TEST_MAX_RECORDS);
+
+  if (count != log.count())
+  {
+    printf("Read %u records, the log counts %u\n", count, log.count());
+    return false;
+  }
+
+  for (unsigned int i = 1; i < count; i++)
+    if (records[i].index != records[i - 1].index + 1)
+    {
+      printf("Record %d after record %d\n", records[i].index, records[i - 1].index);
+      return false;
+    }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  int trials = argc > 1 ? atoi(argv[1]) : 3000;
+  const char *path = argc > 2 ? argv[2] : "ringlog-crash-test.bin";
+
+  remove(path);
+  srand(1);
+
+  RingLogFile file(path, TEST_SEGMENT_SIZE, TEST_SEGMENT_COUNT);
+  CrashStorage storage(&file);
+
+  // Records expected in the log: from `oldest` to `next - 1`
+  int32_t oldest = 0, next = 0;
+  // Operation torn by the last reset
+  bool tornAppend = false, tornPop = false;
+  unsigned long checked = 0;
+  static Record records[TEST_MAX_RECORDS];
+
+  for (int trial = 0; trial < trials; trial++)
+  {
+    storage.crashAfter(-1);
+    RingLog log(&storage, sizeof(Record));
+
+    if (!log.begin())
+    {
+      printf("Can't open %s\n", path);
+      return 1;
+    }
+
+    unsigned int count;
+    if (!readAll(log, records, count))
+      return 1;
+
+    // The record of a torn append may be there at the end, the one of a torn pop at the start
+    int32_t first = count > 0 ? records[0].index : next;
+    int32_t last = count > 0 ? records[count - 1].index : next - 1;
+
+    if (count > 0 ? first < oldest || first > oldest + (tornPop ? 1 : 0) || last < next - 1 || last > next - 1 + (tornAppend ? 1 : 0)
+                  : next - oldest > (tornPop ? 1 : 0))
+    {
+      printf("Trial %d: recovered records %d to %d, expected %d to %d\n", trial, first, last, oldest, next - 1);
+      return 1;
+    }
+
+    oldest = first;
+    next = last + 1;
+    checked += count;
+
+    // Appends and pops until the reset
+    storage.crashAfter(1 + rand() % TEST_MAX_OPERATIONS);
+    tornAppend = tornPop = false;
+
+    while (!storage.crashed())
+    {
+      if (rand() % 5 < 3)
+      {
+        Record record = {next, 2 + next % 4, 20 + (next % 100) / 10.0f, (uint32_t)next * 10000};
+
+        if (log.append(&record))
+          next++;
+        else if (storage.crashed())
+          tornAppend = true;
+        else
+          oldest += log.pop(1 + rand() % TEST_MAX_BATCH); // Full
+
+        tornPop = !tornAppend && storage.crashed();
+        continue;
+      }
+
+      unsigned int batch = 1 + rand() % TEST_MAX_BATCH;
+      unsigned int read = log.peek(records, batch);
+
+      if (read > 0 && records[0].index != oldest)
+      {
+        printf("Trial %d: peeked record %d, expected %d\n", trial, records[0].index, oldest);
+        return 1;
+      }
+
+      oldest += log.pop(read);
+      tornPop = storage.crashed();
+    }
+  }
+
+  printf("%d resets (%lu torn writes, %lu torn erases), %lu records recovered: OK\n", trials, storage.tornWrites, storage.tornErases, checked);
+
+  remove(path);
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file usage.cpp
+ * @brief Example to use the sensorcodec library to send sensor readings over LoRa
+ *
+ * Description:
+ *
+ * This example encodes a batch of readings straight into a frame buffer, sends it with `sendReliablePacket()`
+ * and decodes the batches received on the `onReceive` callback, without copying the payload.
+ *
+ * Depends On:
+ * - sensorcodec
+ * - htwlv3
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "htwlv3.h"
+#include "sensorcodec.h"
+
+#ifndef NODE_ID
+#define NODE_ID 2
+#endif
+
+#define DESTINATION_ID 1
+
+int packetIndex = 0;
+
+void onReceive(LoraDataPacket packet)
+{
+  SensorRecordReader reader((const uint8_t *)packet.data, packet.size);
+  unsigned int senderId;
+
+  if (!reader.begin(senderId))
+  {
+    Board.println("Not a batch of records");
+    return;
+  }
+
+  SensorData data;
+
+  while (reader.next(data))
+    Board.println(String(senderId) + ": " + String(data.nodeId) + "-" + String(data.index) + " " + String(data.temperature) + " C");
+
+  if (reader.failed())
+    Board.println("Malformed batch");
+}
+
+void setup()
+{
+  HTWLV3Config boardConfig = HTWLV3::getDefaultConfig();
+  boardConfig.serialEnable = true;
+  boardConfig.displayEnable = true;
+  boardConfig.loraEnable = true;
+  Board.setConfig(boardConfig);
+
+  Board.lora->setOnReceive(onReceive);
+
+  Board.begin(NODE_ID);
+  Board.lora->listenToPacket();
+}
+
+void loop()
+{
+  // One frame with any header
+  uint8_t batch[HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE];
+  SensorRecordWriter writer(batch, sizeof(batch));
+  writer.begin(NODE_ID);
+
+  // Three readings per batch, `write()` returns false when the frame is full
+  for (int i = 0; i < 3; i++)
+  {
+    SensorData data;
+    data.nodeId = NODE_ID;
+    data.index = packetIndex++;
+    data.temperature = random(200, 300) / 10.0;
+    data.timestamp = millis();
+
+    if (!writer.write(data))
+      break;
+  }
+
+  Board.lora->sendReliablePacket(batch, writer.size(), DESTINATION_ID);
+
+  // Send and receive for 10 seconds
+  unsigned long start = millis();
+  while (millis() - start < 10000)
+    Board.process();
+}
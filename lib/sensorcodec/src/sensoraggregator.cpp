@@ -0,0 +1,231 @@
+/**
+ * @file sensoraggregator.cpp
+ * @brief In-network aggregation of sensor readings at relay nodes
+ *
+ * Description:
+ *
+ * Check `sensoraggregator.h` for the modes and the windows.
+ *
+ * Depends On:
+ * - sensorcodec
+ * - sensorsummary
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensoraggregator.h"
+
+#include <math.h>
+#include <string.h>
+
+SensorAggregator::SensorAggregator()
+    : _config(getDefaultConfig()), _closedHead(0), _closedCount(0)
+{
+  memset(_entries, 0, sizeof(_entries));
+}
+
+SensorAggregatorConfig SensorAggregator::getDefaultConfig()
+{
+  SensorAggregatorConfig config;
+
+  config.mode = SENSORAGGREGATOR_MODE_OFF;
+  config.window = 300000;
+  config.deadband = 0;
+
+  return config;
+}
+
+void SensorAggregator::setConfig(const SensorAggregatorConfig &config)
+{
+  _config = config;
+
+  if (_config.window == 0)
+    _config.window = 1;
+
+  memset(_entries, 0, sizeof(_entries));
+  _closedHead = 0;
+  _closedCount = 0;
+}
+
+SensorAggregatorConfig SensorAggregator::getConfig() const
+{
+  return _config;
+}
+
+bool SensorAggregator::add(const SensorData &data, unsigned long now)
+{
+  if (_config.mode == SENSORAGGREGATOR_MODE_OFF || data.nodeId == 0)
+    return false;
+
+  uint32_t window = (uint32_t)data.timestamp / _config.window;
+  SensorAggregatorEntry *entry = NULL;
+
+  for (int i = 0; i < SENSORAGGREGATOR_MAX_ORIGINS && entry == NULL; i++)
+    if (_entries[i].nodeId == data.nodeId)
+      entry = &_entries[i];
+
+  // Late reading of a window already closed (windows are compared on the wrapping origin clock)
+  if (entry != NULL && ((int32_t)(window - entry->window) < 0 || (!entry->open && window == entry->window)))
+    return false;
+
+  if (_config.mode == SENSORAGGREGATOR_MODE_SUMMARY)
+    return _addSummary(entry, data, window, now);
+
+  return _addDecimate(entry, data, window, now);
+}
+
+bool SensorAggregator::poll(SensorSummary &summary, unsigned long now)
+{
+  if (_config.mode == SENSORAGGREGATOR_MODE_SUMMARY)
+    for (int i = 0; i < SENSORAGGREGATOR_MAX_ORIGINS; i++)
+      if (_entries[i].open && now - _entries[i].opened >= _config.window && !_close(_entries[i]))
+        break;
+
+  if (_closedCount == 0)
+    return false;
+
+  summary = _closed[_closedHead];
+  _closedHead = (_closedHead + 1) % SENSORAGGREGATOR_MAX_CLOSED;
+  _closedCount--;
+
+  return true;
+}
+
+void SensorAggregator::flush()
+{
+  if (_config.mode != SENSORAGGREGATOR_MODE_SUMMARY)
+    return;
+
+  for (int i = 0; i < SENSORAGGREGATOR_MAX_ORIGINS; i++)
+    if (_entries[i].open && !_close(_entries[i]))
+      break;
+}
+
+uint32_t SensorAggregator::getNextDeadline(unsigned long now) const
+{
+  if (_closedCount > 0)
+    return 0;
+
+  uint32_t next = UINT32_MAX;
+
+  if (_config.mode != SENSORAGGREGATOR_MODE_SUMMARY)
+    return next;
+
+  for (int i = 0; i < SENSORAGGREGATOR_MAX_ORIGINS; i++)
+  {
+    if (!_entries[i].open)
+      continue;
+
+    unsigned long elapsed = now - _entries[i].opened;
+    uint32_t remaining = elapsed >= _config.window ? 0 : _config.window - elapsed;
+
+    if (remaining < next)
+      next = remaining;
+  }
+
+  return next;
+}
+
+bool SensorAggregator::_addSummary(SensorAggregatorEntry *entry, const SensorData &data, uint32_t window, unsigned long now)
+{
+  // A later window closes the one of the origin
+  if (entry != NULL && entry->open && entry->window != window && !_close(*entry))
+    return false;
+
+  // The entry of the origin is opened again on its next window
+  if (entry == NULL || !entry->open)
+  {
+    if (entry == NULL)
+      entry = _getFreeEntry();
+
+    if (entry->open && !_close(*entry))
+      return false;
+
+    entry->nodeId = data.nodeId;
+    entry->open = true;
+    entry->window = window;
+    entry->opened = now;
+    entry->sum = 0;
+
+    entry->summary.nodeId = data.nodeId;
+    entry->summary.firstIndex = data.index;
+    entry->summary.lastIndex = data.index;
+    entry->summary.firstTimestamp = data.timestamp;
+    entry->summary.lastTimestamp = data.timestamp;
+    entry->summary.count = 0;
+    entry->summary.minimum = data.temperature;
+    entry->summary.maximum = data.temperature;
+  }
+
+  SensorSummary &summary = entry->summary;
+
+  // Readings may come out of order after a retry, the ranges cover all of them
+  if (data.index - summary.firstIndex < 0)
+    summary.firstIndex = data.index;
+  if (data.index - summary.lastIndex > 0)
+    summary.lastIndex = data.index;
+  if ((long)(data.timestamp - summary.firstTimestamp) < 0)
+    summary.firstTimestamp = data.timestamp;
+  if ((long)(data.timestamp - summary.lastTimestamp) > 0)
+    summary.lastTimestamp = data.timestamp;
+  if (data.temperature < summary.minimum)
+    summary.minimum = data.temperature;
+  if (data.temperature > summary.maximum)
+    summary.maximum = data.temperature;
+
+  summary.count++;
+  entry->sum += data.temperature;
+
+  return true;
+}
+
+bool SensorAggregator::_addDecimate(SensorAggregatorEntry *entry, const SensorData &data, uint32_t window, unsigned long now)
+{
+  if (entry == NULL)
+  {
+    entry = _getFreeEntry();
+    entry->nodeId = data.nodeId;
+    entry->open = true;
+  }
+  else if (entry->window == window && (_config.deadband <= 0 || fabsf(data.temperature - entry->forwarded) < _config.deadband))
+    return true;
+
+  // First reading of the window, or moved past the deadband
+  entry->window = window;
+  entry->opened = now;
+  entry->forwarded = data.temperature;
+
+  return false;
+}
+
+SensorAggregatorEntry *SensorAggregator::_getFreeEntry()
+{
+  SensorAggregatorEntry *oldest = &_entries[0];
+
+  // Entries never used first, then the free one opened first, so the last windows closed are kept the longest
+  for (int i = 0; i < SENSORAGGREGATOR_MAX_ORIGINS; i++)
+  {
+    if (_entries[i].nodeId == 0)
+      return &_entries[i];
+
+    if (_entries[i].open == oldest->open ? (long)(_entries[i].opened - oldest->opened) < 0 : !_entries[i].open)
+      oldest = &_entries[i];
+  }
+
+  return oldest;
+}
+
+bool SensorAggregator::_close(SensorAggregatorEntry &entry)
+{
+  if (_closedCount == SENSORAGGREGATOR_MAX_CLOSED)
+    return false;
+
+  SensorSummary &summary = _closed[(_closedHead + _closedCount) % SENSORAGGREGATOR_MAX_CLOSED];
+  summary = entry.summary;
+  summary.mean = entry.sum / entry.summary.count;
+  _closedCount++;
+
+  entry.open = false;
+  return true;
+}
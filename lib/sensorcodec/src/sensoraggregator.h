@@ -0,0 +1,193 @@
+/**
+ * @file sensoraggregator.h
+ * @brief In-network aggregation of sensor readings at relay nodes
+ *
+ * Description:
+ *
+ * A relay of a chain forwards the readings of every node behind it, so the traffic grows towards the sink.
+ * This stage takes the readings a relay receives and forwards less of them, per origin and per time window:
+ * - Summary mode: the readings of a window are merged in one `SensorSummary` (count, minimum, maximum and mean),
+ *   sent with the codec of `sensorsummary.h` when the window closes.
+ * - Decimate mode: the first reading of a window is forwarded, and the ones that moved more than a deadband
+ *   from the last reading forwarded, the others are dropped.
+ *
+ * Windows are aligned on the origin clock (`timestamp / window`), so the relays of a chain close the same windows.
+ * A window closes one window length (local time) after its first reading, or as soon as a reading of a later window arrives.
+ *
+ * Readings the stage can't take (late readings of a closed window, no free entry) are left to be forwarded as they are,
+ * so nothing is lost by the aggregation. The last window closed of an origin is kept on its entry until the entry is reused,
+ * so a reading retried after its window was summarized doesn't open a second, partial summary of it.
+ *
+ * Depends On:
+ * - sensorcodec
+ * - sensorsummary
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef SENSORAGGREGATOR_H
+#define SENSORAGGREGATOR_H
+
+#include "sensorcodec.h"
+#include "sensorsummary.h"
+
+// Aggregation modes
+#define SENSORAGGREGATOR_MODE_OFF 0
+#define SENSORAGGREGATOR_MODE_SUMMARY 1
+#define SENSORAGGREGATOR_MODE_DECIMATE 2
+
+// Origins aggregated at the same time
+#define SENSORAGGREGATOR_MAX_ORIGINS 32
+
+// Closed summaries waiting for `poll()`
+#define SENSORAGGREGATOR_MAX_CLOSED 16
+
+/**
+ * @brief Aggregation configuration
+ */
+typedef struct
+{
+  // Mode - [SENSORAGGREGATOR_MODE_OFF: forward every reading, SENSORAGGREGATOR_MODE_SUMMARY, SENSORAGGREGATOR_MODE_DECIMATE]
+  int mode;
+  // Window - ms - Per origin, aligned on the origin clock
+  unsigned long window;
+  // Deadband - °C - Decimate mode: readings that moved this much from the last one forwarded are forwarded too - [0: off]
+  float deadband;
+} SensorAggregatorConfig;
+
+/**
+ * @brief Window of an origin being aggregated
+ */
+typedef struct
+{
+  // Origin node ID [0: never used]
+  int nodeId;
+  // Window being aggregated [false: free entry, `nodeId` and `window` are of the last window closed]
+  bool open;
+  // Window of the origin clock (timestamp / window)
+  uint32_t window;
+  // Millis timestamp when the window got its first reading
+  unsigned long opened;
+  // Summary mode: summary of the window so far, and the sum of its temperatures
+  SensorSummary summary;
+  float sum;
+  // Decimate mode: temperature of the last reading forwarded
+  float forwarded;
+} SensorAggregatorEntry;
+
+/**
+ * @brief Aggregation stage of the readings received by a relay
+ */
+class SensorAggregator
+{
+public:
+  /**
+   * @brief Construct a new Sensor Aggregator, with the default configuration
+   */
+  SensorAggregator();
+
+  /**
+   * @brief Get the default configuration
+   *
+   * @return SensorAggregatorConfig Default configuration (aggregation off, 5 minute windows, no deadband)
+   */
+  static SensorAggregatorConfig getDefaultConfig();
+
+  /**
+   * @brief Set the configuration
+   *
+   * @note Discards the windows being aggregated, call it before adding readings
+   *
+   * @param config Configuration
+   */
+  void setConfig(const SensorAggregatorConfig &config);
+
+  /**
+   * @brief Get the configuration
+   *
+   * @return SensorAggregatorConfig Configuration
+   */
+  SensorAggregatorConfig getConfig() const;
+
+  /**
+   * @brief Add a received reading to the stage
+   *
+   * @note Call `poll()` after adding readings, a reading of a later window closes the previous one
+   *
+   * @param data Reading received
+   * @param now Millis timestamp
+   * @return bool Taken, merged in a summary or dropped by the decimation [false: forward the reading as is]
+   */
+  bool add(const SensorData &data, unsigned long now);
+
+  /**
+   * @brief Get the next closed summary, closing the windows that are over
+   *
+   * @param summary Summary to forward
+   * @param now Millis timestamp
+   * @return bool Summary closed [false: none]
+   */
+  bool poll(SensorSummary &summary, unsigned long now);
+
+  /**
+   * @brief Close every window, so their summaries are returned by `poll()`
+   */
+  void flush();
+
+  /**
+   * @brief Get the time until the next window closes
+   *
+   * @param now Millis timestamp
+   * @return uint32_t Time to wait - ms [0: summaries to poll, UINT32_MAX: no window open]
+   */
+  uint32_t getNextDeadline(unsigned long now) const;
+
+private:
+  SensorAggregatorConfig _config;
+  SensorAggregatorEntry _entries[SENSORAGGREGATOR_MAX_ORIGINS];
+
+  // Closed summaries, a ring
+  SensorSummary _closed[SENSORAGGREGATOR_MAX_CLOSED];
+  int _closedHead;
+  int _closedCount;
+
+  /**
+   * @brief Add a reading in summary mode
+   *
+   * @param entry Entry of the origin [NULL: no entry yet]
+   * @param data Reading
+   * @param window Window of the reading
+   * @param now Millis timestamp
+   * @return bool Merged in a summary [false: forward the reading as is]
+   */
+  bool _addSummary(SensorAggregatorEntry *entry, const SensorData &data, uint32_t window, unsigned long now);
+
+  /**
+   * @brief Add a reading in decimate mode
+   *
+   * @param entry Entry of the origin [NULL: no entry yet]
+   * @param data Reading
+   * @param window Window of the reading
+   * @param now Millis timestamp
+   * @return bool Dropped [false: forward the reading as is]
+   */
+  bool _addDecimate(SensorAggregatorEntry *entry, const SensorData &data, uint32_t window, unsigned long now);
+
+  /**
+   * @brief Get a free entry (one never used first), or the one opened first when all are in use
+   *
+   * @return SensorAggregatorEntry* Entry to reuse
+   */
+  SensorAggregatorEntry *_getFreeEntry();
+
+  /**
+   * @brief Move the summary of an entry to the closed summaries and free the entry, keeping its origin and window
+   *
+   * @param entry Entry to close
+   * @return bool Closed [false: too many closed summaries waiting for `poll()`]
+   */
+  bool _close(SensorAggregatorEntry &entry);
+};
+
+#endif
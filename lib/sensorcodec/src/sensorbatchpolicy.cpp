@@ -0,0 +1,136 @@
+/**
+ * @file sensorbatchpolicy.cpp
+ * @brief Flush policy of the batches of sensor readings sent over LoRa
+ *
+ * Description:
+ *
+ * Check `sensorbatchpolicy.h` for the flush conditions.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensorbatchpolicy.h"
+
+SensorBatchPolicy::SensorBatchPolicy()
+    : _config(getDefaultConfig()), _waiting(false), _oldest(0), _urgent(false), _held(0)
+{
+  resetMetrics();
+}
+
+SensorBatchPolicyConfig SensorBatchPolicy::getDefaultConfig()
+{
+  SensorBatchPolicyConfig config;
+
+  config.maxPayload = SENSORBATCHPOLICY_DEFAULT_PAYLOAD;
+  config.maxAge = 60000;
+  config.minRecords = 0;
+
+  return config;
+}
+
+void SensorBatchPolicy::setConfig(const SensorBatchPolicyConfig &config)
+{
+  _config = config;
+
+  if (_config.maxPayload == 0)
+    _config.maxPayload = SENSORBATCHPOLICY_DEFAULT_PAYLOAD;
+}
+
+SensorBatchPolicyConfig SensorBatchPolicy::getConfig() const
+{
+  return _config;
+}
+
+void SensorBatchPolicy::add(unsigned long now, bool urgent)
+{
+  if (!_waiting)
+  {
+    _waiting = true;
+    _oldest = now;
+  }
+
+  if (urgent)
+    _urgent = true;
+}
+
+bool SensorBatchPolicy::check(unsigned int pending, unsigned long now)
+{
+  if (pending == 0)
+  {
+    _waiting = false;
+    _urgent = false;
+    _held = 0;
+    return false;
+  }
+
+  // Readings queued without `add()` are waiting from now on
+  if (!_waiting)
+    add(now);
+
+  // A batch put back to wait is packed again only with more readings, or when it becomes due
+  return _isDue(now) || pending != _held || (_config.minRecords > 0 && pending >= _config.minRecords);
+}
+
+bool SensorBatchPolicy::shouldSend(size_t size, unsigned int records, bool full, unsigned long now)
+{
+  if (records == 0)
+    return false;
+
+  if (full || size >= _config.maxPayload || _isDue(now) || (_config.minRecords > 0 && records >= _config.minRecords))
+    return true;
+
+  _held = records;
+  return false;
+}
+
+void SensorBatchPolicy::sent(size_t size, unsigned int records, unsigned int remaining, unsigned long now)
+{
+  _metrics.batches++;
+  _metrics.records += records;
+  _metrics.bytes += size;
+  _metrics.capacity += _config.maxPayload;
+
+  _held = 0;
+  _urgent = false;
+
+  // The age and urgency were of the batch sent, the readings left would go out at once under-filled
+  _waiting = remaining > 0;
+  _oldest = now;
+}
+
+uint32_t SensorBatchPolicy::getNextDeadline(unsigned long now) const
+{
+  if (!_waiting)
+    return UINT32_MAX;
+
+  if (_isDue(now))
+    return 0;
+
+  return _config.maxAge - (now - _oldest);
+}
+
+SensorBatchMetrics SensorBatchPolicy::getMetrics() const
+{
+  SensorBatchMetrics metrics = _metrics;
+  metrics.fillRatio = metrics.capacity > 0 ? (float)metrics.bytes / metrics.capacity : 0;
+
+  return metrics;
+}
+
+void SensorBatchPolicy::resetMetrics()
+{
+  _metrics.batches = 0;
+  _metrics.records = 0;
+  _metrics.bytes = 0;
+  _metrics.capacity = 0;
+  _metrics.fillRatio = 0;
+}
+
+bool SensorBatchPolicy::_isDue(unsigned long now) const
+{
+  return _waiting && (_urgent || now - _oldest >= _config.maxAge);
+}
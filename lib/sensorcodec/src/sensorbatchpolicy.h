@@ -0,0 +1,177 @@
+/**
+ * @file sensorbatchpolicy.h
+ * @brief Flush policy of the batches of sensor readings sent over LoRa
+ *
+ * Description:
+ *
+ * Every frame pays a fixed preamble and header, so sending the readings the moment they are queued (one or ten)
+ * spends most of the air time on overhead. This policy holds the readings until a batch is worth sending:
+ * - Full: the next reading would overflow the payload budget (`maxPayload`, at most the radio MTU)
+ * - Old: the oldest reading waiting is `maxAge` old, so no reading waits much longer than that
+ * - Enough: `minRecords` readings are waiting, when set
+ * - Urgent: a reading added as urgent is sent with the batch at once
+ *
+ * The caller keeps the readings (queue, log...) and packs the batch, the policy only tracks how long they have been waiting
+ * and decides if the packed batch goes out or waits for more readings. It also counts how full the batches sent are.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef SENSORBATCHPOLICY_H
+#define SENSORBATCHPOLICY_H
+
+#include "sensorcodec.h"
+
+// Default payload budget - bytes - HTLORAV3 frame (255) minus its largest header (11)
+#define SENSORBATCHPOLICY_DEFAULT_PAYLOAD 244
+
+/**
+ * @brief Flush policy configuration
+ */
+typedef struct
+{
+  // Max payload - bytes - Budget of a batch, at most the radio MTU minus the link header
+  size_t maxPayload;
+  // Max age - ms - Time the oldest reading waits before a batch that isn't full is sent [0: send at once]
+  unsigned long maxAge;
+  // Min records - Readings that make a batch worth sending before it is full [0: off]
+  unsigned int minRecords;
+} SensorBatchPolicyConfig;
+
+/**
+ * @brief Batches sent, counted since the start or the last `resetMetrics()`
+ */
+typedef struct
+{
+  // Batches sent
+  uint32_t batches;
+  // Readings sent in the batches
+  uint32_t records;
+  // Payload sent - bytes
+  uint32_t bytes;
+  // Payload budget of the batches sent (`maxPayload` each) - bytes
+  uint32_t capacity;
+  // Fill ratio, bytes sent over their budget - [0-1]
+  float fillRatio;
+} SensorBatchMetrics;
+
+/**
+ * @brief Flush policy of the readings waiting to be sent
+ */
+class SensorBatchPolicy
+{
+public:
+  /**
+   * @brief Construct a new Sensor Batch Policy, with the default configuration
+   */
+  SensorBatchPolicy();
+
+  /**
+   * @brief Get the default configuration
+   *
+   * @return SensorBatchPolicyConfig Default configuration (`SENSORBATCHPOLICY_DEFAULT_PAYLOAD` bytes, 1 minute, no min records)
+   */
+  static SensorBatchPolicyConfig getDefaultConfig();
+
+  /**
+   * @brief Set the configuration
+   *
+   * @param config Configuration
+   */
+  void setConfig(const SensorBatchPolicyConfig &config);
+
+  /**
+   * @brief Get the configuration
+   *
+   * @return SensorBatchPolicyConfig Configuration
+   */
+  SensorBatchPolicyConfig getConfig() const;
+
+  /**
+   * @brief Tell the policy readings were queued to be sent (or queued again after a failed batch)
+   *
+   * @param now Millis timestamp
+   * @param urgent Send them at once, without waiting for a full batch
+   */
+  void add(unsigned long now, bool urgent = false);
+
+  /**
+   * @brief Check if a batch should be packed
+   *
+   * @note Forgets the age of the readings when none is waiting (lost or sent some other way)
+   *
+   * @param pending Readings waiting to be sent
+   * @param now Millis timestamp
+   * @return bool Pack a batch and ask `shouldSend()` [false: keep waiting]
+   */
+  bool check(unsigned int pending, unsigned long now);
+
+  /**
+   * @brief Decide if a packed batch is sent or waits for more readings
+   *
+   * @note When it waits, `check()` is false until more readings are queued or the oldest gets too old
+   *
+   * @param size Batch size - bytes
+   * @param records Readings in the batch
+   * @param full The next reading waiting doesn't fit in the batch
+   * @param now Millis timestamp
+   * @return bool Send the batch [false: put its readings back]
+   */
+  bool shouldSend(size_t size, unsigned int records, bool full, unsigned long now);
+
+  /**
+   * @brief Tell the policy a batch was sent, counting it on the metrics
+   *
+   * @param size Batch size - bytes
+   * @param records Readings in the batch
+   * @param remaining Readings still waiting, they wait from now on as a new batch (not urgent)
+   * @param now Millis timestamp
+   */
+  void sent(size_t size, unsigned int records, unsigned int remaining, unsigned long now);
+
+  /**
+   * @brief Get the time until the oldest reading waiting is too old
+   *
+   * @param now Millis timestamp
+   * @return uint32_t Time to wait - ms [0: due now, UINT32_MAX: no reading waiting]
+   */
+  uint32_t getNextDeadline(unsigned long now) const;
+
+  /**
+   * @brief Get the metrics of the batches sent
+   *
+   * @return SensorBatchMetrics Metrics, with the fill ratio
+   */
+  SensorBatchMetrics getMetrics() const;
+
+  /**
+   * @brief Reset the metrics of the batches sent
+   */
+  void resetMetrics();
+
+private:
+  SensorBatchPolicyConfig _config;
+  SensorBatchMetrics _metrics;
+
+  // Readings waiting since `_oldest`
+  bool _waiting;
+  unsigned long _oldest;
+  bool _urgent;
+
+  // Readings of the last batch put back to wait [0: none]
+  unsigned int _held;
+
+  /**
+   * @brief Check if the readings waiting are due, urgent or too old
+   *
+   * @param now Millis timestamp
+   * @return bool Due
+   */
+  bool _isDue(unsigned long now) const;
+};
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file sensorcodec.cpp
+ * @brief Compact binary codec for sensor readings sent over LoRa
+ *
+ * Description:
+ *
+ * This library encodes batches of sensor readings straight into the radio buffer, without an intermediate document.
+ * Check `sensorcodec.h` for the format.
+ *
+ * Depends On:
+ * - stdint.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensorcodec.h"
+
+#include <math.h>
+
+/**
+ * @brief Write a varint
+ *
+ * @param buffer Buffer to write to
+ * @param position Position to write at, moved past the varint
+ * @param capacity Buffer size - bytes
+ * @param value Value to write
+ * @return bool Written [false: buffer too small]
+ */
+static bool _writeVarint(uint8_t *buffer, size_t &position, size_t capacity, uint32_t value)
+{
+  do
+  {
+    if (position >= capacity)
+      return false;
+
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    buffer[position++] = value != 0 ? byte | 0x80 : byte;
+  } while (value != 0);
+
+  return true;
+}
+
+/**
+ * @brief Read a varint
+ *
+ * @param buffer Buffer to read from
+ * @param position Position to read at, moved past the varint
+ * @param size Buffer size - bytes
+ * @param value Value read
+ * @return bool Read [false: truncated or longer than 32 bits]
+ */
+static bool _readVarint(const uint8_t *buffer, size_t &position, size_t size, uint32_t &value)
+{
+  value = 0;
+
+  for (int shift = 0; shift < 7 * SENSORCODEC_MAX_VARINT_SIZE; shift += 7)
+  {
+    if (position >= size)
+      return false;
+
+    uint8_t byte = buffer[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+static uint32_t _zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t _unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+SensorRecordWriter::SensorRecordWriter(uint8_t *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _size(0), _count(0), _lastTimestamp(0)
+{
+}
+
+bool SensorRecordWriter::begin(unsigned int senderId)
+{
+  _size = 0;
+  _count = 0;
+  _lastTimestamp = 0;
+
+  if (_capacity < 1)
+    return false;
+
+  size_t position = 0;
+  _buffer[position++] = SENSORCODEC_FORMAT_RECORDS;
+
+  if (!_writeVarint(_buffer, position, _capacity, senderId))
+    return false;
+
+  _size = position;
+  return true;
+}
+
+bool SensorRecordWriter::write(const SensorData &data)
+{
+  if (_size == 0)
+    return false;
+
+  // Fixed point, rounded and clamped to the int16 range
+  float centi = roundf(data.temperature * 100);
+  int16_t temperature = centi > INT16_MAX ? INT16_MAX : centi < INT16_MIN ? INT16_MIN : (int16_t)centi;
+
+  uint32_t timestamp = (uint32_t)data.timestamp;
+  int32_t delta = (int32_t)(timestamp - (uint32_t)_lastTimestamp);
+
+  // Written past the batch, only kept if the whole record fits
+  size_t position = _size;
+
+  if (!_writeVarint(_buffer, position, _capacity, (uint32_t)data.nodeId) ||
+      !_writeVarint(_buffer, position, _capacity, (uint32_t)data.index) ||
+      position + 2 > _capacity)
+    return false;
+
+  _buffer[position++] = (uint16_t)temperature & 0xFF;
+  _buffer[position++] = (uint16_t)temperature >> 8;
+
+  if (!_writeVarint(_buffer, position, _capacity, _zigzag(delta)))
+    return false;
+
+  _size = position;
+  _count++;
+  _lastTimestamp = timestamp;
+
+  return true;
+}
+
+size_t SensorRecordWriter::size() const
+{
+  return _size;
+}
+
+unsigned int SensorRecordWriter::count() const
+{
+  return _count;
+}
+
+SensorRecordReader::SensorRecordReader(const uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _position(0), _failed(false), _lastTimestamp(0)
+{
+}
+
+bool SensorRecordReader::begin(unsigned int &senderId)
+{
+  _position = 0;
+  _failed = false;
+  _lastTimestamp = 0;
+
+  uint32_t value;
+
+  if (_size < 1 || _buffer[0] != SENSORCODEC_FORMAT_RECORDS)
+  {
+    _failed = true;
+    return false;
+  }
+
+  _position = 1;
+
+  if (!_readVarint(_buffer, _position, _size, value))
+  {
+    _failed = true;
+    return false;
+  }
+
+  senderId = value;
+  return true;
+}
+
+bool SensorRecordReader::next(SensorData &data)
+{
+  if (_failed || _position == 0 || _position >= _size)
+    return false;
+
+  uint32_t nodeId, index, delta;
+
+  if (!_readVarint(_buffer, _position, _size, nodeId) ||
+      !_readVarint(_buffer, _position, _size, index) ||
+      _position + 2 > _size)
+  {
+    _failed = true;
+    return false;
+  }
+
+  int16_t temperature = (int16_t)(_buffer[_position] | (_buffer[_position + 1] << 8));
+  _position += 2;
+
+  if (!_readVarint(_buffer, _position, _size, delta))
+  {
+    _failed = true;
+    return false;
+  }
+
+  _lastTimestamp = (uint32_t)(_lastTimestamp + _unzigzag(delta));
+
+  data.nodeId = nodeId;
+  data.index = index;
+  data.temperature = temperature / 100.0f;
+  data.timestamp = _lastTimestamp;
+
+  return true;
+}
+
+bool SensorRecordReader::failed() const
+{
+  return _failed;
+}
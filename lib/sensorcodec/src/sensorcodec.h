@@ -0,0 +1,165 @@
+/**
+ * @file sensorcodec.h
+ * @brief Compact binary codec for sensor readings sent over LoRa
+ *
+ * Description:
+ *
+ * This library encodes batches of sensor readings straight into the radio buffer, without an intermediate document.
+ * A record takes 5 to 12 bytes instead of the ~70 bytes of its JSON text.
+ * Batches of readings of a few origins are smaller with the columnar series codec of `sensorseries.h`.
+ *
+ * Format (batch of records):
+ * - Format marker: 1 byte (`SENSORCODEC_FORMAT_RECORDS`, never zero, so the batch is a valid HTLORAV3 payload)
+ * - Sender node ID: varint
+ * - Records, until the end of the buffer:
+ *   - Node ID: varint
+ *   - Index: varint
+ *   - Temperature: int16 little endian - 1/100 °C (clamped to [-327.68, 327.67])
+ *   - Timestamp: zigzag varint - ms - delta from the previous record timestamp (from 0 on the first record)
+ *
+ * Varints are unsigned LEB128: 7 bits per byte, least significant group first, high bit set on all but the last byte.
+ *
+ * Depends On:
+ * - stdint.h
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef SENSORCODEC_H
+#define SENSORCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Marker of a batch of records - first byte of the payload
+#define SENSORCODEC_FORMAT_RECORDS 0xB1
+
+// Size of a varint of 32 bits - bytes
+#define SENSORCODEC_MAX_VARINT_SIZE 5
+
+// Size of the batch header - bytes
+#define SENSORCODEC_MAX_HEADER_SIZE (1 + SENSORCODEC_MAX_VARINT_SIZE)
+
+// Size of a record - bytes
+#define SENSORCODEC_MAX_RECORD_SIZE (3 * SENSORCODEC_MAX_VARINT_SIZE + 2)
+
+/**
+ * @brief Sensor reading
+ */
+typedef struct dataPacket
+{
+  int index;
+  int nodeId;
+  float temperature;
+  unsigned long timestamp;
+} SensorData;
+
+/**
+ * @brief Streaming encoder of a batch of records into a buffer
+ *
+ * @note Nothing is allocated, the records are written straight into the given buffer.
+ */
+class SensorRecordWriter
+{
+public:
+  /**
+   * @brief Construct a new Sensor Record Writer
+   *
+   * @param buffer Buffer where the batch is written
+   * @param capacity Buffer size - bytes
+   */
+  SensorRecordWriter(uint8_t *buffer, size_t capacity);
+
+  /**
+   * @brief Start a batch, writing its header
+   *
+   * @note Discards the records written before
+   *
+   * @param senderId Node ID of the node sending the batch
+   * @return bool Header written [false: buffer too small]
+   */
+  bool begin(unsigned int senderId);
+
+  /**
+   * @brief Append a record to the batch
+   *
+   * @note The batch is left unchanged if the record doesn't fit, so it can be sent as is
+   *
+   * @param data Reading to append
+   * @return bool Record written [false: buffer full or batch not started]
+   */
+  bool write(const SensorData &data);
+
+  /**
+   * @brief Get the size of the batch
+   *
+   * @return size_t Batch size - bytes
+   */
+  size_t size() const;
+
+  /**
+   * @brief Get the number of records in the batch
+   *
+   * @return unsigned int Record count
+   */
+  unsigned int count() const;
+
+private:
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _size;
+  unsigned int _count;
+  // Timestamp of the last record written, deltas are taken from it
+  unsigned long _lastTimestamp;
+};
+
+/**
+ * @brief Streaming decoder of a batch of records from a buffer
+ *
+ * @note Nothing is allocated or copied, the records are read straight from the given buffer.
+ */
+class SensorRecordReader
+{
+public:
+  /**
+   * @brief Construct a new Sensor Record Reader
+   *
+   * @param buffer Buffer holding the batch
+   * @param size Batch size - bytes
+   */
+  SensorRecordReader(const uint8_t *buffer, size_t size);
+
+  /**
+   * @brief Start reading the batch, reading its header
+   *
+   * @param senderId Node ID of the node that sent the batch
+   * @return bool Header read [false: not a batch of records]
+   */
+  bool begin(unsigned int &senderId);
+
+  /**
+   * @brief Read the next record of the batch
+   *
+   * @param data Reading read
+   * @return bool Record read [false: end of the batch or malformed record]
+   */
+  bool next(SensorData &data);
+
+  /**
+   * @brief Check if the batch was malformed
+   *
+   * @return bool Malformed batch (the records read before are valid)
+   */
+  bool failed() const;
+
+private:
+  const uint8_t *_buffer;
+  size_t _size;
+  size_t _position;
+  bool _failed;
+  // Timestamp of the last record read, deltas are added to it
+  unsigned long _lastTimestamp;
+};
+
+#endif
@@ -0,0 +1,581 @@
+/**
+ * @file sensorseries.cpp
+ * @brief Columnar time-series codec for batches of sensor readings from the same origins
+ *
+ * Description:
+ *
+ * This codec writes the readings of each origin as a series, one column per field, each value compressed against the previous one.
+ * Check `sensorseries.h` for the format.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensorseries.h"
+
+#include <string.h>
+
+/**
+ * @brief Write bits, most significant first
+ *
+ * @param buffer Buffer to write to
+ * @param capacity Buffer size - bytes
+ * @param bit Position to write at, moved past the bits - bits
+ * @param value Value holding the bits in its lower part
+ * @param count Number of bits [0..32]
+ * @return bool Written [false: buffer too small]
+ */
+static bool _writeBits(uint8_t *buffer, size_t capacity, size_t &bit, uint32_t value, int count)
+{
+  if (bit + count > capacity * 8)
+    return false;
+
+  while (count > 0)
+  {
+    int offset = bit & 7;
+    int chunk = 8 - offset < count ? 8 - offset : count;
+
+    if (offset == 0)
+      buffer[bit >> 3] = 0;
+
+    count -= chunk;
+    buffer[bit >> 3] |= ((value >> count) & ((1u << chunk) - 1)) << (8 - offset - chunk);
+    bit += chunk;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Read bits, most significant first
+ *
+ * @param buffer Buffer to read from
+ * @param size Buffer size - bytes
+ * @param bit Position to read at, moved past the bits - bits
+ * @param value Value read
+ * @param count Number of bits [0..32]
+ * @return bool Read [false: truncated]
+ */
+static bool _readBits(const uint8_t *buffer, size_t size, size_t &bit, uint32_t &value, int count)
+{
+  if (bit + count > size * 8)
+    return false;
+
+  value = 0;
+
+  while (count > 0)
+  {
+    int offset = bit & 7;
+    int chunk = 8 - offset < count ? 8 - offset : count;
+
+    value = (value << chunk) | ((buffer[bit >> 3] >> (8 - offset - chunk)) & ((1u << chunk) - 1));
+    count -= chunk;
+    bit += chunk;
+  }
+
+  return true;
+}
+
+static bool _writeVarint(uint8_t *buffer, size_t capacity, size_t &bit, uint32_t value)
+{
+  do
+  {
+    uint32_t byte = value & 0x7F;
+    value >>= 7;
+
+    if (!_writeBits(buffer, capacity, bit, value != 0 ? byte | 0x80 : byte, 8))
+      return false;
+  } while (value != 0);
+
+  return true;
+}
+
+static bool _readVarint(const uint8_t *buffer, size_t size, size_t &bit, uint32_t &value)
+{
+  value = 0;
+
+  for (int shift = 0; shift < 7 * SENSORCODEC_MAX_VARINT_SIZE; shift += 7)
+  {
+    uint32_t byte;
+
+    if (!_readBits(buffer, size, bit, byte, 8))
+      return false;
+
+    value |= (byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+static uint32_t _zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t _unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**
+ * @brief Write a signed value with the smallest prefix and width that hold it
+ */
+static bool _writeSigned(uint8_t *buffer, size_t capacity, size_t &bit, int32_t value)
+{
+  uint32_t zigzag = _zigzag(value);
+
+  if (zigzag == 0)
+    return _writeBits(buffer, capacity, bit, 0x0, 1);
+  if (zigzag < (1u << 7))
+    return _writeBits(buffer, capacity, bit, 0x2, 2) && _writeBits(buffer, capacity, bit, zigzag, 7);
+  if (zigzag < (1u << 9))
+    return _writeBits(buffer, capacity, bit, 0x6, 3) && _writeBits(buffer, capacity, bit, zigzag, 9);
+  if (zigzag < (1u << 12))
+    return _writeBits(buffer, capacity, bit, 0xE, 4) && _writeBits(buffer, capacity, bit, zigzag, 12);
+
+  return _writeBits(buffer, capacity, bit, 0xF, 4) && _writeBits(buffer, capacity, bit, zigzag, 32);
+}
+
+static bool _readSigned(const uint8_t *buffer, size_t size, size_t &bit, int32_t &value)
+{
+  static const int widths[] = {7, 9, 12, 32};
+
+  uint32_t flag, zigzag = 0;
+  int prefix = 0;
+
+  // Count the ones of the prefix, up to 4
+  while (prefix < 4)
+  {
+    if (!_readBits(buffer, size, bit, flag, 1))
+      return false;
+
+    if (flag == 0)
+      break;
+
+    prefix++;
+  }
+
+  if (prefix > 0 && !_readBits(buffer, size, bit, zigzag, widths[prefix - 1]))
+    return false;
+
+  value = _unzigzag(zigzag);
+  return true;
+}
+
+/**
+ * @brief Get the size of a signed value
+ *
+ * @return int Size - bits
+ */
+static int _signedBits(int32_t value)
+{
+  uint32_t zigzag = _zigzag(value);
+
+  if (zigzag == 0)
+    return 1;
+  if (zigzag < (1u << 7))
+    return 2 + 7;
+  if (zigzag < (1u << 9))
+    return 3 + 9;
+  if (zigzag < (1u << 12))
+    return 4 + 12;
+
+  return 4 + 32;
+}
+
+static int _varintBits(uint32_t value)
+{
+  int bits = 8;
+
+  while ((value >>= 7) != 0)
+    bits += 8;
+
+  return bits;
+}
+
+static uint32_t _floatBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float _bitsFloat(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+SensorSeriesWriter::SensorSeriesWriter(uint8_t *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _size(0), _count(0)
+{
+}
+
+bool SensorSeriesWriter::begin(unsigned int senderId)
+{
+  _size = 0;
+  _count = 0;
+
+  size_t bit = 0;
+
+  if (!_writeBits(_buffer, _capacity, bit, SENSORCODEC_FORMAT_SERIES, 8) || !_writeVarint(_buffer, _capacity, bit, senderId))
+    return false;
+
+  _size = bit / 8;
+  return true;
+}
+
+unsigned int SensorSeriesWriter::write(const SensorData *records, unsigned int count)
+{
+  if (_size == 0 || count == 0)
+    return 0;
+
+  // Sized first, the columns of a series that doesn't fit would be written past the end of the buffer before failing
+  size_t size;
+  count = _fitSeries(records, count);
+
+  if (count == 0 || !_writeSeries(records, count, size))
+    return 0;
+
+  _size = size;
+  _count += count;
+
+  return count;
+}
+
+unsigned int SensorSeriesWriter::_fitSeries(const SensorData *records, unsigned int count)
+{
+  size_t available = (_capacity - _size) * 8;
+
+  // Sizes of the columns grow reading by reading, only the count in the header changes with the prefix
+  size_t bits = _varintBits((uint32_t)records[0].nodeId) + _varintBits((uint32_t)records[0].index) + _varintBits((uint32_t)records[0].timestamp) + 32;
+  int32_t delta = 0;
+  uint32_t temperature = _floatBits(records[0].temperature);
+  int leading = -1, trailing = 0;
+
+  for (unsigned int i = 0; i < count; i++)
+  {
+    if (i > 0)
+    {
+      int32_t nextDelta = (int32_t)((uint32_t)records[i].timestamp - (uint32_t)records[i - 1].timestamp);
+
+      bits += _signedBits((int32_t)((uint32_t)records[i].index - (uint32_t)records[i - 1].index - 1));
+      bits += i == 1 ? _varintBits(_zigzag(nextDelta)) : _signedBits((int32_t)((uint32_t)nextDelta - (uint32_t)delta));
+      delta = nextDelta;
+
+      uint32_t next = _floatBits(records[i].temperature);
+      uint32_t xored = next ^ temperature;
+      temperature = next;
+
+      if (xored == 0)
+        bits += 1;
+      else if (leading >= 0 && __builtin_clz(xored) >= leading && __builtin_ctz(xored) >= trailing)
+        bits += 2 + 32 - leading - trailing;
+      else
+      {
+        leading = __builtin_clz(xored);
+        trailing = __builtin_ctz(xored);
+        bits += 2 + 5 + 5 + 32 - leading - trailing;
+      }
+    }
+
+    // Rounded up to the byte where the next series starts
+    if ((bits + _varintBits(i + 1) + 7) / 8 * 8 > available)
+      return i;
+  }
+
+  return count;
+}
+
+bool SensorSeriesWriter::_writeSeries(const SensorData *records, unsigned int count, size_t &size)
+{
+  size_t bit = _size * 8;
+
+  uint32_t index = (uint32_t)records[0].index;
+  uint32_t timestamp = (uint32_t)records[0].timestamp;
+  int32_t delta = count > 1 ? (int32_t)((uint32_t)records[1].timestamp - timestamp) : 0;
+
+  if (!_writeVarint(_buffer, _capacity, bit, (uint32_t)records[0].nodeId) ||
+      !_writeVarint(_buffer, _capacity, bit, count) ||
+      !_writeVarint(_buffer, _capacity, bit, index) ||
+      !_writeVarint(_buffer, _capacity, bit, timestamp) ||
+      (count > 1 && !_writeVarint(_buffer, _capacity, bit, _zigzag(delta))))
+    return false;
+
+  // Index column
+  for (unsigned int i = 1; i < count; i++)
+  {
+    uint32_t next = (uint32_t)records[i].index;
+
+    if (!_writeSigned(_buffer, _capacity, bit, (int32_t)(next - index - 1)))
+      return false;
+
+    index = next;
+  }
+
+  // Timestamp column, the first delta is in the header
+  timestamp = count > 1 ? (uint32_t)records[1].timestamp : timestamp;
+
+  for (unsigned int i = 2; i < count; i++)
+  {
+    uint32_t next = (uint32_t)records[i].timestamp;
+    int32_t nextDelta = (int32_t)(next - timestamp);
+
+    if (!_writeSigned(_buffer, _capacity, bit, (int32_t)((uint32_t)nextDelta - (uint32_t)delta)))
+      return false;
+
+    timestamp = next;
+    delta = nextDelta;
+  }
+
+  // Temperature column
+  uint32_t temperature = _floatBits(records[0].temperature);
+  int leading = -1, trailing = 0;
+
+  if (!_writeBits(_buffer, _capacity, bit, temperature, 32))
+    return false;
+
+  for (unsigned int i = 1; i < count; i++)
+  {
+    uint32_t next = _floatBits(records[i].temperature);
+    uint32_t xored = next ^ temperature;
+    temperature = next;
+
+    if (xored == 0)
+    {
+      if (!_writeBits(_buffer, _capacity, bit, 0x0, 1))
+        return false;
+      continue;
+    }
+
+    int nextLeading = __builtin_clz(xored);
+    int nextTrailing = __builtin_ctz(xored);
+
+    // Inside the previous window, only the meaningful bits are written
+    if (leading >= 0 && nextLeading >= leading && nextTrailing >= trailing)
+    {
+      if (!_writeBits(_buffer, _capacity, bit, 0x2, 2) ||
+          !_writeBits(_buffer, _capacity, bit, xored >> trailing, 32 - leading - trailing))
+        return false;
+      continue;
+    }
+
+    leading = nextLeading;
+    trailing = nextTrailing;
+    int meaningful = 32 - leading - trailing;
+
+    if (!_writeBits(_buffer, _capacity, bit, 0x3, 2) ||
+        !_writeBits(_buffer, _capacity, bit, leading, 5) ||
+        !_writeBits(_buffer, _capacity, bit, meaningful - 1, 5) ||
+        !_writeBits(_buffer, _capacity, bit, xored >> trailing, meaningful))
+      return false;
+  }
+
+  size = (bit + 7) / 8;
+  return true;
+}
+
+size_t SensorSeriesWriter::size() const
+{
+  return _size;
+}
+
+unsigned int SensorSeriesWriter::count() const
+{
+  return _count;
+}
+
+SensorSeriesReader::SensorSeriesReader(const uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _next(0), _failed(false), _nodeId(0), _remaining(0), _position(0),
+      _indexBit(0), _timestampBit(0), _temperatureBit(0), _index(0), _timestamp(0), _delta(0), _temperature(0), _leading(0), _trailing(0)
+{
+}
+
+bool SensorSeriesReader::begin(unsigned int &senderId)
+{
+  _next = 0;
+  _remaining = 0;
+  _failed = false;
+
+  size_t bit = 0;
+  uint32_t value;
+
+  if (_size < 1 || _buffer[0] != SENSORCODEC_FORMAT_SERIES)
+  {
+    _failed = true;
+    return false;
+  }
+
+  bit = 8;
+
+  if (!_readVarint(_buffer, _size, bit, value))
+  {
+    _failed = true;
+    return false;
+  }
+
+  senderId = value;
+  _next = bit / 8;
+  return true;
+}
+
+bool SensorSeriesReader::_beginSeries()
+{
+  size_t bit = _next * 8;
+  uint32_t nodeId, count, delta = 0;
+  int32_t skipped;
+
+  if (!_readVarint(_buffer, _size, bit, nodeId) ||
+      !_readVarint(_buffer, _size, bit, count) ||
+      !_readVarint(_buffer, _size, bit, _index) ||
+      !_readVarint(_buffer, _size, bit, _timestamp) ||
+      (count > 1 && !_readVarint(_buffer, _size, bit, delta)) ||
+      count == 0)
+    return false;
+
+  _nodeId = nodeId;
+  _remaining = count;
+  _position = 0;
+  _delta = _unzigzag(delta);
+
+  // The columns follow each other, the index and timestamp ones are skipped to find where the next starts
+  _indexBit = bit;
+
+  for (uint32_t i = 1; i < count; i++)
+    if (!_readSigned(_buffer, _size, bit, skipped))
+      return false;
+
+  _timestampBit = bit;
+
+  for (uint32_t i = 2; i < count; i++)
+    if (!_readSigned(_buffer, _size, bit, skipped))
+      return false;
+
+  _temperatureBit = bit;
+  _leading = -1;
+  _trailing = 0;
+
+  return _readBits(_buffer, _size, _temperatureBit, _temperature, 32);
+}
+
+bool SensorSeriesReader::next(SensorData &data)
+{
+  if (_failed || _next == 0)
+    return false;
+
+  if (_remaining == 0)
+  {
+    if (_next >= _size)
+      return false;
+
+    if (!_beginSeries())
+    {
+      _failed = true;
+      return false;
+    }
+  }
+
+  if (_position > 0)
+  {
+    int32_t indexDelta;
+    uint32_t flag;
+
+    if (!_readSigned(_buffer, _size, _indexBit, indexDelta))
+    {
+      _failed = true;
+      return false;
+    }
+
+    _index += (uint32_t)indexDelta + 1;
+
+    if (_position > 1)
+    {
+      int32_t deltaOfDelta;
+
+      if (!_readSigned(_buffer, _size, _timestampBit, deltaOfDelta))
+      {
+        _failed = true;
+        return false;
+      }
+
+      _delta = (int32_t)((uint32_t)_delta + (uint32_t)deltaOfDelta);
+    }
+
+    _timestamp += _delta;
+
+    if (!_readBits(_buffer, _size, _temperatureBit, flag, 1))
+    {
+      _failed = true;
+      return false;
+    }
+
+    if (flag != 0)
+    {
+      uint32_t control, meaningful, bits;
+
+      if (!_readBits(_buffer, _size, _temperatureBit, control, 1))
+      {
+        _failed = true;
+        return false;
+      }
+
+      // New window
+      if (control != 0)
+      {
+        uint32_t leading, length;
+
+        if (!_readBits(_buffer, _size, _temperatureBit, leading, 5) ||
+            !_readBits(_buffer, _size, _temperatureBit, length, 5) ||
+            (int)leading + (int)length + 1 > 32)
+        {
+          _failed = true;
+          return false;
+        }
+
+        _leading = leading;
+        _trailing = 32 - leading - (length + 1);
+      }
+      else if (_leading < 0)
+      {
+        _failed = true;
+        return false;
+      }
+
+      meaningful = 32 - _leading - _trailing;
+
+      if (!_readBits(_buffer, _size, _temperatureBit, bits, meaningful))
+      {
+        _failed = true;
+        return false;
+      }
+
+      _temperature ^= bits << _trailing;
+    }
+  }
+
+  data.nodeId = _nodeId;
+  data.index = _index;
+  data.timestamp = _timestamp;
+  data.temperature = _bitsFloat(_temperature);
+
+  _position++;
+  _remaining--;
+
+  // The temperature column is the last one, the next series starts on the byte after it
+  if (_remaining == 0)
+    _next = (_temperatureBit + 7) / 8;
+
+  return true;
+}
+
+bool SensorSeriesReader::failed() const
+{
+  return _failed;
+}
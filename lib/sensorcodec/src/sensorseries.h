@@ -0,0 +1,193 @@
+/**
+ * @file sensorseries.h
+ * @brief Columnar time-series codec for batches of sensor readings from the same origins
+ *
+ * Description:
+ *
+ * Readings of a node are regular: the index grows by one, the timestamp by about the read interval and the temperature drifts slowly.
+ * This codec writes the readings of each origin as a series, one column per field, each value compressed against the previous one:
+ * - Index: delta from the previous index, minus one
+ * - Timestamp: delta of the deltas (Gorilla)
+ * - Temperature: XOR of the float bits with the previous value (Gorilla), lossless
+ *
+ * A steady series takes about 2 bytes per reading instead of the ~8 bytes of a `sensorcodec.h` record.
+ *
+ * Format (batch of series, bit packed, most significant bit first):
+ * - Format marker: 1 byte (`SENSORCODEC_FORMAT_SERIES`, never zero, so the batch is a valid HTLORAV3 payload)
+ * - Sender node ID: varint
+ * - Series, each starting on a byte boundary, until the end of the buffer:
+ *   - Node ID, reading count, first index, first timestamp: varints
+ *   - First timestamp delta: zigzag varint (series of 2 readings or more)
+ *   - Index column: count - 1 signed values
+ *   - Timestamp column: count - 2 signed values
+ *   - Temperature column: first value (32 bits), then count - 1 XOR values
+ *
+ * Signed values are zigzag encoded and take a prefix and a fixed width:
+ * `0` (zero), `10` + 7 bits, `110` + 9 bits, `1110` + 12 bits, `1111` + 32 bits.
+ * XOR values are `0` (same value), `10` + the meaningful bits inside the previous window,
+ * or `11` + 5 bits leading zeros + 5 bits meaningful bit count minus one + the meaningful bits.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef SENSORSERIES_H
+#define SENSORSERIES_H
+
+#include "sensorcodec.h"
+
+// Marker of a batch of series - first byte of the payload
+#define SENSORCODEC_FORMAT_SERIES 0xB2
+
+/**
+ * @brief Encoder of a batch of per-origin series into a buffer
+ *
+ * @note Nothing is allocated, the series are written straight into the given buffer.
+ */
+class SensorSeriesWriter
+{
+public:
+  /**
+   * @brief Construct a new Sensor Series Writer
+   *
+   * @param buffer Buffer where the batch is written
+   * @param capacity Buffer size - bytes
+   */
+  SensorSeriesWriter(uint8_t *buffer, size_t capacity);
+
+  /**
+   * @brief Start a batch, writing its header
+   *
+   * @note Discards the series written before
+   *
+   * @param senderId Node ID of the node sending the batch
+   * @return bool Header written [false: buffer too small]
+   */
+  bool begin(unsigned int senderId);
+
+  /**
+   * @brief Append a series of readings of the same origin to the batch
+   *
+   * @note Readings should be in the order they were taken, the node ID of the first one is used for all.
+   * @note When the whole series doesn't fit, its longest prefix that fits is written, so the batch can be sent as is.
+   *
+   * @param records Readings of the series
+   * @param count Number of readings
+   * @return unsigned int Readings written [0: buffer full or batch not started]
+   */
+  unsigned int write(const SensorData *records, unsigned int count);
+
+  /**
+   * @brief Get the size of the batch
+   *
+   * @return size_t Batch size - bytes
+   */
+  size_t size() const;
+
+  /**
+   * @brief Get the number of readings in the batch
+   *
+   * @return unsigned int Reading count
+   */
+  unsigned int count() const;
+
+private:
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _size;
+  unsigned int _count;
+
+  /**
+   * @brief Get the longest prefix of a series that fits at the end of the batch, without writing it
+   *
+   * @param records Readings of the series
+   * @param count Number of readings
+   * @return unsigned int Readings that fit
+   */
+  unsigned int _fitSeries(const SensorData *records, unsigned int count);
+
+  /**
+   * @brief Write a series at the end of the batch, without adding it to the batch
+   *
+   * @param records Readings of the series
+   * @param count Number of readings
+   * @param size Batch size with the series - bytes
+   * @return bool Written [false: doesn't fit]
+   */
+  bool _writeSeries(const SensorData *records, unsigned int count, size_t &size);
+};
+
+/**
+ * @brief Decoder of a batch of per-origin series from a buffer
+ *
+ * @note Nothing is allocated or copied, the readings are read straight from the given buffer, one column cursor per field.
+ */
+class SensorSeriesReader
+{
+public:
+  /**
+   * @brief Construct a new Sensor Series Reader
+   *
+   * @param buffer Buffer holding the batch
+   * @param size Batch size - bytes
+   */
+  SensorSeriesReader(const uint8_t *buffer, size_t size);
+
+  /**
+   * @brief Start reading the batch, reading its header
+   *
+   * @param senderId Node ID of the node that sent the batch
+   * @return bool Header read [false: not a batch of series]
+   */
+  bool begin(unsigned int &senderId);
+
+  /**
+   * @brief Read the next reading of the batch, series after series
+   *
+   * @param data Reading read
+   * @return bool Reading read [false: end of the batch or malformed series]
+   */
+  bool next(SensorData &data);
+
+  /**
+   * @brief Check if the batch was malformed
+   *
+   * @return bool Malformed batch (the readings read before are valid)
+   */
+  bool failed() const;
+
+private:
+  const uint8_t *_buffer;
+  size_t _size;
+  // Byte where the next series starts [0: batch not started]
+  size_t _next;
+  bool _failed;
+
+  // Current series
+  int _nodeId;
+  unsigned int _remaining;
+  unsigned int _position;
+  // Column cursors - bits
+  size_t _indexBit;
+  size_t _timestampBit;
+  size_t _temperatureBit;
+  // Column states
+  uint32_t _index;
+  uint32_t _timestamp;
+  int32_t _delta;
+  uint32_t _temperature;
+  int _leading;
+  int _trailing;
+
+  /**
+   * @brief Read the header of the next series and place the column cursors
+   *
+   * @return bool Series started [false: end of the batch or malformed series]
+   */
+  bool _beginSeries();
+};
+
+#endif
@@ -0,0 +1,230 @@
+/**
+ * @file sensorsummary.cpp
+ * @brief Codec for windowed summaries of sensor readings, sent by aggregating relays
+ *
+ * Description:
+ *
+ * Check `sensorsummary.h` for the format.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensorsummary.h"
+
+#include <math.h>
+
+/**
+ * @brief Write a varint
+ *
+ * @param buffer Buffer to write to
+ * @param position Position to write at, moved past the varint
+ * @param capacity Buffer size - bytes
+ * @param value Value to write
+ * @return bool Written [false: buffer too small]
+ */
+static bool _writeVarint(uint8_t *buffer, size_t &position, size_t capacity, uint32_t value)
+{
+  do
+  {
+    if (position >= capacity)
+      return false;
+
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    buffer[position++] = value != 0 ? byte | 0x80 : byte;
+  } while (value != 0);
+
+  return true;
+}
+
+/**
+ * @brief Read a varint
+ *
+ * @param buffer Buffer to read from
+ * @param position Position to read at, moved past the varint
+ * @param size Buffer size - bytes
+ * @param value Value read
+ * @return bool Read [false: truncated or longer than 32 bits]
+ */
+static bool _readVarint(const uint8_t *buffer, size_t &position, size_t size, uint32_t &value)
+{
+  value = 0;
+
+  for (int shift = 0; shift < 7 * SENSORCODEC_MAX_VARINT_SIZE; shift += 7)
+  {
+    if (position >= size)
+      return false;
+
+    uint8_t byte = buffer[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Write a temperature as int16 little endian - 1/100 °C
+ *
+ * @return bool Written [false: buffer too small]
+ */
+static bool _writeTemperature(uint8_t *buffer, size_t &position, size_t capacity, float value)
+{
+  if (position + 2 > capacity)
+    return false;
+
+  // Fixed point, rounded and clamped to the int16 range
+  float centi = roundf(value * 100);
+  int16_t temperature = centi > INT16_MAX ? INT16_MAX : centi < INT16_MIN ? INT16_MIN : (int16_t)centi;
+
+  buffer[position++] = (uint16_t)temperature & 0xFF;
+  buffer[position++] = (uint16_t)temperature >> 8;
+
+  return true;
+}
+
+/**
+ * @brief Read a temperature as int16 little endian - 1/100 °C
+ *
+ * @return bool Read [false: truncated]
+ */
+static bool _readTemperature(const uint8_t *buffer, size_t &position, size_t size, float &value)
+{
+  if (position + 2 > size)
+    return false;
+
+  value = (int16_t)(buffer[position] | (buffer[position + 1] << 8)) / 100.0f;
+  position += 2;
+
+  return true;
+}
+
+SensorSummaryWriter::SensorSummaryWriter(uint8_t *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _size(0), _count(0)
+{
+}
+
+bool SensorSummaryWriter::begin(unsigned int senderId)
+{
+  _size = 0;
+  _count = 0;
+
+  if (_capacity < 1)
+    return false;
+
+  size_t position = 0;
+  _buffer[position++] = SENSORCODEC_FORMAT_SUMMARIES;
+
+  if (!_writeVarint(_buffer, position, _capacity, senderId))
+    return false;
+
+  _size = position;
+  return true;
+}
+
+bool SensorSummaryWriter::write(const SensorSummary &summary)
+{
+  if (_size == 0)
+    return false;
+
+  // Written past the batch, only kept if the whole summary fits
+  size_t position = _size;
+
+  if (!_writeVarint(_buffer, position, _capacity, (uint32_t)summary.nodeId) ||
+      !_writeVarint(_buffer, position, _capacity, (uint32_t)summary.firstIndex) ||
+      !_writeVarint(_buffer, position, _capacity, (uint32_t)summary.lastIndex - (uint32_t)summary.firstIndex) ||
+      !_writeVarint(_buffer, position, _capacity, summary.count) ||
+      !_writeVarint(_buffer, position, _capacity, (uint32_t)summary.firstTimestamp) ||
+      !_writeVarint(_buffer, position, _capacity, (uint32_t)summary.lastTimestamp - (uint32_t)summary.firstTimestamp) ||
+      !_writeTemperature(_buffer, position, _capacity, summary.minimum) ||
+      !_writeTemperature(_buffer, position, _capacity, summary.maximum) ||
+      !_writeTemperature(_buffer, position, _capacity, summary.mean))
+    return false;
+
+  _size = position;
+  _count++;
+
+  return true;
+}
+
+size_t SensorSummaryWriter::size() const
+{
+  return _size;
+}
+
+unsigned int SensorSummaryWriter::count() const
+{
+  return _count;
+}
+
+SensorSummaryReader::SensorSummaryReader(const uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _position(0), _failed(false)
+{
+}
+
+bool SensorSummaryReader::begin(unsigned int &senderId)
+{
+  _position = 0;
+  _failed = false;
+
+  uint32_t value;
+
+  if (_size < 1 || _buffer[0] != SENSORCODEC_FORMAT_SUMMARIES)
+  {
+    _failed = true;
+    return false;
+  }
+
+  _position = 1;
+
+  if (!_readVarint(_buffer, _position, _size, value))
+  {
+    _failed = true;
+    return false;
+  }
+
+  senderId = value;
+  return true;
+}
+
+bool SensorSummaryReader::next(SensorSummary &summary)
+{
+  if (_failed || _position == 0 || _position >= _size)
+    return false;
+
+  uint32_t nodeId, firstIndex, indexSpan, count, firstTimestamp, timestampSpan;
+
+  if (!_readVarint(_buffer, _position, _size, nodeId) ||
+      !_readVarint(_buffer, _position, _size, firstIndex) ||
+      !_readVarint(_buffer, _position, _size, indexSpan) ||
+      !_readVarint(_buffer, _position, _size, count) ||
+      !_readVarint(_buffer, _position, _size, firstTimestamp) ||
+      !_readVarint(_buffer, _position, _size, timestampSpan) ||
+      !_readTemperature(_buffer, _position, _size, summary.minimum) ||
+      !_readTemperature(_buffer, _position, _size, summary.maximum) ||
+      !_readTemperature(_buffer, _position, _size, summary.mean))
+  {
+    _failed = true;
+    return false;
+  }
+
+  summary.nodeId = nodeId;
+  summary.firstIndex = firstIndex;
+  summary.lastIndex = firstIndex + indexSpan;
+  summary.count = count;
+  summary.firstTimestamp = firstTimestamp;
+  summary.lastTimestamp = firstTimestamp + timestampSpan;
+
+  return true;
+}
+
+bool SensorSummaryReader::failed() const
+{
+  return _failed;
+}
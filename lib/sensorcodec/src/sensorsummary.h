@@ -0,0 +1,160 @@
+/**
+ * @file sensorsummary.h
+ * @brief Codec for windowed summaries of sensor readings, sent by aggregating relays
+ *
+ * Description:
+ *
+ * A summary stands for the readings of one origin in one time window: their count, the index and time ranges covered,
+ * and the minimum, maximum and mean temperatures. It takes about 16 bytes, whatever the number of readings.
+ *
+ * Format (batch of summaries):
+ * - Format marker: 1 byte (`SENSORCODEC_FORMAT_SUMMARIES`, never zero, so the batch is a valid HTLORAV3 payload)
+ * - Sender node ID: varint
+ * - Summaries, until the end of the buffer:
+ *   - Node ID, first index, index span (last - first), reading count: varints
+ *   - First timestamp, timestamp span (last - first): varints - ms
+ *   - Minimum, maximum, mean temperatures: int16 little endian - 1/100 °C (clamped to [-327.68, 327.67])
+ *
+ * Varints are unsigned LEB128, as on `sensorcodec.h`.
+ *
+ * Depends On:
+ * - sensorcodec
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#ifndef SENSORSUMMARY_H
+#define SENSORSUMMARY_H
+
+#include "sensorcodec.h"
+
+// Marker of a batch of summaries - first byte of the payload
+#define SENSORCODEC_FORMAT_SUMMARIES 0xB3
+
+// Size of a summary - bytes
+#define SENSORCODEC_MAX_SUMMARY_SIZE (6 * SENSORCODEC_MAX_VARINT_SIZE + 6)
+
+/**
+ * @brief Summary of the readings of one origin in one time window
+ */
+typedef struct
+{
+  int nodeId;
+  // Index of the first and of the last reading
+  int firstIndex;
+  int lastIndex;
+  // Timestamp of the first and of the last reading - ms - origin clock
+  unsigned long firstTimestamp;
+  unsigned long lastTimestamp;
+  // Number of readings (less than the index range when some were lost on the way)
+  unsigned int count;
+  float minimum;
+  float maximum;
+  float mean;
+} SensorSummary;
+
+/**
+ * @brief Streaming encoder of a batch of summaries into a buffer
+ *
+ * @note Nothing is allocated, the summaries are written straight into the given buffer.
+ */
+class SensorSummaryWriter
+{
+public:
+  /**
+   * @brief Construct a new Sensor Summary Writer
+   *
+   * @param buffer Buffer where the batch is written
+   * @param capacity Buffer size - bytes
+   */
+  SensorSummaryWriter(uint8_t *buffer, size_t capacity);
+
+  /**
+   * @brief Start a batch, writing its header
+   *
+   * @note Discards the summaries written before
+   *
+   * @param senderId Node ID of the node sending the batch
+   * @return bool Header written [false: buffer too small]
+   */
+  bool begin(unsigned int senderId);
+
+  /**
+   * @brief Append a summary to the batch
+   *
+   * @note The batch is left unchanged if the summary doesn't fit, so it can be sent as is
+   *
+   * @param summary Summary to append
+   * @return bool Summary written [false: buffer full or batch not started]
+   */
+  bool write(const SensorSummary &summary);
+
+  /**
+   * @brief Get the size of the batch
+   *
+   * @return size_t Batch size - bytes
+   */
+  size_t size() const;
+
+  /**
+   * @brief Get the number of summaries in the batch
+   *
+   * @return unsigned int Summary count
+   */
+  unsigned int count() const;
+
+private:
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _size;
+  unsigned int _count;
+};
+
+/**
+ * @brief Streaming decoder of a batch of summaries from a buffer
+ *
+ * @note Nothing is allocated or copied, the summaries are read straight from the given buffer.
+ */
+class SensorSummaryReader
+{
+public:
+  /**
+   * @brief Construct a new Sensor Summary Reader
+   *
+   * @param buffer Buffer holding the batch
+   * @param size Batch size - bytes
+   */
+  SensorSummaryReader(const uint8_t *buffer, size_t size);
+
+  /**
+   * @brief Start reading the batch, reading its header
+   *
+   * @param senderId Node ID of the node that sent the batch
+   * @return bool Header read [false: not a batch of summaries]
+   */
+  bool begin(unsigned int &senderId);
+
+  /**
+   * @brief Read the next summary of the batch
+   *
+   * @param summary Summary read
+   * @return bool Summary read [false: end of the batch or malformed summary]
+   */
+  bool next(SensorSummary &summary);
+
+  /**
+   * @brief Check if the batch was malformed
+   *
+   * @return bool Malformed batch (the summaries read before are valid)
+   */
+  bool failed() const;
+
+private:
+  const uint8_t *_buffer;
+  size_t _size;
+  size_t _position;
+  bool _failed;
+};
+
+#endif
@@ -0,0 +1,248 @@
+/**
+ * @file benchmark.cpp
+ * @brief Host benchmark of the sensor record codec against the JSON payload it replaces
+ *
+ * Description:
+ *
+ * Encodes and decodes batches of synthetic readings (as relayed by `src/main.cpp`) with both formats,
+ * reporting bytes per record and CPU time per record.
+ *
+ * The JSON path is the ArduinoJson code `src/main.cpp` used (a `JsonDocument` per record, `serializeJson`, `deserializeJson`).
+ * Without ArduinoJson on the include path, a `snprintf`/`strtod` version of the same text is measured instead,
+ * a lower bound of the JSON cost.
+ *
+ * Build and run from the repository root: lib/sensorcodec/tools/benchmarkBuild && ./sensorcodec-benchmark [batches]
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#if __has_include(<ArduinoJson.h>)
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 0
+#include <ArduinoJson.h>
+#define BENCHMARK_ARDUINOJSON 1
+#endif
+
+#include "sensorcodec.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_BINARY_SIZE 256     // bytes, per batch
+#define BENCHMARK_JSON_SIZE 1024      // bytes, per batch
+#define BENCHMARK_READ_INTERVAL 10000 // milliseconds
+
+static volatile unsigned long sink; // Keeps the decoded values alive
+
+static double nowNs()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Fill a batch with readings of upstream nodes, like a relay queue
+ */
+static void makeBatch(SensorData *batch, int count, int round)
+{
+  for (int i = 0; i < count; i++)
+  {
+    batch[i].nodeId = 2 + i % 4;
+    batch[i].index = round * count / 4 + i / 4;
+    batch[i].temperature = (200 + rand() % 100) / 10.0f;
+    batch[i].timestamp = (unsigned long)batch[i].index * BENCHMARK_READ_INTERVAL + batch[i].nodeId * 37;
+  }
+}
+
+static size_t encodeBinary(const SensorData *batch, int count, uint8_t *buffer)
+{
+  SensorRecordWriter writer(buffer, BENCHMARK_BINARY_SIZE);
+  writer.begin(1);
+
+  for (int i = 0; i < count; i++)
+    writer.write(batch[i]);
+
+  return writer.size();
+}
+
+static int decodeBinary(const uint8_t *buffer, size_t size)
+{
+  SensorRecordReader reader(buffer, size);
+  unsigned int senderId;
+  SensorData data;
+  int count = 0;
+
+  if (!reader.begin(senderId))
+    return 0;
+
+  while (reader.next(data))
+  {
+    sink += data.timestamp + data.index;
+    count++;
+  }
+
+  return count;
+}
+
+#ifdef BENCHMARK_ARDUINOJSON
+
+static size_t encodeJson(const SensorData *batch, int count, char *buffer)
+{
+  JsonDocument document;
+
+  document["destId"] = 1;
+  document["nodeId"] = 2;
+
+  JsonArray array = document["data"].to<JsonArray>();
+
+  for (int i = 0; i < count; i++)
+  {
+    JsonDocument record;
+
+    record["nodeId"] = batch[i].nodeId;
+    record["index"] = batch[i].index;
+    record["temperature"] = batch[i].temperature;
+    record["timestamp"] = batch[i].timestamp;
+
+    array.add(record);
+  }
+
+  return serializeJson(document, buffer, BENCHMARK_JSON_SIZE);
+}
+
+static int decodeJson(const char *buffer, size_t size)
+{
+  JsonDocument document;
+  deserializeJson(document, buffer, size);
+
+  int count = 0;
+
+  for (JsonVariant record : document["data"].as<JsonArray>())
+  {
+    SensorData data;
+
+    data.index = record["index"].as<int>();
+    data.nodeId = record["nodeId"].as<int>();
+    data.temperature = record["temperature"].as<float>();
+    data.timestamp = record["timestamp"].as<unsigned long>();
+
+    sink += data.timestamp + data.index;
+    count++;
+  }
+
+  return count;
+}
+
+#else
+
+static size_t encodeJson(const SensorData *batch, int count, char *buffer)
+{
+  size_t size = snprintf(buffer, BENCHMARK_JSON_SIZE, "{\"destId\":1,\"nodeId\":2,\"data\":[");
+
+  for (int i = 0; i < count; i++)
+    size += snprintf(buffer + size, BENCHMARK_JSON_SIZE - size, "%s{\"nodeId\":%d,\"index\":%d,\"temperature\":%g,\"timestamp\":%lu}",
+                     i > 0 ? "," : "", batch[i].nodeId, batch[i].index, batch[i].temperature, batch[i].timestamp);
+
+  size += snprintf(buffer + size, BENCHMARK_JSON_SIZE - size, "]}");
+  return size;
+}
+
+static int decodeJson(const char *buffer, size_t)
+{
+  int count = 0;
+  const char *record = buffer;
+
+  while ((record = strstr(record, "{\"nodeId\":")) != NULL)
+  {
+    SensorData data;
+    char *end;
+
+    data.nodeId = strtol(record + 10, &end, 10);
+    data.index = strtol(strchr(end, ':') + 1, &end, 10);
+    data.temperature = strtof(strchr(end, ':') + 1, &end);
+    data.timestamp = strtoul(strchr(end, ':') + 1, &end, 10);
+
+    sink += data.timestamp + data.index;
+    count++;
+    record = end;
+  }
+
+  return count;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+  int batches = argc > 1 ? atoi(argv[1]) : 20000;
+  int sizes[] = {1, 4, 10};
+
+  SensorData *readings = new SensorData[batches * 10];
+  uint8_t *binary = new uint8_t[(size_t)batches * BENCHMARK_BINARY_SIZE];
+  char *json = new char[(size_t)batches * BENCHMARK_JSON_SIZE];
+  size_t *binarySizes = new size_t[batches];
+  size_t *jsonSizes = new size_t[batches];
+
+  // Touched once, so page faults are not timed
+  memset(binary, 0, (size_t)batches * BENCHMARK_BINARY_SIZE);
+  memset(json, 0, (size_t)batches * BENCHMARK_JSON_SIZE);
+
+#ifdef BENCHMARK_ARDUINOJSON
+  printf("JSON path: ArduinoJson %s\n", ARDUINOJSON_VERSION);
+#else
+  printf("JSON path: snprintf/strtod (ArduinoJson not found, lower bound)\n");
+#endif
+  printf("%-8s %-7s %12s %14s %14s\n", "records", "format", "bytes/record", "encode ns/rec", "decode ns/rec");
+
+  for (int records : sizes)
+  {
+    srand(1);
+
+    for (int round = 0; round < batches; round++)
+      makeBatch(readings + round * records, records, round);
+
+    // Each pass is timed as a whole, the clock costs more than a binary record
+    double binaryBytes = 0, jsonBytes = 0;
+    int binaryCount = 0, jsonCount = 0;
+
+    double start = nowNs();
+    for (int round = 0; round < batches; round++)
+      binarySizes[round] = encodeBinary(readings + round * records, records, binary + (size_t)round * BENCHMARK_BINARY_SIZE);
+    double binaryEncode = nowNs() - start;
+
+    start = nowNs();
+    for (int round = 0; round < batches; round++)
+      binaryCount += decodeBinary(binary + (size_t)round * BENCHMARK_BINARY_SIZE, binarySizes[round]);
+    double binaryDecode = nowNs() - start;
+
+    start = nowNs();
+    for (int round = 0; round < batches; round++)
+      jsonSizes[round] = encodeJson(readings + round * records, records, json + (size_t)round * BENCHMARK_JSON_SIZE);
+    double jsonEncode = nowNs() - start;
+
+    start = nowNs();
+    for (int round = 0; round < batches; round++)
+      jsonCount += decodeJson(json + (size_t)round * BENCHMARK_JSON_SIZE, jsonSizes[round]);
+    double jsonDecode = nowNs() - start;
+
+    for (int round = 0; round < batches; round++)
+    {
+      binaryBytes += binarySizes[round];
+      jsonBytes += jsonSizes[round];
+    }
+
+    double total = (double)batches * records;
+
+    if (binaryCount != total || jsonCount != total)
+    {
+      printf("Decoded %d binary and %d JSON records of %.0f\n", binaryCount, jsonCount, total);
+      return 1;
+    }
+
+    printf("%-8d %-7s %12.1f %14.1f %14.1f\n", records, "binary", binaryBytes / total, binaryEncode / total, binaryDecode / total);
+    printf("%-8d %-7s %12.1f %14.1f %14.1f\n", records, "json", jsonBytes / total, jsonEncode / total, jsonDecode / total);
+  }
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file series-benchmark.cpp
+ * @brief Host benchmark of the columnar series codec on a synthetic 24-hour trace
+ *
+ * Description:
+ *
+ * Generates a day of readings of one node (every `SENSOR_READ_INTERVAL` plus a few ms of task jitter,
+ * a daily temperature swing with sensor noise, quantized to the 0.01 °C of the BME280)
+ * and packs it in batches with the series codec and with the record codec, reporting bytes per reading,
+ * readings per frame and encode/decode CPU time per reading.
+ *
+ * Build and run from the repository root: lib/sensorcodec/tools/benchmarkBuild && ./sensorseries-benchmark [days]
+ *
+ * @author @joaomrsouza (João Marcos Rocha Souza)
+ * https://github.com/joaomrsouza
+ */
+
+#include "sensorcodec.h"
+#include "sensorseries.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_READ_INTERVAL 10000                                       // milliseconds
+#define BENCHMARK_DAY_READINGS (24 * 3600 * 1000 / BENCHMARK_READ_INTERVAL) // readings
+#define BENCHMARK_FRAME_SIZE (255 - 11)                                     // bytes, one HTLORAV3 frame with any header
+#define BENCHMARK_RUNS 5                                                    // runs, the best is reported
+#define BENCHMARK_BATCHES(readings) ((readings) + 1)                        // batches at most
+
+static volatile unsigned long sink; // Keeps the decoded values alive
+
+static double nowNs()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Fill a trace of readings of one node
+ */
+static void makeTrace(SensorData *trace, int count)
+{
+  unsigned long timestamp = 5000;
+
+  for (int i = 0; i < count; i++)
+  {
+    double hours = (double)timestamp / 3600000;
+    double noise = ((rand() % 1000) / 1000.0 - 0.5) * 0.04;
+    double temperature = 22 + 4 * sin(2 * M_PI * (hours - 9) / 24) + noise;
+
+    trace[i].nodeId = 7;
+    trace[i].index = i;
+    trace[i].temperature = roundf(temperature * 100) / 100; // Like the BME280 compensation
+    trace[i].timestamp = timestamp;
+
+    timestamp += BENCHMARK_READ_INTERVAL + rand() % 4;
+  }
+}
+
+typedef struct
+{
+  size_t offset;
+  size_t size;
+  unsigned int count;
+} Batch;
+
+/**
+ * @brief Pack the trace in batches of at most `batchReadings` readings that fit in `capacity` bytes
+ *
+ * @return int Number of batches
+ */
+static int encode(bool series, const SensorData *trace, int count, unsigned int batchReadings, size_t capacity, uint8_t *output, Batch *batches)
+{
+  int batchCount = 0;
+  size_t offset = 0;
+
+  for (int i = 0; i < count;)
+  {
+    uint8_t *buffer = output + offset;
+    unsigned int want = count - i < (int)batchReadings ? count - i : batchReadings;
+    unsigned int written = 0;
+    size_t size;
+
+    if (series)
+    {
+      SensorSeriesWriter writer(buffer, capacity);
+      writer.begin(1);
+      written = writer.write(trace + i, want);
+      size = writer.size();
+    }
+    else
+    {
+      SensorRecordWriter writer(buffer, capacity);
+      writer.begin(1);
+      while (written < want && writer.write(trace[i + written]))
+        written++;
+      size = writer.size();
+    }
+
+    batches[batchCount].offset = offset;
+    batches[batchCount].size = size;
+    batches[batchCount].count = written;
+    batchCount++;
+
+    offset += size;
+    i += written;
+  }
+
+  return batchCount;
+}
+
+static int decode(bool series, const uint8_t *output, const Batch *batches, int batchCount)
+{
+  int count = 0;
+  unsigned int senderId;
+  SensorData data;
+
+  for (int b = 0; b < batchCount; b++)
+  {
+    const uint8_t *buffer = output + batches[b].offset;
+
+    if (series)
+    {
+      SensorSeriesReader reader(buffer, batches[b].size);
+      reader.begin(senderId);
+      while (reader.next(data))
+      {
+        sink += data.timestamp + data.index;
+        count++;
+      }
+    }
+    else
+    {
+      SensorRecordReader reader(buffer, batches[b].size);
+      reader.begin(senderId);
+      while (reader.next(data))
+      {
+        sink += data.timestamp + data.index;
+        count++;
+      }
+    }
+  }
+
+  return count;
+}
+
+int main(int argc, char **argv)
+{
+  int days = argc > 1 ? atoi(argv[1]) : 1;
+  int count = days * BENCHMARK_DAY_READINGS;
+
+  // Readings per batch: one per frame, the 10 of the relay queue, as many as fit in a frame
+  unsigned int batchReadings[] = {1, 10, (unsigned int)count};
+
+  SensorData *trace = new SensorData[count];
+  uint8_t *output = new uint8_t[(size_t)BENCHMARK_BATCHES(count) * BENCHMARK_FRAME_SIZE];
+  Batch *batches = new Batch[BENCHMARK_BATCHES(count)];
+
+  srand(1);
+  makeTrace(trace, count);
+  memset(output, 0, (size_t)BENCHMARK_BATCHES(count) * BENCHMARK_FRAME_SIZE);
+
+  printf("%d readings (%d day%s, one every %d ms), %d-byte frames\n", count, days, days > 1 ? "s" : "", BENCHMARK_READ_INTERVAL, BENCHMARK_FRAME_SIZE);
+  printf("%-9s %-7s %13s %13s %14s %14s %13s\n", "batch", "format", "bytes/reading", "readings/frm", "encode ns/rdg", "decode ns/rdg", "frames/hour");
+
+  for (unsigned int readings : batchReadings)
+  {
+    for (int format = 1; format >= 0; format--)
+    {
+      bool series = format == 1;
+
+      int batchCount = 0;
+      double encodeNs = 0, decodeNs = 0;
+
+      // Best of a few runs, the host is not idle
+      for (int run = 0; run < BENCHMARK_RUNS; run++)
+      {
+        double start = nowNs();
+        batchCount = encode(series, trace, count, readings, BENCHMARK_FRAME_SIZE, output, batches);
+        double encoded = nowNs();
+        int decoded = decode(series, output, batches, batchCount);
+        double end = nowNs();
+
+        if (decoded != count)
+        {
+          printf("Decoded %d readings of %d\n", decoded, count);
+          return 1;
+        }
+
+        if (run == 0 || encoded - start < encodeNs)
+          encodeNs = encoded - start;
+        if (run == 0 || end - encoded < decodeNs)
+          decodeNs = end - encoded;
+      }
+
+      size_t bytes = 0;
+      for (int b = 0; b < batchCount; b++)
+        bytes += batches[b].size;
+
+      char label[16] = "frame";
+      if (readings != (unsigned int)count)
+        snprintf(label, sizeof(label), "%u", readings);
+
+      printf("%-9s %-7s %13.2f %13.1f %14.1f %14.1f %13.1f\n", label, series ? "series" : "record",
+             (double)bytes / count, (double)count / batchCount, encodeNs / count, decodeNs / count,
+             batchCount / (24.0 * days));
+    }
+  }
+
+  return 0;
+}
@@ -1,11 +1,18 @@
 #include "htwlv3.h"
+#include "ringlog.h"
+#include "ringlogflash.h"
 #include "sclog.h"
+#include "sensoraggregator.h"
+#include "sensorbatchpolicy.h"
+#include "sensorseries.h"
+#include "sensorsummary.h"
 
 #include <Adafruit_BME280.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #ifndef NODE_ID
 #define NODE_ID 255
@@ -21,17 +28,32 @@
 #define STATE_SEND 1
 #define STATE_RECEIVE 2
 #define STATE_WAIT 3
+#define NOTIFY_LORA_INTERRUPT 0xFF // Radio event pending, keeps the state
+
+// Source of the batch waiting for its ACK
+#define SOURCE_QUEUE 0
+#define SOURCE_LOG 1
+#define SOURCE_SUMMARIES 2
 
 #define SENSOR_READ_INTERVAL 10000 // milliseconds
 #define LISTEN_TIMEOUT 10000       // milliseconds
 
-typedef struct dataPacket
-{
-  int index;
-  int nodeId;
-  float temperature;
-  unsigned long timestamp;
-} SensorData;
+#define LORA_QUEUE_LENGTH LORA_BATCH_READINGS                                    // readings waiting to be sent, a full batch is held in RAM
+#define LORA_BATCH_SIZE (HTLORAV3_MAX_PACKET_SIZE - HTLORAV3_LEGACY_HEADER_SIZE) // bytes, one frame with any header
+#define LORA_BATCH_READINGS 80                                                   // readings, more than fit in a frame
+#define LORA_LOG_SEGMENTS 64                                                     // flash sectors (4 KB), ~14000 readings spilled
+#define LORA_SUMMARY_QUEUE_LENGTH 16                                             // summaries waiting to be sent
+#define LORA_RECEIVE_QUEUE_LENGTH HTLORAV3_RX_POOL_SIZE                          // packets received waiting to be decoded, one per receive slot
+#define LORA_BATCH_MAX_AGE 60000                                                 // milliseconds, a batch that isn't full is sent when its oldest reading is this old
+#define LORA_BATCH_MIN_RECORDS 0                                                 // readings, a batch with this many is sent before it is full [0: off]
+
+// Aggregation of the readings relayed [SENSORAGGREGATOR_MODE_OFF, SENSORAGGREGATOR_MODE_SUMMARY, SENSORAGGREGATOR_MODE_DECIMATE]
+#ifndef AGGREGATION_MODE
+#define AGGREGATION_MODE SENSORAGGREGATOR_MODE_OFF
+#endif
+
+#define AGGREGATION_WINDOW 300000 // milliseconds, per origin
+#define AGGREGATION_DEADBAND 0.5  // °C, decimate mode
 
 SCLOG::LOG_LEVELS node1Levels[] = {SCLOG::INFO, SCLOG::WARN, SCLOG::DEBUG, SCLOG::ERROR, SCLOG::TRACE};
 SCLOG::LOG_LEVELS node2Levels[] = {SCLOG::INFO, SCLOG::WARN, SCLOG::DEBUG, SCLOG::ERROR, SCLOG::TRACE};
@@ -53,6 +75,26 @@ TaskHandle_t xTaskHandleReadTemperature = NULL;
 TaskHandle_t xTaskHandleLoraControl = NULL;
 
 QueueHandle_t xQueueHandleSendWithLora = NULL;
+QueueHandle_t xQueueHandleSummaries = NULL;
+QueueHandle_t xQueueHandleReceived = NULL;
+SemaphoreHandle_t xMutexLoraLog = NULL; // The log and the batch policy, shared with the read task
+
+// Aggregation of the readings received, used by the LoRa control task only
+SensorAggregator aggregator;
+
+// Readings that don't fit in the queue, kept on the flash until they are delivered
+RingLogFlash loraLogStorage(RINGLOGFLASH_PARTITION, LORA_LOG_SEGMENTS);
+RingLog loraLog(&loraLogStorage, sizeof(SensorData));
+bool loraLogAvailable = false;
+
+// When the readings waiting are sent, full batches unless they wait too long or are urgent
+SensorBatchPolicy batchPolicy;
+
+// Batch waiting for its ACK, only one at a time so the log is popped only once it is delivered
+SensorData loraSending[LORA_BATCH_READINGS];
+SensorSummary loraSendingSummaries[LORA_SUMMARY_QUEUE_LENGTH];
+int loraSendingCount = 0;
+int loraSendingSource = SOURCE_QUEUE;
 
 int packetIndex = 0;
 bool bmeAvailable = false;
@@ -63,6 +105,163 @@ void clearDisplay()
   Board.display->setCursor(0, 0);
 }
 
+void logSensorData(const SensorData &data, SCLOG::LOG_LEVELS level, SCLOG::COLORS color)
+{
+  sc.log("  " + String(data.nodeId) + "-" + String(data.index) + ": " + String(data.temperature) + " C @ " + String(data.timestamp), level, color);
+  Board.println(String(NODE_ID) + ":   " + String(data.nodeId) + "-" + String(data.index));
+}
+
+void logSensorSummary(const SensorSummary &summary, SCLOG::LOG_LEVELS level, SCLOG::COLORS color)
+{
+  sc.log("  " + String(summary.nodeId) + "-" + String(summary.firstIndex) + ".." + String(summary.lastIndex) + ": " + String(summary.count) + " x " +
+             String(summary.mean) + " C [" + String(summary.minimum) + ", " + String(summary.maximum) + "] @ " + String(summary.firstTimestamp),
+         level, color);
+  Board.println(String(NODE_ID) + ":   " + String(summary.nodeId) + "-" + String(summary.firstIndex) + ".." + String(summary.lastIndex));
+}
+
+void queueSummary(const SensorSummary &summary)
+{
+  if (xQueueSend(xQueueHandleSummaries, &summary, 0) != pdTRUE)
+    sc.log("Lora Control: " + String(summary.count) + " READINGS LOST! SUMMARY QUEUE FULL", sc.ERROR);
+}
+
+void spillReadings(const SensorData *records, int count)
+{
+  xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+
+  for (int i = 0; i < count; i++)
+    if (!loraLogAvailable || !loraLog.append(&records[i]))
+    {
+      sc.log("Lora Control: " + String(count - i) + " READINGS LOST! LOG FULL", sc.ERROR);
+      break;
+    }
+
+  xSemaphoreGive(xMutexLoraLog);
+}
+
+void requeueSending()
+{
+  // Summaries go back to the front of their queue, readings of the queue to the log, the log keeps its own
+  if (loraSendingSource == SOURCE_SUMMARIES)
+  {
+    for (int i = loraSendingCount - 1; i >= 0; i--)
+      if (xQueueSendToFront(xQueueHandleSummaries, &loraSendingSummaries[i], 0) != pdTRUE)
+        sc.log("Lora Control: " + String(loraSendingSummaries[i].count) + " READINGS LOST! SUMMARY QUEUE FULL", sc.ERROR);
+  }
+  else
+  {
+    if (loraSendingSource == SOURCE_QUEUE)
+      spillReadings(loraSending, loraSendingCount);
+
+    // Waiting again, with the age they already have when others are waiting
+    xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+    batchPolicy.add(millis());
+    xSemaphoreGive(xMutexLoraLog);
+  }
+}
+
+bool isBatchDue()
+{
+  xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+  bool due = batchPolicy.check(uxQueueMessagesWaiting(xQueueHandleSendWithLora) + loraLog.count(), millis());
+  xSemaphoreGive(xMutexLoraLog);
+
+  return due;
+}
+
+void queueReading(const SensorData &data, bool urgent = false)
+{
+  xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+
+  // Never blocks: once a reading spills to the log the next ones follow it, until the log is drained
+  bool spilled = loraLogAvailable && loraLog.count() > 0;
+
+  if (spilled || xQueueSend(xQueueHandleSendWithLora, &data, 0) != pdTRUE)
+  {
+    if (!loraLogAvailable || !loraLog.append(&data))
+      sc.log("Lora Control: READING LOST! QUEUE AND LOG FULL", sc.ERROR);
+  }
+
+  batchPolicy.add(millis(), urgent);
+
+  xSemaphoreGive(xMutexLoraLog);
+}
+
+bool writeBatch(SensorSeriesWriter &writer, const SensorData *records, int count)
+{
+  SensorData series[LORA_BATCH_READINGS];
+  bool written[LORA_BATCH_READINGS] = {false};
+
+  writer.begin(NODE_ID);
+
+  // One series per origin, in the order they were queued
+  for (int i = 0; i < count; i++)
+  {
+    if (written[i])
+      continue;
+
+    int seriesCount = 0;
+    for (int j = i; j < count; j++)
+      if (records[j].nodeId == records[i].nodeId)
+      {
+        series[seriesCount++] = records[j];
+        written[j] = true;
+      }
+
+    if (writer.write(series, seriesCount) < seriesCount)
+      return false;
+  }
+
+  return true;
+}
+
+void decodePacket(const LoraDataPacket &packet)
+{
+  // Readings and summaries are decoded straight from the receive slot, no copy of the payload
+  SensorSeriesReader reader((const uint8_t *)packet.data, packet.size);
+  SensorSummaryReader summaryReader((const uint8_t *)packet.data, packet.size);
+  unsigned int srcId;
+
+  if (reader.begin(srcId))
+  {
+    sc.log("<- " + String(srcId), sc.TRACE, sc.YELLOW);
+    Board.println(String(NODE_ID) + ": <- " + String(srcId));
+
+    SensorData data;
+
+    while (reader.next(data))
+    {
+      logSensorData(data, sc.TRACE, sc.YELLOW);
+
+      // Taken by the aggregation, or forwarded as is
+      if (!aggregator.add(data, millis()))
+        queueReading(data);
+    }
+
+    if (reader.failed())
+      sc.log("LORA: Malformed sensor readings (" + String(packet.size) + " bytes)", sc.WARN);
+  }
+  else if (summaryReader.begin(srcId))
+  {
+    sc.log("<- " + String(srcId), sc.TRACE, sc.YELLOW);
+    Board.println(String(NODE_ID) + ": <- " + String(srcId));
+
+    SensorSummary summary;
+
+    // Already aggregated, forwarded as they are
+    while (summaryReader.next(summary))
+    {
+      logSensorSummary(summary, sc.TRACE, sc.YELLOW);
+      queueSummary(summary);
+    }
+
+    if (summaryReader.failed())
+      sc.log("LORA: Malformed sensor summaries (" + String(packet.size) + " bytes)", sc.WARN);
+  }
+  else
+    sc.log("LORA: Malformed sensor readings (" + String(packet.size) + " bytes)", sc.WARN);
+}
+
 void vTaskButton(void *pvParams)
 {
   bool autoMode = BME_INIT_AUTO_MODE;
@@ -171,7 +370,11 @@ void vTaskReadTemperature(void *pvParams)
     // sc.log("BME: Read " + String(data.temperature) + " °C" + (bmeAvailable ? "" : " (Fake)"), sc.INFO);
     Board.println(String(NODE_ID) + ": BME: " + String(data.temperature) + " C" + (bmeAvailable ? "" : " Fake"));
 
-    xQueueSend(xQueueHandleSendWithLora, &data, portMAX_DELAY);
+    // Manual readings are sent at once, the control task is woken to pack them
+    queueReading(data, !autoMode);
+
+    if (!autoMode)
+      xTaskNotify(xTaskHandleLoraControl, NOTIFY_LORA_INTERRUPT, eSetValueWithoutOverwrite);
 
     vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL));
   }
@@ -181,13 +384,30 @@ void vTaskLoraControl(void *pvParams)
 {
   int state = STATE_CHECK;
   uint32_t notification;
+  TickType_t wait;
 
   while (true)
   {
     if (state == STATE_CHECK)
     {
       sc.log("Lora Control: CHECK", sc.TRACE);
-      if (uxQueueMessagesWaiting(xQueueHandleSendWithLora) > 0)
+
+      // Packets handed off by `cLoraOnReceive`, their slots go back to the library once decoded
+      LoraDataPacket packet;
+      while (xQueueReceive(xQueueHandleReceived, &packet, 0) == pdTRUE)
+      {
+        decodePacket(packet);
+        Board.lora->releasePacket(packet);
+      }
+
+      // Summaries of the windows that closed
+      SensorSummary summary;
+      while (uxQueueSpacesAvailable(xQueueHandleSummaries) > 0 && aggregator.poll(summary, millis()))
+        queueSummary(summary);
+
+      if (loraSendingCount > 0)
+        state = STATE_WAIT; // The batch sent waits for its ACK
+      else if (uxQueueMessagesWaiting(xQueueHandleSummaries) > 0 || isBatchDue())
         state = STATE_SEND;
       else
         state = STATE_RECEIVE;
@@ -197,66 +417,158 @@ void vTaskLoraControl(void *pvParams)
     {
       sc.log("Lora Control: SEND", sc.TRACE);
       SensorData lastData;
-      JsonDocument lastDataDocument;
 
       unsigned int destId = NODE_ID - 1;
 
-      lastDataDocument["destId"] = destId;
-      lastDataDocument["nodeId"] = NODE_ID;
+      if (destId > 0)
+      {
+        sc.log("-> " + String(destId), sc.INFO, sc.GREEN);
+        Board.println(String(NODE_ID) + ": -> " + String(destId));
+
+        uint8_t batch[LORA_BATCH_SIZE];
+        size_t size = 0;
+        int count = 0, fit = 0;
 
-      JsonArray lastDataArray = lastDataDocument["data"].to<JsonArray>();
+        // The summaries first, they stand for many readings each
+        while (count < LORA_SUMMARY_QUEUE_LENGTH && xQueueReceive(xQueueHandleSummaries, &loraSendingSummaries[count], 0) == pdTRUE)
+          count++;
 
-      while (xQueueReceive(xQueueHandleSendWithLora, &lastData, 0) == pdTRUE)
-      {
-        JsonDocument dataToSend;
+        if (count > 0)
+        {
+          loraSendingSource = SOURCE_SUMMARIES;
 
-        dataToSend["nodeId"] = lastData.nodeId;
-        dataToSend["index"] = lastData.index;
-        dataToSend["temperature"] = lastData.temperature;
-        dataToSend["timestamp"] = lastData.timestamp;
+          SensorSummaryWriter writer(batch, sizeof(batch));
+          writer.begin(NODE_ID);
 
-        lastDataArray.add(dataToSend);
-      }
+          while (fit < count && writer.write(loraSendingSummaries[fit]))
+            logSensorSummary(loraSendingSummaries[fit++], sc.INFO, sc.GREEN);
 
-      String dataString;
-      serializeJson(lastDataDocument, dataString);
+          // The summaries that don't fit wait for the next batch, in the same order
+          for (int i = count - 1; i >= fit; i--)
+            if (xQueueSendToFront(xQueueHandleSummaries, &loraSendingSummaries[i], 0) != pdTRUE)
+              sc.log("Lora Control: " + String(loraSendingSummaries[i].count) + " READINGS LOST! SUMMARY QUEUE FULL", sc.ERROR);
 
-      if (destId > 0)
-      {
-        sc.log("-> " + String(destId), sc.INFO, sc.GREEN);
-        Board.println(String(NODE_ID) + ": -> " + String(destId));
+          size = writer.size();
+        }
+        else
+        {
+          // Then the queue, then the log, that holds the readings queued after it
+          // Held until the readings not sent are back on the queue, so none is queued meanwhile and they keep their order
+          xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+
+          while (count < LORA_QUEUE_LENGTH && xQueueReceive(xQueueHandleSendWithLora, &loraSending[count], 0) == pdTRUE)
+            count++;
+
+          loraSendingSource = count > 0 ? SOURCE_QUEUE : SOURCE_LOG;
+
+          if (loraSendingSource == SOURCE_LOG)
+            count = loraLog.peek(loraSending, LORA_BATCH_READINGS);
+
+          // Readings are encoded straight into the frame, the largest run of the oldest ones that fits the payload budget
+          size_t capacity = batchPolicy.getConfig().maxPayload;
+          SensorSeriesWriter writer(batch, capacity < sizeof(batch) ? capacity : sizeof(batch));
+          fit = count;
+
+          if (!writeBatch(writer, loraSending, count))
+          {
+            // A batch only grows with its readings, so the run is found by bisection
+            int low = 1, high = count - 1;
+
+            while (low < high)
+            {
+              int middle = (low + high + 1) / 2;
+
+              if (writeBatch(writer, loraSending, middle))
+                low = middle;
+              else
+                high = middle - 1;
+            }
+
+            fit = low;
+            writeBatch(writer, loraSending, fit);
+          }
+
+          size = writer.size();
+
+          // Full when the next reading doesn't fit, or more wait than a batch can hold (on the log or over the queue)
+          bool full = fit < count || count == LORA_BATCH_READINGS || (loraSendingSource == SOURCE_QUEUE && loraLog.count() > 0);
+
+          if (!batchPolicy.shouldSend(size, fit, full, millis()))
+            fit = 0; // Waits for more readings, or for the oldest to get too old
+
+          // The readings of the queue that aren't sent wait for the next batch, in the same order (their slots are still free)
+          if (loraSendingSource == SOURCE_QUEUE)
+            for (int i = count - 1; i >= fit; i--)
+              if (xQueueSendToFront(xQueueHandleSendWithLora, &loraSending[i], 0) != pdTRUE && (!loraLogAvailable || !loraLog.append(&loraSending[i])))
+                sc.log("Lora Control: READING LOST! QUEUE AND LOG FULL", sc.ERROR);
+
+          xSemaphoreGive(xMutexLoraLog);
+
+          for (int i = 0; i < fit; i++)
+            logSensorData(loraSending[i], sc.INFO, sc.GREEN);
+        }
+
+        loraSendingCount = fit;
+
+        // Queued on the library, retries and ordering per destination are handled on `process()`
+        int res = fit > 0 ? Board.lora->sendReliablePacket(batch, size, destId) : -1;
+        sc.log("Lora Control: SEND - " + String(res) + " (" + String(fit) +
+                   (loraSendingSource == SOURCE_SUMMARIES ? " summaries)" : loraSendingSource == SOURCE_LOG ? " readings from the log)" : " readings)"),
+               sc.TRACE);
+        if (res == 0 && loraSendingSource != SOURCE_SUMMARIES)
+        {
+          xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+          unsigned int remaining = uxQueueMessagesWaiting(xQueueHandleSendWithLora) + loraLog.count() - (loraSendingSource == SOURCE_LOG ? fit : 0);
+          batchPolicy.sent(size, fit, remaining, millis());
+          SensorBatchMetrics metrics = batchPolicy.getMetrics();
+          xSemaphoreGive(xMutexLoraLog);
 
-        for (JsonVariant jsonData : lastDataArray)
+          sc.log("Lora Control: BATCH - " + String(size) + " bytes, " + String(metrics.fillRatio * 100) + "% full on average", sc.TRACE);
+        }
+        else if (res > 0)
         {
-          String str;
-          serializeJson(jsonData, str);
-          sc.log("  " + str, sc.INFO, sc.GREEN);
-          Board.println(String(NODE_ID) + ":   " + String(jsonData["nodeId"].as<int>()) + "-" + String(jsonData["index"].as<int>()));
+          sc.log("Lora Control: NOT ABLE TO SEND! QUEUE FULL", sc.ERROR);
+          requeueSending();
         }
 
-        int res = Board.lora->sendReliablePacket(dataString.c_str(), destId); // TODO: Check for return and sleep if busy
-        sc.log("Lora Control: SEND - " + String(res), sc.TRACE);
         if (res != 0)
-          sc.log("Lora Control: NOT ABLE TO SEND! NOT IDLE", sc.ERROR);
-        state = STATE_WAIT;
+          loraSendingCount = 0;
+
+        state = res < 0 ? STATE_CHECK : STATE_WAIT;
       }
       else
       {
         // sc.log("Final Data:", sc.INFO, sc.GREEN);
         Board.println(String(NODE_ID) + ": Final Data:");
 
-        for (JsonVariant jsonData : lastDataArray)
+        while (xQueueReceive(xQueueHandleSendWithLora, &lastData, 0) == pdTRUE)
+          logSensorData(lastData, sc.INFO, sc.GREEN);
+
+        SensorSummary lastSummary;
+        while (xQueueReceive(xQueueHandleSummaries, &lastSummary, 0) == pdTRUE)
+          logSensorSummary(lastSummary, sc.INFO, sc.GREEN);
+
+        xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+
+        int count;
+        while ((count = loraLog.peek(loraSending, LORA_BATCH_READINGS)) > 0)
         {
-          String str;
-          serializeJson(jsonData, str);
-          sc.log("  " + str, sc.INFO, sc.GREEN);
-          Board.println(String(NODE_ID) + ":   " + String(jsonData["nodeId"].as<int>()) + "-" + String(jsonData["index"].as<int>()));
+          for (int i = 0; i < count; i++)
+            logSensorData(loraSending[i], sc.INFO, sc.GREEN);
+
+          loraLog.pop(count);
         }
 
+        xSemaphoreGive(xMutexLoraLog);
+
         state = STATE_CHECK;
       }
     }
 
+    // Woken by an aggregator or batch deadline: still listening since the last time
+    if (state == STATE_RECEIVE && Board.lora->isListening())
+      state = STATE_WAIT;
+
     if (state == STATE_RECEIVE)
     {
       int res = Board.lora->listenToPacket(LISTEN_TIMEOUT);
@@ -266,44 +578,62 @@ void vTaskLoraControl(void *pvParams)
       state = STATE_WAIT;
     }
 
+    // Block until a radio interrupt, a LoRa callback or the next protocol deadline
+    wait = 0;
+
     if (state == STATE_WAIT)
     {
       sc.log("Lora Control: WAIT - " + String(Board.lora->getState()), sc.TRACE);
-      Board.process();
+      uint32_t next = Board.process();
+
+      // Windows of the aggregation that close are sent as summaries
+      uint32_t close = aggregator.getNextDeadline(millis());
+      if (close == 0 && uxQueueSpacesAvailable(xQueueHandleSummaries) > 0)
+        state = STATE_CHECK;
+      else if (close > 0 && close < next)
+        next = close; // Otherwise the summary queue is full, it waits for the batch sent
+
+      // Readings that waited too long, or urgent, are sent once the batch sent is done
+      xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+      uint32_t due = loraSendingCount > 0 ? UINT32_MAX : batchPolicy.getNextDeadline(millis());
+      xSemaphoreGive(xMutexLoraLog);
+
+      if (due == 0)
+        state = STATE_CHECK;
+      else if (due < next)
+        next = due;
+
+      wait = state != STATE_WAIT ? 0 : next == UINT32_MAX ? portMAX_DELAY : next / portTICK_PERIOD_MS;
     }
 
-    if (xTaskNotifyWait(0, ULONG_MAX, &notification, pdMS_TO_TICKS(100)) == pdTRUE)
+    if (xTaskNotifyWait(0, ULONG_MAX, &notification, wait) == pdTRUE && notification != NOTIFY_LORA_INTERRUPT)
       state = notification;
   }
 }
 
-void cLoraOnReceive(LoraDataPacket packet)
+void IRAM_ATTR cLoraOnInterrupt()
 {
-  JsonDocument loraData;
-  deserializeJson(loraData, packet.data);
-
-  unsigned int srcId = loraData["nodeId"].as<unsigned int>();
+  if (xTaskHandleLoraControl == NULL)
+    return;
 
-  sc.log("<- " + String(srcId), sc.TRACE, sc.YELLOW);
-  Board.println(String(NODE_ID) + ": <- " + String(srcId));
+  // Doesn't overwrite a state notified by the LoRa callbacks, the task wakes anyway
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  xTaskNotifyFromISR(xTaskHandleLoraControl, NOTIFY_LORA_INTERRUPT, eSetValueWithoutOverwrite, &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
 
-  JsonArray dataArray = loraData["data"].as<JsonArray>();
+void cLoraOnReceive(LoraDataPacket packet)
+{
+  // Only the handle of the receive slot is queued, the control task decodes it and gives the slot back
+  bool retained = Board.lora->retainPacket(packet);
 
-  for (JsonVariant jsonData : dataArray)
+  if (!retained || xQueueSend(xQueueHandleReceived, &packet, 0) != pdTRUE)
   {
-    String str;
-    serializeJson(jsonData, str);
-    sc.log("  " + str, sc.TRACE, sc.YELLOW);
-    Board.println(String(NODE_ID) + ":   " + String(jsonData["nodeId"].as<int>()) + "-" + String(jsonData["index"].as<int>()));
-
-    SensorData data;
+    // No room to hand it off, decoded here while the slot is valid
+    decodePacket(packet);
 
-    data.index = jsonData["index"].as<int>();
-    data.nodeId = jsonData["nodeId"].as<int>();
-    data.temperature = jsonData["temperature"].as<float>();
-    data.timestamp = jsonData["timestamp"].as<unsigned long>();
-
-    xQueueSend(xQueueHandleSendWithLora, &data, portMAX_DELAY);
+    if (retained)
+      Board.lora->releasePacket(packet);
   }
 
   xTaskNotify(xTaskHandleLoraControl, STATE_CHECK, eSetValueWithOverwrite);
@@ -321,6 +651,21 @@ void cLoraOnSendDone()
   sc.log("LORA: Send done", sc.TRACE);
 }
 
+void cLoraOnReliableSendDone(unsigned int destinationAddress, bool success, int retries)
+{
+  // Delivered readings leave the log, the ones of the queues are kept for the next attempt
+  if (success && loraSendingSource == SOURCE_LOG)
+  {
+    xSemaphoreTake(xMutexLoraLog, portMAX_DELAY);
+    loraLog.pop(loraSendingCount);
+    xSemaphoreGive(xMutexLoraLog);
+  }
+  else if (!success)
+    requeueSending();
+
+  loraSendingCount = 0;
+}
+
 void cLoraOnSendTimeout()
 {
   xTaskNotify(xTaskHandleLoraControl, STATE_SEND, eSetValueWithOverwrite);
@@ -354,6 +699,8 @@ void config()
   Board.lora->setOnReceiveTimeout(cLoraOnReceiveTimeout);
   Board.lora->setOnSendDone(cLoraOnSendDone);
   Board.lora->setOnSendTimeout(cLoraOnSendTimeout);
+  Board.lora->setOnReliableSendDone(cLoraOnReliableSendDone);
+  Board.lora->setOnInterrupt(cLoraOnInterrupt);
 
   // === WiFi Config ===
 
@@ -392,6 +739,32 @@ void setup()
     Board.println("SETUP: BME280 not init");
   }
 
+  if (loraLog.begin())
+  {
+    sc.log("SETUP: Log init, " + String(loraLog.count()) + " readings to send", sc.INFO);
+    Board.println("SETUP: Log " + String(loraLog.count()) + " readings");
+    loraLogAvailable = true;
+  }
+  else
+  {
+    sc.log("SETUP: Log not init, no flash partition", sc.WARN);
+    Board.println("SETUP: Log not init");
+  }
+
+  // The sink keeps every reading it receives, only the relays aggregate
+  SensorAggregatorConfig aggregatorConfig = SensorAggregator::getDefaultConfig();
+  aggregatorConfig.mode = NODE_ID > 1 ? AGGREGATION_MODE : SENSORAGGREGATOR_MODE_OFF;
+  aggregatorConfig.window = AGGREGATION_WINDOW;
+  aggregatorConfig.deadband = AGGREGATION_DEADBAND;
+  aggregator.setConfig(aggregatorConfig);
+
+  // The sink prints what it receives at once
+  SensorBatchPolicyConfig batchConfig = SensorBatchPolicy::getDefaultConfig();
+  batchConfig.maxPayload = LORA_BATCH_SIZE;
+  batchConfig.maxAge = NODE_ID > 1 ? LORA_BATCH_MAX_AGE : 0;
+  batchConfig.minRecords = LORA_BATCH_MIN_RECORDS;
+  batchPolicy.setConfig(batchConfig);
+
   sc.log("LOG: DEBUG ENABLED", SCLOG::DEBUG);
   sc.log("LOG: INFO ENABLED", SCLOG::INFO);
   sc.log("LOG: TRACE ENABLED", SCLOG::TRACE);
@@ -401,7 +774,10 @@ void setup()
   sc.log("SETUP: Complete", sc.INFO);
   Board.println("SETUP: Complete");
 
-  xQueueHandleSendWithLora = xQueueCreate(10, sizeof(SensorData));
+  xQueueHandleSendWithLora = xQueueCreate(LORA_QUEUE_LENGTH, sizeof(SensorData));
+  xQueueHandleSummaries = xQueueCreate(LORA_SUMMARY_QUEUE_LENGTH, sizeof(SensorSummary));
+  xQueueHandleReceived = xQueueCreate(LORA_RECEIVE_QUEUE_LENGTH, sizeof(LoraDataPacket));
+  xMutexLoraLog = xSemaphoreCreateMutex();
 
   xTaskCreate(vTaskButton, "Button Task", configMINIMAL_STACK_SIZE + 1024, NULL, configMAX_PRIORITIES - 10, &xTaskHandleButton);
   xTaskCreate(vTaskReadTemperature, "Read Temperature Task: ", configMINIMAL_STACK_SIZE + 1024, NULL, configMAX_PRIORITIES - 5, &xTaskHandleReadTemperature);